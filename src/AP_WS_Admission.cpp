@@ -0,0 +1,66 @@
+#include <algorithm>
+
+#include "AP_WS_Admission.h"
+
+namespace OpenWifi {
+
+	void AP_WS_Admission::Configure(uint64_t Rate, uint64_t MaxQueued) {
+		std::lock_guard	G(Mutex_);
+		Rate_ = Rate;
+		MaxQueued_ = MaxQueued;
+		Tokens_ = (double) Rate;
+		LastRefill_ = Clock::now();
+	}
+
+	//	Called on the accept thread: the socket has not started its TLS handshake yet.
+	bool AP_WS_Admission::Admit(const Poco::Net::StreamSocket &Socket) {
+		auto Now = Clock::now();
+		std::lock_guard	G(Mutex_);
+		if(Rate_) {
+			auto Elapsed = std::chrono::duration<double>(Now - LastRefill_).count();
+			Tokens_ = std::min((double) Rate_, Tokens_ + Elapsed * (double) Rate_);
+			LastRefill_ = Now;
+			if(Tokens_ < 1.0) {
+				Stats_.RejectedRate++;
+				return false;
+			}
+		}
+		if(MaxQueued_ && Queued_.size() >= MaxQueued_) {
+			Stats_.RejectedBusy++;
+			return false;
+		}
+		if(Rate_)
+			Tokens_ -= 1.0;
+		Queued_[Socket.impl()->sockfd()] = Now;
+		Stats_.Admitted++;
+		return true;
+	}
+
+	void AP_WS_Admission::Started(const Poco::Net::StreamSocket &Socket) {
+		auto Now = Clock::now();
+		std::lock_guard	G(Mutex_);
+		auto Hint = Queued_.find(Socket.impl()->sockfd());
+		if(Hint!=Queued_.end()) {
+			auto Waited = (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(Now - Hint->second).count();
+			Stats_.TotalQueueTime += Waited;
+			Stats_.MaxQueueTime = std::max(Stats_.MaxQueueTime, Waited);
+			Queued_.erase(Hint);
+		}
+		Stats_.Handshakes++;
+		Stats_.InProgress++;
+	}
+
+	void AP_WS_Admission::Finished() {
+		std::lock_guard	G(Mutex_);
+		if(Stats_.InProgress)
+			Stats_.InProgress--;
+	}
+
+	AP_WS_Admission::AdmissionStats AP_WS_Admission::Stats() {
+		std::lock_guard	G(Mutex_);
+		auto Result = Stats_;
+		Result.Queued = Queued_.size();
+		Stats_.MaxQueueTime = 0;
+		return Result;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServerConnection.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/TCPServerConnectionFactory.h"
+#include "Poco/Net/TCPServerConnectionFilter.h"
+
+namespace OpenWifi {
+
+	//	Admission control in front of the device TLS handshake. Connections are admitted at a configured
+	//	rate and only while the handshake queue has room, anything else is closed right after accept,
+	//	before any TLS work is done. Admitted connections complete their handshake and certificate
+	//	validation on a dedicated, bounded pool: a reconnect storm never runs on the reactor threads
+	//	that serve established devices.
+	class AP_WS_Admission {
+	  public:
+		struct AdmissionStats {
+			uint64_t	Admitted=0, RejectedRate=0, RejectedBusy=0, Handshakes=0, InProgress=0, Queued=0,
+						TotalQueueTime=0, MaxQueueTime=0;
+		};
+
+		void Configure(uint64_t Rate, uint64_t MaxQueued);
+		bool Admit(const Poco::Net::StreamSocket &Socket);
+		void Started(const Poco::Net::StreamSocket &Socket);
+		void Finished();
+		//	MaxQueueTime is the longest wait since the previous call, everything else is cumulative.
+		AdmissionStats Stats();
+
+	  private:
+		using Clock = std::chrono::steady_clock;
+
+		std::mutex									Mutex_;
+		uint64_t									Rate_=0;
+		uint64_t									MaxQueued_=0;
+		double										Tokens_=0.0;
+		Clock::time_point							LastRefill_ = Clock::now();
+		//	Accept time of the connections waiting for a handshake thread, by socket.
+		std::unordered_map<poco_socket_t,Clock::time_point>	Queued_;
+		AdmissionStats								Stats_;
+	};
+
+	class AP_WS_AdmissionFilter : public Poco::Net::TCPServerConnectionFilter {
+	  public:
+		explicit AP_WS_AdmissionFilter(AP_WS_Admission &Admission) : Admission_(Admission) {}
+		bool accept(const Poco::Net::StreamSocket &Socket) override { return Admission_.Admit(Socket); }
+
+	  private:
+		AP_WS_Admission		&Admission_;
+	};
+
+	//	The HTTP connection that carries the TLS handshake and websocket upgrade of a device.
+	class AP_WS_HandshakeConnection : public Poco::Net::HTTPServerConnection {
+	  public:
+		AP_WS_HandshakeConnection(const Poco::Net::StreamSocket &Socket, Poco::Net::HTTPServerParams::Ptr Params,
+								  Poco::Net::HTTPRequestHandlerFactory::Ptr Factory, AP_WS_Admission &Admission)
+			: Poco::Net::HTTPServerConnection(Socket, Params, Factory),
+			  Admission_(Admission) {}
+
+		void run() override {
+			Admission_.Started(socket());
+			try {
+				Poco::Net::HTTPServerConnection::run();
+			} catch (...) {
+				Admission_.Finished();
+				throw;
+			}
+			Admission_.Finished();
+		}
+
+	  private:
+		AP_WS_Admission		&Admission_;
+	};
+
+	class AP_WS_HandshakeConnectionFactory : public Poco::Net::TCPServerConnectionFactory {
+	  public:
+		AP_WS_HandshakeConnectionFactory(Poco::Net::HTTPServerParams::Ptr Params,
+										 Poco::Net::HTTPRequestHandlerFactory::Ptr Factory, AP_WS_Admission &Admission)
+			: Params_(std::move(Params)),
+			  Factory_(std::move(Factory)),
+			  Admission_(Admission) {}
+
+		Poco::Net::TCPServerConnection *createConnection(const Poco::Net::StreamSocket &Socket) override {
+			return new AP_WS_HandshakeConnection(Socket, Params_, Factory_, Admission_);
+		}
+
+	  private:
+		Poco::Net::HTTPServerParams::Ptr			Params_;
+		Poco::Net::HTTPRequestHandlerFactory::Ptr	Factory_;
+		AP_WS_Admission								&Admission_;
+	};
+}
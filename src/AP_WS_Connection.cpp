@@ -18,6 +18,7 @@
 #include "CentralConfig.h"
 #include "CommandManager.h"
 #include "ConfigurationCache.h"
+#include "Daemon.h"
 #include "StorageService.h"
 #include "TelemetryStream.h"
 #include "framework/WebSocketClientNotifications.h"
@@ -37,11 +38,21 @@ namespace OpenWifi {
 									   Poco::Net::HTTPServerResponse &response,
 									   std::uint64_t connection_id,
 									   Poco::Logger &L,
-									   Poco::Net::SocketReactor &R)
+									   AP_WS_Reactor &R)
 		: Logger_(L) ,
 		  Reactor_(R)
 	{
 		State_.sessionId = connection_id;
+
+		//	The extension must be in the upgrade response, which the WebSocket sends when it is created.
+		if(request.has("Sec-WebSocket-Extensions")) {
+			AP_WS_Deflate::Parameters	Parameters;
+			std::string 				Extensions;
+			if(AP_WS_Deflate::Negotiate(request.get("Sec-WebSocket-Extensions"), AP_WS_Server()->DeflateOptions(), Parameters, Extensions)) {
+				response.set("Sec-WebSocket-Extensions", Extensions);
+				Deflate_ = std::make_unique<AP_WS_Deflate>(Parameters);
+			}
+		}
 		WS_ = std::make_unique<Poco::Net::WebSocket>(request,response);
 
 		auto TS = Poco::Timespan(360, 0);
@@ -51,7 +62,14 @@ namespace OpenWifi {
 		WS_->setNoDelay(true);
 		WS_->setKeepAlive(true);
 		WS_->setBlocking(false);
+		Valid_ = true;
+	}
 
+	//	Only once the device has been validated, on the handshake thread.
+	void AP_WS_Connection::StartReading() {
+		Registered_ = true;
+		Reactor_.Connections++;
+		Count(DeviceCount::None, DeviceCount::Connecting);
 		Reactor_.addEventHandler(
 			*WS_, Poco::NObserver<AP_WS_Connection, Poco::Net::ReadableNotification>(
 					  *this, &AP_WS_Connection::OnSocketReadable));
@@ -61,30 +79,13 @@ namespace OpenWifi {
 		Reactor_.addEventHandler(
 			*WS_, Poco::NObserver<AP_WS_Connection, Poco::Net::ErrorNotification>(
 					  *this, &AP_WS_Connection::OnSocketError));
-		Registered_ = true;
-		Valid_ = true;
 	}
 
-	class ThreadedCounter {
-	  public:
-		ThreadedCounter(bool T, std::atomic_uint64_t &C) :
-			C_(C),
-			Threaded_(T) {
-			if(Threaded_) {
-				C_++;
-			}
-		}
-
-		~ThreadedCounter() {
-			if(Threaded_ && C_>0) {
-				C_--;
-			}
-		}
-
-	  private:
-		std::atomic_uint64_t 	&C_;
-		bool 					Threaded_;
-	};
+	//	Only moves on from the expected state, so a connection that already ended is never counted again.
+	void AP_WS_Connection::Count(DeviceCount From, DeviceCount To) {
+		if(Counted_.compare_exchange_strong(From, To))
+			AP_WS_Server()->CountDevice(From, To, State_.started);
+	}
 
 	bool AP_WS_Connection::ValidatedDevice() {
 		if(DeviceValidated_)
@@ -152,7 +153,7 @@ namespace OpenWifi {
 			SerialNumber_ = CN_;
 			SerialNumberInt_ = Utils::SerialNumberToInt(SerialNumber_);
 
-			poco_debug(Logger_, fmt::format("TLS-CONNECTION({}): Session={} CN={} Completed. (t={})", CId_, State_.sessionId , CN_, ConcurrentStartingDevices_));
+			poco_debug(Logger_, fmt::format("TLS-CONNECTION({}): Session={} CN={} Completed.", CId_, State_.sessionId , CN_));
 			DeviceValidated_ = true;
 			return true;
 
@@ -217,9 +218,11 @@ namespace OpenWifi {
 	void AP_WS_Connection::EndConnection() {
 		Valid_=false;
 		if(!Dead_.test_and_set()) {
+			AP_WS_Server()->CountDevice(Counted_.exchange(DeviceCount::Ended), DeviceCount::Ended, State_.started);
 
 			if (Registered_) {
 				Registered_ = false;
+				Reactor_.Connections--;
 				Reactor_.removeEventHandler(
 					*WS_, Poco::NObserver<AP_WS_Connection, Poco::Net::ReadableNotification>(
 							  *this, &AP_WS_Connection::OnSocketReadable));
@@ -239,8 +242,10 @@ namespace OpenWifi {
 			}
 
 			auto SessionDeleted = AP_WS_Server()->EndSession(State_.sessionId, SerialNumberInt_);
-			if (SessionDeleted)
+			if (SessionDeleted) {
+				Daemon()->GetDashboard().DeviceDisconnected(SerialNumber_);
 				WebSocketClientNotificationDeviceDisconnected(SerialNumber_);
+			}
 		}
 	}
 
@@ -300,7 +305,8 @@ namespace OpenWifi {
 										   CId_, UUID, D.UUID));
 			bool Sent;
 
-			StorageService()->AddCommand(SerialNumber_, Cmd, Storage::CommandExecutionType::COMMAND_EXECUTED);
+			if(StorageService()->AddCommand(SerialNumber_, Cmd, Storage::CommandExecutionType::COMMAND_EXECUTED))
+				CommandManager()->CommandQueued(Cmd, false);
 			CommandManager()->PostCommand(CommandManager()->NextRPCId(),SerialNumber_, Cmd.Command, Params, Cmd.UUID, Sent);
 
 			WebSocketClientNotificationDeviceConfigurationChange(D.SerialNumber, UUID, UpgradedUUID);
@@ -366,6 +372,11 @@ namespace OpenWifi {
 		}
 
 		auto Serial = Poco::trim(Poco::toLower(ParamsObj->get(uCentralProtocol::SERIAL).toString()));
+		CheckSerialNumber(Serial);
+		DispatchJSONRPCEvent(EventType, Method, ParamsObj, Serial);
+	}
+
+	void AP_WS_Connection::CheckSerialNumber(const std::string &Serial) {
 		if (!Utils::ValidSerialNumber(Serial)) {
 			Poco::Exception E(
 				fmt::format(
@@ -382,7 +393,60 @@ namespace OpenWifi {
 				EACCES);
 			E.rethrow();
 		}
+	}
+
+	bool AP_WS_Connection::ProcessJSONRPCEvent(const AP_WS_FrameScanner &Frame) {
+		//	compressed payloads, escaped strings and unknown methods are left to the full parser.
+		std::string Method, Serial;
+		if (Frame.IsCompressed() || !Frame.Method(Method) || !Frame.Serial(Serial))
+			return false;
+
+		auto EventType = uCentralProtocol::Events::EventFromString(Method);
+		if (EventType == uCentralProtocol::Events::ET_UNKNOWN)
+			return false;
+
+		Serial = Poco::trim(Poco::toLower(Serial));
+		CheckSerialNumber(Serial);
 
+		switch (EventType) {
+			case uCentralProtocol::Events::ET_PING: {
+				std::string_view UUIDValue;
+				std::uint64_t UUID = 0;
+				if (AP_WS_FrameScanner::FindMember(Frame.Params(), uCentralProtocol::UUID, UUIDValue) &&
+					AP_WS_FrameScanner::ToUInt64(UUIDValue, UUID)) {
+					poco_trace(Logger_, fmt::format("PING({}): Current config is {}", CId_, UUID));
+				} else {
+					poco_warning(Logger_, fmt::format("PING({}): Missing parameter.", CId_));
+				}
+				return true;
+			}
+
+			case uCentralProtocol::Events::ET_TELEMETRY: {
+				std::string_view Data, Timestamp;
+				if (!AP_WS_FrameScanner::FindMember(Frame.Params(), "data", Data) || Data.front() != '{' ||
+					AP_WS_FrameScanner::FindMember(Data, "timestamp", Timestamp))
+					return false;
+				//	splice the timestamp into the raw telemetry object instead of rebuilding it.
+				auto Rest = Data.substr(1);
+				auto First = Rest.find_first_not_of(" \t\r\n");
+				auto Empty = First != std::string_view::npos && Rest[First] == '}';
+				std::string Payload = fmt::format("{{\"timestamp\":{}{}", OpenWifi::Now(), Empty ? "" : ",");
+				Payload.append(Rest.data(), Rest.size());
+				ProcessTelemetryPayload(Payload);
+				return true;
+			}
+
+			default: {
+				Poco::JSON::Parser Parser;
+				auto ParamsObj = Parser.parse(std::string(Frame.Params())).extract<Poco::JSON::Object::Ptr>();
+				DispatchJSONRPCEvent(EventType, Method, ParamsObj, Serial);
+				return true;
+			}
+		}
+	}
+
+	void AP_WS_Connection::DispatchJSONRPCEvent(uCentralProtocol::Events::EVENT_MSG EventType, const std::string &Method,
+												Poco::JSON::Object::Ptr ParamsObj, std::string &Serial) {
 		switch (EventType) {
 			case uCentralProtocol::Events::ET_CONNECT: {
 				Process_connect(ParamsObj, Serial);
@@ -555,6 +619,7 @@ namespace OpenWifi {
 		if(!ValidatedDevice())
 			return;
 
+		AP_WS_Reactor::Busy	Timing(Reactor_);
 		try {
 			return ProcessIncomingFrame();
 		} catch (const Poco::Exception &E) {
@@ -583,18 +648,37 @@ namespace OpenWifi {
 				return EndConnection();
 			}
 
+			State_.RX += IncomingSize;
+
+			if (Op == Poco::Net::WebSocket::FRAME_OP_TEXT || Op == Poco::Net::WebSocket::FRAME_OP_BINARY) {
+				AP_WS_Deflate::Totals().RxWire += IncomingSize;
+				if (flags & Poco::Net::WebSocket::FRAME_FLAG_RSV1) {
+					Poco::Buffer<char> Inflated(0);
+					if (!Deflate_ || !Deflate_->Decompress(IncomingFrame.begin(), IncomingSize, Inflated)) {
+						AP_WS_Deflate::Totals().Errors++;
+						poco_warning(Logger_, fmt::format("DEFLATE({}): invalid compressed frame. Session={}", CId_, State_.sessionId));
+						return EndConnection();
+					}
+					IncomingFrame.assign(Inflated.begin(), Inflated.size());
+					IncomingSize = (int)Inflated.size();
+				}
+				AP_WS_Deflate::Totals().RxRaw += IncomingSize;
+			}
+
 			IncomingFrame.append(0);
 
-			State_.RX += IncomingSize;
 			State_.MessageCount++;
 			State_.LastContact = OpenWifi::Now();
 
 			switch (Op) {
 				case Poco::Net::WebSocket::FRAME_OP_PING: {
 					poco_trace(Logger_, fmt::format("WS-PING({}): received. PONG sent back.", CId_));
-					WS_->sendFrame("", 0,
-								   (int)Poco::Net::WebSocket::FRAME_OP_PONG |
-									   (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
+					{
+						std::lock_guard		Lock(SendMutex_);
+						WS_->sendFrame("", 0,
+									   (int)Poco::Net::WebSocket::FRAME_OP_PONG |
+										   (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
+					}
 					State_.MessageCount++;
 
 					if (KafkaManager()->Enabled()) {
@@ -624,6 +708,11 @@ namespace OpenWifi {
 					poco_trace(Logger_, fmt::format("FRAME({}): Frame received (length={}, flags={}). Msg={}", CId_,
 									 IncomingSize, flags, IncomingFrame.begin()));
 
+					AP_WS_FrameScanner	Frame(std::string_view(IncomingFrame.begin(), IncomingSize));
+					if (Frame.Valid() && Frame.IsEvent() && ProcessJSONRPCEvent(Frame)) {
+						return;
+					}
+
 					Poco::JSON::Parser parser;
 					auto ParsedMessage = parser.parse(IncomingFrame.begin());
 					auto IncomingJSON = ParsedMessage.extract<Poco::JSON::Object::Ptr>();
@@ -742,8 +831,20 @@ namespace OpenWifi {
 
 	bool AP_WS_Connection::Send(const std::string &Payload) {
 		try {
+			std::lock_guard		Lock(SendMutex_);
+			AP_WS_Deflate::Totals().TxRaw += Payload.size();
+			std::string Compressed;
+			if (Deflate_ && Deflate_->Worthwhile(Payload.size()) &&
+				Deflate_->Compress(Payload.c_str(), Payload.size(), Compressed)) {
+				size_t BytesSent = WS_->sendFrame(Compressed.c_str(), (int)Compressed.size(),
+												  (int)Poco::Net::WebSocket::FRAME_TEXT | (int)Poco::Net::WebSocket::FRAME_FLAG_RSV1);
+				State_.TX += BytesSent;
+				AP_WS_Deflate::Totals().TxWire += BytesSent;
+				return BytesSent == Compressed.size();
+			}
 			size_t BytesSent = WS_->sendFrame(Payload.c_str(), (int)Payload.size());
 			State_.TX += BytesSent;
+			AP_WS_Deflate::Totals().TxWire += BytesSent;
 			return BytesSent == Payload.size();
 		} catch(const Poco::Exception &E) {
 			Logger_.log(E);
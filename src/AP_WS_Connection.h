@@ -15,6 +15,10 @@
 #include "Poco/Net/WebSocket.h"
 
 #include "RESTObjects/RESTAPI_GWobjects.h"
+#include "framework/ow_constants.h"
+#include "AP_WS_Deflate.h"
+#include "AP_WS_FrameScanner.h"
+#include "AP_WS_ReactorPool.h"
 
 
 namespace OpenWifi {
@@ -22,15 +26,25 @@ namespace OpenWifi {
 	class AP_WS_Connection {
 		static constexpr int BufSize = 256000;
 	  public:
+		//	How the connection shows in the device statistics: validated connections are connecting until
+		//	the device sends its connect message, and stop counting once ended.
+		enum class DeviceCount { None, Connecting, Connected, Ended };
+
 		explicit AP_WS_Connection(	Poco::Net::HTTPServerRequest &request,
 									Poco::Net::HTTPServerResponse &response,
 									std::uint64_t connection_id,
 									Poco::Logger &L,
-									Poco::Net::SocketReactor &R);
+									AP_WS_Reactor &R);
 		~AP_WS_Connection();
 
+		void StartReading();
+
 		void EndConnection();
 		void ProcessJSONRPCEvent(Poco::JSON::Object::Ptr & Doc);
+		bool ProcessJSONRPCEvent(const AP_WS_FrameScanner &Frame);
+		void DispatchJSONRPCEvent(uCentralProtocol::Events::EVENT_MSG EventType, const std::string &Method,
+								  Poco::JSON::Object::Ptr ParamsObj, std::string &Serial);
+		void CheckSerialNumber(const std::string &Serial);
 		void ProcessJSONRPCResult(Poco::JSON::Object::Ptr Doc);
 		void ProcessIncomingFrame();
 		void ProcessIncomingRadiusData(const Poco::JSON::Object::Ptr &Doc);
@@ -63,6 +77,7 @@ namespace OpenWifi {
 		void Process_recovery(Poco::JSON::Object::Ptr ParamsObj);
 		void Process_deviceupdate(Poco::JSON::Object::Ptr ParamsObj, std::string &Serial);
 		void Process_telemetry(Poco::JSON::Object::Ptr ParamsObj);
+		void ProcessTelemetryPayload(const std::string &Payload);
 		void Process_venuebroadcast(Poco::JSON::Object::Ptr ParamsObj);
 
 		bool ValidatedDevice();
@@ -89,9 +104,11 @@ namespace OpenWifi {
 	  private:
 		// std::recursive_mutex 				LocalMutex_;
 		std::shared_mutex					TelemetryMutex_;
+		std::mutex							SendMutex_;
 		Poco::Logger                    	&Logger_;
-		Poco::Net::SocketReactor			&Reactor_;
+		AP_WS_Reactor						&Reactor_;
 		std::unique_ptr<Poco::Net::WebSocket> WS_;
+		std::unique_ptr<AP_WS_Deflate>		Deflate_;
 		std::string                         SerialNumber_;
 		uint64_t 							SerialNumberInt_=0;
 		std::string 						Compatible_;
@@ -113,16 +130,15 @@ namespace OpenWifi {
 		GWObjects::HealthCheck				LastHealthcheck_;
 		std::chrono::time_point<std::chrono::high_resolution_clock> ConnectionStart_ = std::chrono::high_resolution_clock::now();
 		std::chrono::duration<double, std::milli> ConnectionCompletionTime_{0.0};
-		bool 								Threaded_=false;
 		std::atomic_flag 					Dead_=false;
 		std::atomic_bool 					DeviceValidated_=false;
 		std::atomic_bool 					Valid_=false;
-
-		static inline std::atomic_uint64_t 	ConcurrentStartingDevices_=0;
+		std::atomic<DeviceCount>			Counted_=DeviceCount::None;
 
 		bool StartTelemetry(std::uint64_t RPCID);
 		bool StopTelemetry(std::uint64_t RPCID);
 		void UpdateCounts();
+		void Count(DeviceCount From, DeviceCount To);
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include "Poco/String.h"
+#include "Poco/StringTokenizer.h"
+
+#include "AP_WS_Deflate.h"
+
+namespace OpenWifi {
+
+	//	zlib cannot produce a raw deflate stream with a window smaller than 2^9.
+	static constexpr int MinWindowBits = 9;
+	static constexpr int MaxWindowBits = 15;
+
+	static bool WindowBits(const std::string &Value, int Min, int &Bits) {
+		if(Value.empty() || !std::all_of(Value.begin(), Value.end(), ::isdigit))
+			return false;
+		Bits = std::stoi(Value);
+		return Bits >= Min && Bits <= MaxWindowBits;
+	}
+
+	bool AP_WS_Deflate::Negotiate(const std::string &Offers, const Options &O, Parameters &P, std::string &Response) {
+		if(!O.Enabled)
+			return false;
+
+		auto Window = (int) std::clamp(O.WindowBits, (uint64_t)MinWindowBits, (uint64_t)MaxWindowBits);
+		Poco::StringTokenizer	Extensions(Offers, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+		for(const auto &Extension:Extensions) {
+			Poco::StringTokenizer	Params(Extension, ";", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+			if(Params.count()==0 || Poco::icompare(Params[0], "permessage-deflate")!=0)
+				continue;
+
+			Parameters	Candidate;
+			Candidate.ServerWindowBits = Window;
+			Candidate.MemLevel = (int) std::clamp(O.MemLevel, (uint64_t)1, (uint64_t)9);
+			Candidate.MinSize = O.MinSize;
+			bool ClientWindowOffered = false, Valid = true;
+			for(std::size_t i=1; i<Params.count() && Valid; ++i) {
+				auto Equal = Params[i].find('=');
+				auto Name = Poco::trim(Params[i].substr(0, Equal));
+				auto Value = Equal==std::string::npos ? std::string{} : Poco::trim(Params[i].substr(Equal + 1));
+				if(Value.size()>=2 && Value.front()=='"' && Value.back()=='"')
+					Value = Value.substr(1, Value.size() - 2);
+				int Bits;
+				if(Name=="server_no_context_takeover") {
+					Candidate.ServerNoContextTakeover = true;
+				} else if(Name=="client_no_context_takeover") {
+					Candidate.ClientNoContextTakeover = true;
+				} else if(Name=="server_max_window_bits") {
+					Valid = WindowBits(Value, MinWindowBits, Bits);
+					Candidate.ServerWindowBits = std::min(Window, Bits);
+				} else if(Name=="client_max_window_bits") {
+					ClientWindowOffered = true;
+					if(!Value.empty()) {
+						Valid = WindowBits(Value, 8, Bits);
+						Candidate.ClientWindowBits = Bits;
+					}
+				} else {
+					Valid = false;
+				}
+			}
+			if(!Valid)
+				continue;
+
+			//	A device that cannot be told to use a smaller window would need more inflate memory than allowed.
+			if(ClientWindowOffered)
+				Candidate.ClientWindowBits = std::min(Candidate.ClientWindowBits, Window);
+			else if(Window < MaxWindowBits)
+				continue;
+
+			if(!O.ContextTakeover) {
+				Candidate.ServerNoContextTakeover = true;
+				Candidate.ClientNoContextTakeover = true;
+			}
+
+			Response = "permessage-deflate";
+			if(Candidate.ServerNoContextTakeover)
+				Response += "; server_no_context_takeover";
+			if(Candidate.ClientNoContextTakeover)
+				Response += "; client_no_context_takeover";
+			if(Candidate.ServerWindowBits < MaxWindowBits)
+				Response += "; server_max_window_bits=" + std::to_string(Candidate.ServerWindowBits);
+			if(ClientWindowOffered)
+				Response += "; client_max_window_bits=" + std::to_string(Candidate.ClientWindowBits);
+			P = Candidate;
+			return true;
+		}
+		return false;
+	}
+
+	uint64_t AP_WS_Deflate::MemoryPerConnection(const Options &O) {
+		auto Window = std::clamp(O.WindowBits, (uint64_t)MinWindowBits, (uint64_t)MaxWindowBits);
+		auto MemLevel = std::clamp(O.MemLevel, (uint64_t)1, (uint64_t)9);
+		//	From zconf.h: deflate needs 2^(windowBits+2) + 2^(memLevel+9), inflate 2^windowBits plus about 7KB.
+		return (uint64_t{1} << (Window + 2)) + (uint64_t{1} << (MemLevel + 9)) + (uint64_t{1} << Window) + 7 * 1024;
+	}
+
+	AP_WS_Deflate::AP_WS_Deflate(const Parameters &P) : P_(P) {
+	}
+
+	AP_WS_Deflate::~AP_WS_Deflate() {
+		if(DeflateReady_)
+			deflateEnd(&Deflate_);
+		if(InflateReady_)
+			inflateEnd(&Inflate_);
+	}
+
+	//	The stream is only created for the first message worth compressing, most connections never send one.
+	bool AP_WS_Deflate::Compress(const char *Data, std::size_t Size, std::string &Out) {
+		if(!DeflateReady_) {
+			if(deflateInit2(&Deflate_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -P_.ServerWindowBits, P_.MemLevel, Z_DEFAULT_STRATEGY)!=Z_OK)
+				return false;
+			DeflateReady_ = true;
+		}
+
+		Out.resize(Size / 2 + 64);
+		std::size_t Used = 0;
+		Deflate_.next_in = (Bytef *) Data;
+		Deflate_.avail_in = (uInt) Size;
+		do {
+			if(Used==Out.size())
+				Out.resize(Out.size() * 2);
+			Deflate_.next_out = (Bytef *) &Out[Used];
+			Deflate_.avail_out = (uInt) (Out.size() - Used);
+			auto R = deflate(&Deflate_, Z_SYNC_FLUSH);
+			Used = Out.size() - Deflate_.avail_out;
+			if(R!=Z_OK && R!=Z_BUF_ERROR) {
+				deflateEnd(&Deflate_);
+				DeflateReady_ = false;
+				return false;
+			}
+		} while(Deflate_.avail_in>0 || Deflate_.avail_out==0);
+
+		//	The empty block that ends a sync flush is implied by the extension and not sent.
+		if(Used>=4)
+			Used -= 4;
+		Out.resize(Used);
+		if(P_.ServerNoContextTakeover)
+			deflateReset(&Deflate_);
+		return true;
+	}
+
+	bool AP_WS_Deflate::Decompress(const char *Data, std::size_t Size, Poco::Buffer<char> &Out) {
+		if(!InflateReady_) {
+			if(inflateInit2(&Inflate_, -std::max(MinWindowBits, P_.ClientWindowBits))!=Z_OK)
+				return false;
+			InflateReady_ = true;
+		}
+
+		std::string Input;
+		Input.reserve(Size + 4);
+		Input.append(Data, Size);
+		Input.append("\x00\x00\xff\xff", 4);
+
+		Out.resize(std::max(Size * 4, (std::size_t)4096), false);
+		std::size_t Used = 0;
+		Inflate_.next_in = (Bytef *) Input.data();
+		Inflate_.avail_in = (uInt) Input.size();
+		bool Failed = false, Ended = false;
+		do {
+			if(Used==Out.size()) {
+				if(Out.size()>=MaxMessageSize) {
+					Failed = true;
+					break;
+				}
+				Out.resize(std::min(Out.size() * 2, MaxMessageSize), true);
+			}
+			Inflate_.next_out = (Bytef *) (Out.begin() + Used);
+			Inflate_.avail_out = (uInt) (Out.size() - Used);
+			auto R = inflate(&Inflate_, Z_SYNC_FLUSH);
+			Used = Out.size() - Inflate_.avail_out;
+			//	A final block ends the stream, the next message starts a new one.
+			if(R==Z_STREAM_END) {
+				Ended = true;
+				break;
+			}
+			if(R==Z_BUF_ERROR && Inflate_.avail_out>0)
+				break;
+			if(R!=Z_OK && R!=Z_BUF_ERROR) {
+				Failed = true;
+				break;
+			}
+		} while(Inflate_.avail_in>0 || Inflate_.avail_out==0);
+
+		if(Failed) {
+			inflateEnd(&Inflate_);
+			InflateReady_ = false;
+			return false;
+		}
+		Out.resize(Used, true);
+		if(P_.ClientNoContextTakeover || Ended)
+			inflateReset(&Inflate_);
+		return true;
+	}
+}
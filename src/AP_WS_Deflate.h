@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "Poco/Buffer.h"
+#include "Poco/zlib.h"
+
+namespace OpenWifi {
+
+	//	RFC 7692 permessage-deflate for device connections. Compressed messages carry RSV1 on their
+	//	first frame. Each connection owns one deflate and one inflate stream: when context takeover is
+	//	allowed the dictionary carries over from message to message, otherwise both are reset after
+	//	every message. Window bits and memory level bound the zlib state kept per connection.
+	class AP_WS_Deflate {
+	  public:
+		struct Options {
+			bool		Enabled=true;
+			uint64_t	WindowBits=12;
+			uint64_t	MemLevel=5;
+			bool		ContextTakeover=true;
+			uint64_t	MinSize=256;
+		};
+
+		struct Parameters {
+			int			ServerWindowBits=15;
+			int			ClientWindowBits=15;
+			int			MemLevel=8;
+			bool		ServerNoContextTakeover=false;
+			bool		ClientNoContextTakeover=false;
+			uint64_t	MinSize=256;
+		};
+
+		//	Totals over all connections, raw is the size of the JSON, wire the size of what was sent.
+		struct Counters {
+			std::atomic_uint64_t	RxRaw=0, RxWire=0, TxRaw=0, TxWire=0, Errors=0;
+		};
+
+		//	Picks the first acceptable offer of a Sec-WebSocket-Extensions header and returns the
+		//	response header value.
+		static bool Negotiate(const std::string &Offers, const Options &O, Parameters &P, std::string &Response);
+		//	Bytes of zlib state one connection may hold with these options.
+		static uint64_t MemoryPerConnection(const Options &O);
+
+		explicit AP_WS_Deflate(const Parameters &P);
+		~AP_WS_Deflate();
+		AP_WS_Deflate(const AP_WS_Deflate &) = delete;
+		AP_WS_Deflate &operator=(const AP_WS_Deflate &) = delete;
+
+		[[nodiscard]] inline bool Worthwhile(std::size_t Size) const { return Size >= P_.MinSize; }
+		bool Compress(const char *Data, std::size_t Size, std::string &Out);
+		bool Decompress(const char *Data, std::size_t Size, Poco::Buffer<char> &Out);
+
+		static inline Counters & Totals() {
+			static Counters C;
+			return C;
+		}
+
+	  private:
+		//	Limit on an inflated message, so a small frame cannot expand without bound.
+		static constexpr std::size_t 	MaxMessageSize = 16 * 1024 * 1024;
+
+		Parameters		P_;
+		z_stream		Deflate_{};
+		z_stream		Inflate_{};
+		bool			DeflateReady_=false;
+		bool			InflateReady_=false;
+	};
+}
@@ -0,0 +1,192 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstdlib>
+
+namespace OpenWifi {
+
+	//	A single pass, allocation free scanner over an incoming JSON-RPC frame. It only locates the
+	//	top level members we dispatch on (and a few members of params), leaving the values as
+	//	views into the frame. Anything the scanner does not understand makes it invalid, and the
+	//	caller must then fall back on the full Poco::JSON parser.
+	class AP_WS_FrameScanner {
+	  public:
+		explicit AP_WS_FrameScanner(std::string_view Frame) {
+			Valid_ = ForEachMember(Frame, [this](std::string_view Key, std::string_view Value) {
+				if (Key == "jsonrpc")
+					JSONRPC_ = Value;
+				else if (Key == "method")
+					Method_ = Value;
+				else if (Key == "id")
+					Id_ = Value;
+				else if (Key == "params")
+					Params_ = Value;
+				else if (Key == "result")
+					Result_ = Value;
+				else if (Key == "radius")
+					Radius_ = Value;
+				return true;
+			});
+			if (Valid_ && !Params_.empty() && Params_.front() == '{') {
+				Valid_ = ForEachMember(Params_, [this](std::string_view Key, std::string_view Value) {
+					if (Key == "serial")
+						Serial_ = Value;
+					else if (Key == "compress_64")
+						Compressed_ = true;
+					return true;
+				});
+			}
+		}
+
+		[[nodiscard]] inline bool Valid() const { return Valid_; }
+		[[nodiscard]] inline bool IsEvent() const { return !JSONRPC_.empty() && !Method_.empty() && !Params_.empty(); }
+		[[nodiscard]] inline bool IsCompressed() const { return Compressed_; }
+		[[nodiscard]] inline std::string_view Params() const { return Params_; }
+		[[nodiscard]] inline std::string_view Id() const { return Id_; }
+
+		[[nodiscard]] inline bool Method(std::string &Value) const { return Unquote(Method_, Value); }
+		[[nodiscard]] inline bool Serial(std::string &Value) const { return Unquote(Serial_, Value); }
+
+		//	Find a member in a JSON object view. Value is left pointing at the raw JSON value.
+		[[nodiscard]] static inline bool FindMember(std::string_view Object, std::string_view Key, std::string_view &Value) {
+			bool Found = false;
+			auto Ok = ForEachMember(Object, [&](std::string_view K, std::string_view V) {
+				if (K == Key) {
+					Value = V;
+					Found = true;
+					return false;
+				}
+				return true;
+			});
+			return Ok && Found;
+		}
+
+		[[nodiscard]] static inline bool ToUInt64(std::string_view Value, std::uint64_t &Number) {
+			if (Value.empty() || Value.size() > 20)
+				return false;
+			Number = 0;
+			for (const auto &c : Value) {
+				if (c < '0' || c > '9')
+					return false;
+				Number = Number * 10 + (c - '0');
+			}
+			return true;
+		}
+
+		//	Only plain strings (no escape sequences) are returned, anything else needs the real parser.
+		[[nodiscard]] static inline bool Unquote(std::string_view Value, std::string &Result) {
+			if (Value.size() < 2 || Value.front() != '"' || Value.back() != '"')
+				return false;
+			Value = Value.substr(1, Value.size() - 2);
+			if (Value.find('\\') != std::string_view::npos)
+				return false;
+			Result.assign(Value.data(), Value.size());
+			return true;
+		}
+
+		template <typename F> static bool ForEachMember(std::string_view Object, F Callback) {
+			std::size_t P = SkipWS(Object, 0);
+			if (P >= Object.size() || Object[P] != '{')
+				return false;
+			P = SkipWS(Object, P + 1);
+			if (P < Object.size() && Object[P] == '}')
+				return true;
+			while (P < Object.size()) {
+				if (Object[P] != '"')
+					return false;
+				auto KeyEnd = SkipString(Object, P);
+				if (KeyEnd == std::string_view::npos)
+					return false;
+				auto Key = Object.substr(P + 1, KeyEnd - P - 2);
+				P = SkipWS(Object, KeyEnd);
+				if (P >= Object.size() || Object[P] != ':')
+					return false;
+				P = SkipWS(Object, P + 1);
+				auto ValueEnd = SkipValue(Object, P);
+				if (ValueEnd == std::string_view::npos)
+					return false;
+				if (!Callback(Key, Object.substr(P, ValueEnd - P)))
+					return true;
+				P = SkipWS(Object, ValueEnd);
+				if (P >= Object.size())
+					return false;
+				if (Object[P] == '}')
+					return true;
+				if (Object[P] != ',')
+					return false;
+				P = SkipWS(Object, P + 1);
+			}
+			return false;
+		}
+
+	  private:
+		bool				Valid_ = false;
+		bool				Compressed_ = false;
+		std::string_view	JSONRPC_, Method_, Id_, Params_, Result_, Radius_, Serial_;
+
+		static inline std::size_t SkipWS(std::string_view S, std::size_t P) {
+			while (P < S.size() && (S[P] == ' ' || S[P] == '\t' || S[P] == '\r' || S[P] == '\n'))
+				P++;
+			return P;
+		}
+
+		//	P is on the opening quote, returns the position right after the closing quote
+		static inline std::size_t SkipString(std::string_view S, std::size_t P) {
+			for (P = P + 1; P < S.size(); P++) {
+				if (S[P] == '\\')
+					P++;
+				else if (S[P] == '"')
+					return P + 1;
+			}
+			return std::string_view::npos;
+		}
+
+		static inline std::size_t SkipValue(std::string_view S, std::size_t P) {
+			if (P >= S.size())
+				return std::string_view::npos;
+			if (S[P] == '"')
+				return SkipString(S, P);
+			if (S[P] == '{' || S[P] == '[') {
+				//	One bit per open container, set for an object. Nesting deeper than the bits we have,
+				//	or a closing bracket of the wrong kind, is left to the real parser.
+				std::uint64_t	Objects = 0;
+				std::size_t 	Depth = 0;
+				while (P < S.size()) {
+					auto c = S[P];
+					if (c == '"') {
+						P = SkipString(S, P);
+						if (P == std::string_view::npos)
+							return P;
+						continue;
+					}
+					if (c == '{' || c == '[') {
+						if (Depth == 64)
+							return std::string_view::npos;
+						Objects = (Objects << 1) | (c == '{' ? 1 : 0);
+						Depth++;
+					} else if (c == '}' || c == ']') {
+						if ((Objects & 1) != (c == '}' ? 1u : 0u))
+							return std::string_view::npos;
+						Objects >>= 1;
+						if (--Depth == 0)
+							return P + 1;
+					}
+					P++;
+				}
+				return std::string_view::npos;
+			}
+			auto Start = P;
+			while (P < S.size() && S[P] != ',' && S[P] != '}' && S[P] != ']' && S[P] != ' ' &&
+				   S[P] != '\t' && S[P] != '\r' && S[P] != '\n')
+				P++;
+			return P == Start ? std::string_view::npos : P;
+		}
+	};
+}
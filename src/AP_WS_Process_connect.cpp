@@ -11,6 +11,7 @@
 #include "CentralConfig.h"
 
 #include "CommandManager.h"
+#include "DeviceHistory.h"
 
 namespace OpenWifi {
 
@@ -78,6 +79,7 @@ void AP_WS_Connection::Process_connect(Poco::JSON::Object::Ptr ParamsObj, const
 
 		State_.Compatible = Compatible_;
 		State_.Connected = true;
+		Count(DeviceCount::Connecting, DeviceCount::Connected);
 		ConnectionCompletionTime_ = std::chrono::high_resolution_clock::now() - ConnectionStart_;
 		State_.connectionCompletionTime = ConnectionCompletionTime_.count();
 
@@ -106,7 +108,11 @@ void AP_WS_Connection::Process_connect(Poco::JSON::Object::Ptr ParamsObj, const
 			}
 		}
 
+		Daemon()->GetDashboard().DeviceConnected(SerialNumber_, Compatible_, State_.VerifiedCertificate);
 		WebSocketClientNotificationDeviceConnected(SerialNumber_);
+		CommandManager()->DeviceConnected(SerialNumberInt_);
+		//	The device may have reported through another gateway since we last saw it.
+		DeviceHistory()->Remove(SerialNumber_);
 
 		// std::cout << "Serial: " << SerialNumber_ << "Session: " << State_.sessionId << std::endl;
 
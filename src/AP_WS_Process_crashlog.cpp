@@ -4,6 +4,7 @@
 
 #include "AP_WS_Connection.h"
 #include "StorageService.h"
+#include "StorageWriteBehind.h"
 
 namespace OpenWifi {
 	void AP_WS_Connection::Process_crashlog(Poco::JSON::Object::Ptr ParamsObj) {
@@ -24,7 +25,7 @@ namespace OpenWifi {
 										   .Recorded = (uint64_t)time(nullptr),
 										   .LogType = 1,
 										   .UUID = 0};
-			StorageService()->AddLog(DeviceLog);
+			StorageWriteBehind()->AddLog(DeviceLog);
 
 		} else {
 			poco_warning(Logger_, fmt::format("LOG({}): Missing parameters.", CId_));
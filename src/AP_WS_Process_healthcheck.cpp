@@ -3,7 +3,9 @@
 //
 
 #include "AP_WS_Connection.h"
+#include "Daemon.h"
 #include "StorageService.h"
+#include "StorageWriteBehind.h"
 
 namespace OpenWifi {
 
@@ -47,13 +49,14 @@ void AP_WS_Connection::Process_healthcheck(Poco::JSON::Object::Ptr ParamsObj) {
 		Check.Data = CheckData;
 		Check.Sanity = Sanity;
 
-		StorageService()->AddHealthCheckData(Check);
+		StorageWriteBehind()->AddHealthCheckData(Check);
 
 		if (!request_uuid.empty()) {
 			StorageService()->SetCommandResult(request_uuid, CheckData);
 		}
 
 		LastHealthcheck_ = Check;
+		Daemon()->GetDashboard().HealthcheckUpdated(SerialNumber_, Check.Sanity);
 		if (KafkaManager()->Enabled()) {
 			Poco::JSON::Stringifier Stringify;
 			std::ostringstream OS;
@@ -3,7 +3,9 @@
 //
 
 #include "AP_WS_Connection.h"
+#include "Daemon.h"
 #include "StorageService.h"
+#include "StorageWriteBehind.h"
 #include "framework/WebSocketClientNotifications.h"
 #include "StateUtils.h"
 
@@ -40,13 +42,15 @@ namespace OpenWifi {
 			GWObjects::Statistics Stats{
 				.SerialNumber = SerialNumber_, .UUID = UUID, .Data = StateStr};
 			Stats.Recorded = OpenWifi::Now();
-			StorageService()->AddStatisticsData(Stats);
+			StorageWriteBehind()->AddStatisticsData(Stats);
 			if (!request_uuid.empty()) {
 				StorageService()->SetCommandResult(request_uuid, StateStr);
 			}
 
 			StateUtils::ComputeAssociations(StateObj, 	State_.Associations_2G,
 														State_.Associations_5G);
+			Daemon()->GetDashboard().StateUpdated(SerialNumber_, StateObj, State_.Associations_2G,
+												  State_.Associations_5G);
 
 			if (KafkaManager()->Enabled()) {
 				Poco::JSON::Stringifier Stringify;
@@ -58,7 +62,7 @@ namespace OpenWifi {
 			WebSocketNotification<WebNotificationSingleDevice>	N;
 			N.content.serialNumber = SerialNumber_;
 			N.type = "device_statistics";
-			WebSocketClientServer()->SendNotification(N);
+			WebSocketClientServer()->SendDeviceNotification(SerialNumber_, N, true);
 
 		} else {
 			poco_warning(Logger_, fmt::format("STATE({}): Invalid request. Missing serial, uuid, or state", CId_));
@@ -8,6 +8,22 @@
 
 namespace OpenWifi {
 	void AP_WS_Connection::Process_telemetry(Poco::JSON::Object::Ptr ParamsObj) {
+		std::string Payload;
+		if (State_.Connected && TelemetryReporting_) {
+			if (!ParamsObj->has("data")) {
+				poco_debug(Logger_,fmt::format("TELEMETRY({}): Invalid telemetry packet.",SerialNumber_));
+				return;
+			}
+			auto Data = ParamsObj->get("data").extract<Poco::JSON::Object::Ptr>();
+			Data->set("timestamp", OpenWifi::Now());
+			std::ostringstream SS;
+			Data->stringify(SS);
+			Payload = SS.str();
+		}
+		ProcessTelemetryPayload(Payload);
+	}
+
+	void AP_WS_Connection::ProcessTelemetryPayload(const std::string &Payload) {
 		if (!State_.Connected) {
 			poco_warning(Logger_, fmt::format(
 									   "INVALID-PROTOCOL({}): Device '{}' is not following protocol", CId_, CN_));
@@ -15,35 +31,27 @@ namespace OpenWifi {
 			return;
 		}
 		if (TelemetryReporting_) {
-			if (ParamsObj->has("data")) {
-				auto Payload = ParamsObj->get("data").extract<Poco::JSON::Object::Ptr>();
-				Payload->set("timestamp", OpenWifi::Now());
-				std::ostringstream SS;
-				Payload->stringify(SS);
-				auto now=OpenWifi::Now();
-				if (TelemetryWebSocketRefCount_) {
-					if(now<TelemetryWebSocketTimer_) {
-						// std::cout << SerialNumber_ << ": Updating WebSocket telemetry" << std::endl;
-						TelemetryWebSocketPackets_++;
-						State_.websocketPackets = TelemetryWebSocketPackets_;
-						TelemetryStream()->UpdateEndPoint(SerialNumberInt_, SS.str());
-					} else {
-						StopWebSocketTelemetry(CommandManager()->NextRPCId());
-					}
+			auto now=OpenWifi::Now();
+			if (TelemetryWebSocketRefCount_) {
+				if(now<TelemetryWebSocketTimer_) {
+					// std::cout << SerialNumber_ << ": Updating WebSocket telemetry" << std::endl;
+					TelemetryWebSocketPackets_++;
+					State_.websocketPackets = TelemetryWebSocketPackets_;
+					TelemetryStream()->UpdateEndPoint(SerialNumberInt_, Payload);
+				} else {
+					StopWebSocketTelemetry(CommandManager()->NextRPCId());
 				}
-				if (TelemetryKafkaRefCount_) {
-					if(KafkaManager()->Enabled() && now<TelemetryKafkaTimer_) {
-						// std::cout << SerialNumber_ << ": Updating Kafka telemetry" << std::endl;
-						TelemetryKafkaPackets_++;
-						State_.kafkaPackets = TelemetryKafkaPackets_;
-						KafkaManager()->PostMessage(KafkaTopics::DEVICE_TELEMETRY, SerialNumber_,
-													SS.str());
-					} else {
-						StopKafkaTelemetry(CommandManager()->NextRPCId());
-					}
+			}
+			if (TelemetryKafkaRefCount_) {
+				if(KafkaManager()->Enabled() && now<TelemetryKafkaTimer_) {
+					// std::cout << SerialNumber_ << ": Updating Kafka telemetry" << std::endl;
+					TelemetryKafkaPackets_++;
+					State_.kafkaPackets = TelemetryKafkaPackets_;
+					KafkaManager()->PostMessage(KafkaTopics::DEVICE_TELEMETRY, SerialNumber_,
+												Payload);
+				} else {
+					StopKafkaTelemetry(CommandManager()->NextRPCId());
 				}
-			} else {
-				poco_debug(Logger_,fmt::format("TELEMETRY({}): Invalid telemetry packet.",SerialNumber_));
 			}
 		} else {
 			// if we are ignoring telemetry, then close it down on the device.
@@ -51,4 +59,4 @@ namespace OpenWifi {
 			StopTelemetry(CommandManager()->NextRPCId());
 		}
 	}
-}
\ No newline at end of file
+}
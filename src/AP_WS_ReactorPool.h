@@ -4,17 +4,98 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <shared_mutex>
+#include <vector>
 
 #include "Poco/Net/SocketAcceptor.h"
+#include "Poco/Net/SocketReactor.h"
 #include "Poco/Environment.h"
+#include "Poco/String.h"
+
+#include "framework/MicroService.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace OpenWifi {
+
+	//	A reactor that keeps track of what its thread is doing. The event loop stamps every pass, the
+	//	time between two passes beyond the poll timeout was spent dispatching events: that is the lag a
+	//	device sees before its next frame is read. Connections charge the time spent on their frames.
+	class AP_WS_Reactor : public Poco::Net::SocketReactor {
+	  public:
+		static constexpr std::int64_t 	PollTimeout = 250000;		//	microseconds
+
+		AP_WS_Reactor() : Poco::Net::SocketReactor(Poco::Timespan(PollTimeout)) {}
+
+		std::atomic_uint64_t	Connections=0, Frames=0, BusyTime=0;
+
+		//	Charges the reactor with one frame and the time it took.
+		class Busy {
+		  public:
+			explicit Busy(AP_WS_Reactor &R) : R_(R), Start_(Now()) {}
+			~Busy() {
+				R_.Frames++;
+				R_.BusyTime += (uint64_t) (Now() - Start_);
+			}
+		  private:
+			AP_WS_Reactor	&R_;
+			std::int64_t	Start_;
+		};
+
+		//	Worst lag since the last call, including a pass that is still running.
+		inline uint64_t TakeMaxLag() {
+			auto Stalled = Lag(Now() - LastPass_);
+			return std::max(MaxLag_.exchange(0), Stalled);
+		}
+
+	  protected:
+		void onBusy() override { Pass(); Poco::Net::SocketReactor::onBusy(); }
+		void onTimeout() override { Pass(); Poco::Net::SocketReactor::onTimeout(); }
+		void onIdle() override { Pass(); Poco::Net::SocketReactor::onIdle(); }
+
+	  private:
+		std::atomic_int64_t		LastPass_=Now();
+		std::atomic_uint64_t	MaxLag_=0;
+
+		static inline std::int64_t Now() {
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static inline uint64_t Lag(std::int64_t Gap) {
+			return Gap > PollTimeout ? (uint64_t) (Gap - PollTimeout) : 0;
+		}
+
+		inline void Pass() {
+			auto N = Now();
+			auto L = Lag(N - LastPass_.exchange(N));
+			if(L > MaxLag_)
+				MaxLag_ = L;
+		}
+	};
+
 	class AP_WS_ReactorThreadPool {
 	  public:
-		explicit AP_WS_ReactorThreadPool() {
-			NumberOfThreads_ = Poco::Environment::processorCount()*2;
+		enum class Assignment { LeastConnections, LeastLoad, RoundRobin };
+
+		//	What a reactor did between the last two samples. Load is the fraction of that time it spent
+		//	on frames, MaxLag the worst delay of its event loop in microseconds.
+		struct ReactorStats {
+			uint64_t	Connections=0, Frames=0, BusyTime=0, MaxLag=0;
+			double		FramesPerSecond=0.0, Load=0.0;
+		};
+
+		explicit AP_WS_ReactorThreadPool(uint64_t NumberOfThreads, Assignment Policy, bool Affinity) :
+			NumberOfThreads_(NumberOfThreads),
+			Policy_(Policy),
+			Affinity_(Affinity) {
+			if(NumberOfThreads_==0)
+				NumberOfThreads_ = Poco::Environment::processorCount()*2;
 			if(NumberOfThreads_==0)
 				NumberOfThreads_=4;
 		}
@@ -23,19 +104,41 @@ namespace OpenWifi {
 			Stop();
 		}
 
+		static Assignment AssignmentPolicy(const std::string &Policy) {
+			if(Poco::icompare(Policy,"leastload")==0)
+				return Assignment::LeastLoad;
+			if(Poco::icompare(Policy,"roundrobin")==0)
+				return Assignment::RoundRobin;
+			return Assignment::LeastConnections;
+		}
+
+		static const char * AssignmentPolicy(Assignment Policy) {
+			switch(Policy) {
+				case Assignment::LeastLoad: return "leastload";
+				case Assignment::RoundRobin: return "roundrobin";
+				default: return "leastconnections";
+			}
+		}
+
 		void Start() {
+			std::unique_lock		Lock(Mutex_);
 			for (uint64_t i = 0; i < NumberOfThreads_; ++i) {
-				auto NewReactor = std::make_unique<Poco::Net::SocketReactor>();
+				auto NewReactor = std::make_unique<AP_WS_Reactor>();
 				auto NewThread = std::make_unique<Poco::Thread>();
 				NewThread->start(*NewReactor);
 				std::string ThreadName{"ap:react:" + std::to_string(i)};
 				Utils::SetThreadName(*NewThread,ThreadName.c_str());
+				if(Affinity_)
+					Pin(*NewThread, i);
 				Reactors_.emplace_back(std::move(NewReactor));
 				Threads_.emplace_back(std::move(NewThread));
 			}
+			Samples_.assign(Reactors_.size(), ReactorStats{});
+			LastSample_ = std::chrono::steady_clock::now();
 		}
 
 		void Stop() {
+			std::unique_lock		Lock(Mutex_);
 			for (auto &i : Reactors_)
 				i->stop();
 			for (auto &i : Threads_) {
@@ -43,20 +146,106 @@ namespace OpenWifi {
 			}
 			Reactors_.clear();
 			Threads_.clear();
+			Samples_.clear();
+		}
+
+		AP_WS_Reactor &NextReactor() {
+			std::shared_lock		Lock(Mutex_);
+			auto Count = Reactors_.size();
+			auto First = NextReactor_++ % Count;
+			if(Policy_==Assignment::RoundRobin)
+				return *Reactors_[First];
+
+			//	The scan starts at a rotating reactor so that ties do not all land on the first one.
+			auto Best = First;
+			auto BestScore = Score(First);
+			for(std::size_t n=1; n<Count; ++n) {
+				auto i = (First + n) % Count;
+				auto S = Score(i);
+				if(S<BestScore || (S==BestScore && Reactors_[i]->Connections<Reactors_[Best]->Connections)) {
+					Best = i;
+					BestScore = S;
+				}
+			}
+			return *Reactors_[Best];
+		}
+
+		//	Called periodically: turns the counters of each reactor into rates for the last interval.
+		void Sample() {
+			std::unique_lock		Lock(Mutex_);
+			auto Now = std::chrono::steady_clock::now();
+			auto Elapsed = std::chrono::duration<double>(Now - LastSample_).count();
+			if(Elapsed<=0.0)
+				return;
+			LastSample_ = Now;
+
+			double		TotalLoad = 0.0;
+			uint64_t	TotalConnections = 0;
+			for(std::size_t i=0; i<Reactors_.size(); ++i) {
+				auto &R = *Reactors_[i];
+				auto &S = Samples_[i];
+				auto Frames = R.Frames.load(), BusyTime = R.BusyTime.load();
+				S.Connections = R.Connections;
+				S.FramesPerSecond = (double) (Frames - S.Frames) / Elapsed;
+				S.Load = (double) (BusyTime - S.BusyTime) / (Elapsed * 1000000.0);
+				S.MaxLag = R.TakeMaxLag();
+				S.Frames = Frames;
+				S.BusyTime = BusyTime;
+				TotalLoad += S.Load;
+				TotalConnections += S.Connections;
+			}
+			LoadPerConnection_ = TotalConnections ? TotalLoad / (double) TotalConnections : 0.0;
 		}
 
-		Poco::Net::SocketReactor &NextReactor() {
+		[[nodiscard]] std::vector<ReactorStats> Stats() const {
 			std::shared_lock		Lock(Mutex_);
-			NextReactor_++;
-			NextReactor_ %= NumberOfThreads_;
-			return *Reactors_[NextReactor_];
+			return Samples_;
 		}
 
+		[[nodiscard]] inline uint64_t NumberOfReactors() const { return NumberOfThreads_; }
+
 	  private:
-		std::shared_mutex	Mutex_;
-		uint64_t 			NumberOfThreads_;
-		uint64_t 			NextReactor_ = 0;
-		std::vector<std::unique_ptr<Poco::Net::SocketReactor>> Reactors_;
+		mutable std::shared_mutex	Mutex_;
+		uint64_t 					NumberOfThreads_;
+		Assignment					Policy_;
+		bool						Affinity_;
+		std::atomic_uint64_t		NextReactor_ = 0;
+		std::vector<std::unique_ptr<AP_WS_Reactor>> Reactors_;
 		std::vector<std::unique_ptr<Poco::Thread>> Threads_;
+		std::vector<ReactorStats>	Samples_;
+		double						LoadPerConnection_ = 0.0;
+		std::chrono::steady_clock::time_point	LastSample_;
+
+		//	Caller holds the lock. The load measured at the last sample, plus what the connections added
+		//	since are expected to bring, so that a burst of new devices does not all go to one reactor.
+		inline double Score(std::size_t i) const {
+			auto Connections = (double) Reactors_[i]->Connections.load();
+			if(Policy_==Assignment::LeastConnections)
+				return Connections;
+			const auto &S = Samples_[i];
+			return S.Load + (Connections - (double) S.Connections) * LoadPerConnection_;
+		}
+
+		//	Reactor i runs on the i-th processor this process is allowed to use, round robin.
+		static void Pin([[maybe_unused]] Poco::Thread &Thread, [[maybe_unused]] uint64_t Index) {
+#ifdef __linux__
+			cpu_set_t	Allowed;
+			CPU_ZERO(&Allowed);
+			if(sched_getaffinity(0, sizeof(Allowed), &Allowed)!=0 || CPU_COUNT(&Allowed)==0)
+				return;
+			auto Target = Index % (uint64_t) CPU_COUNT(&Allowed);
+			for(int cpu=0; cpu<CPU_SETSIZE; ++cpu) {
+				if(!CPU_ISSET(cpu, &Allowed))
+					continue;
+				if(Target--==0) {
+					cpu_set_t	CPUs;
+					CPU_ZERO(&CPUs);
+					CPU_SET(cpu, &CPUs);
+					pthread_setaffinity_np(Thread.tid(), sizeof(CPUs), &CPUs);
+					return;
+				}
+			}
+#endif
+		}
 	};
-}
\ No newline at end of file
+}
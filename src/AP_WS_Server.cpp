@@ -6,6 +6,9 @@
 //	Arilia Wireless Inc.
 //
 
+#include <limits>
+
+#include "Poco/Environment.h"
 #include "Poco/Net/HTTPHeaderStream.h"
 #include "Poco/JSON/Array.h"
 #include "Poco/Net/Context.h"
@@ -18,10 +21,16 @@
 
 namespace OpenWifi {
 
+	//	Runs on the handshake pool: the device certificate is checked here, so reactors only ever
+	//	see validated devices.
 	void AP_WS_RequestHandler::handleRequest(Poco::Net::HTTPServerRequest &request,
 											 Poco::Net::HTTPServerResponse &response)  {
 		try {
-			AP_WS_Server()->AddConnection(id_,std::make_shared<AP_WS_Connection>(request,response,id_, Logger_, AP_WS_Server()->NextReactor()));
+			auto Connection = std::make_shared<AP_WS_Connection>(request,response,id_, Logger_, AP_WS_Server()->NextReactor());
+			if(!Connection->ValidatedDevice())
+				return;
+			AP_WS_Server()->AddConnection(id_,Connection);
+			Connection->StartReading();
 		} catch (...) {
 			poco_warning(Logger_,"Exception during WS creation");
 		}
@@ -43,8 +52,40 @@ namespace OpenWifi {
 		AllowSerialNumberMismatch_ = MicroService::instance().ConfigGetBool("openwifi.certificates.allowmismatch",true);
 		MismatchDepth_ = MicroService::instance().ConfigGetInt("openwifi.certificates.mismatchdepth",2);
 
-		Reactor_pool_ = std::make_unique<AP_WS_ReactorThreadPool>();
+		auto ReactorAssignment = AP_WS_ReactorThreadPool::AssignmentPolicy(MicroService::instance().ConfigGetString("ucentral.websocket.reactors.assignment","leastconnections"));
+		auto ReactorAffinity = MicroService::instance().ConfigGetBool("ucentral.websocket.reactors.affinity",false);
+		Reactor_pool_ = std::make_unique<AP_WS_ReactorThreadPool>(MicroService::instance().ConfigGetInt("ucentral.websocket.maxreactors",0),
+																  ReactorAssignment, ReactorAffinity);
 		Reactor_pool_->Start();
+		poco_information(Logger(),fmt::format("Reactors: {}, assigned by {}{}.", Reactor_pool_->NumberOfReactors(),
+											  AP_WS_ReactorThreadPool::AssignmentPolicy(ReactorAssignment),
+											  ReactorAffinity ? ", pinned to processors" : ""));
+
+		auto HandshakeThreads = MicroService::instance().ConfigGetInt("ucentral.websocket.handshake.threads",0);
+		if(HandshakeThreads==0)
+			HandshakeThreads = std::max(2u, Poco::Environment::processorCount());
+		auto HandshakeQueue = MicroService::instance().ConfigGetInt("ucentral.websocket.handshake.queue",200);
+		auto HandshakeRate = MicroService::instance().ConfigGetInt("ucentral.websocket.handshake.rate",0);
+		Admission_.Configure(HandshakeRate, HandshakeQueue);
+		//	Poco asserts that the pool may grow to at least its minimum size.
+		DeviceConnectionPool_ = std::make_unique<Poco::ThreadPool>("ws:dev-pool", (int)std::min((uint64_t)2, HandshakeThreads), (int)HandshakeThreads);
+		poco_information(Logger(),fmt::format("Handshakes: {} threads, queue of {}, {} per second.", HandshakeThreads,
+											  HandshakeQueue, HandshakeRate ? std::to_string(HandshakeRate) : "unlimited"));
+
+		TLSSessions_.Configure(MicroService::instance().ConfigGetBool("ucentral.websocket.tls.resumption",true),
+							   MicroService::instance().ConfigGetInt("ucentral.websocket.tls.sessionlifetime",3600),
+							   MicroService::instance().ConfigGetInt("ucentral.websocket.tls.ticketrotation",3600),
+							   MicroService::instance().ConfigGetInt("ucentral.websocket.tls.sessioncachesize",20480));
+
+		DeflateOptions_.Enabled = MicroService::instance().ConfigGetBool("ucentral.websocket.deflate.enable",true);
+		DeflateOptions_.WindowBits = MicroService::instance().ConfigGetInt("ucentral.websocket.deflate.windowbits",12);
+		DeflateOptions_.MemLevel = MicroService::instance().ConfigGetInt("ucentral.websocket.deflate.memlevel",5);
+		DeflateOptions_.ContextTakeover = MicroService::instance().ConfigGetBool("ucentral.websocket.deflate.contexttakeover",true);
+		DeflateOptions_.MinSize = MicroService::instance().ConfigGetInt("ucentral.websocket.deflate.minsize",256);
+		if(DeflateOptions_.Enabled) {
+			poco_information(Logger(),fmt::format("permessage-deflate: up to {} bytes of compression state per connection.",
+												  AP_WS_Deflate::MemoryPerConnection(DeflateOptions_)));
+		}
 
 		for(const auto & Svr : ConfigServersList_ ) {
 
@@ -91,33 +132,34 @@ namespace OpenWifi {
 			Poco::Crypto::RSAKey Key("", Svr.KeyFile(), Svr.KeyFilePassword());
 			Context->usePrivateKey(Key);
 
-			Context->setSessionCacheSize(0);
-			Context->setSessionTimeout(120);
-			Context->flushSessionCache();
-			Context->enableSessionCache(true);
+			TLSSessions_.Attach(*Context, fmt::format("owgw-devices-{}", Svr.Port()));
 			Context->enableExtendedCertificateVerification(false);
-			// Context->disableStatelessSessionResumption();
 			Context->disableProtocols(Poco::Net::Context::PROTO_TLSV1 | Poco::Net::Context::PROTO_TLSV1_1);
 
-			auto WebServerHttpParams = new Poco::Net::HTTPServerParams;
-			WebServerHttpParams->setMaxThreads(50);
-			WebServerHttpParams->setMaxQueued(200);
+			Poco::Net::HTTPServerParams::Ptr WebServerHttpParams = new Poco::Net::HTTPServerParams;
+			WebServerHttpParams->setMaxThreads((int)HandshakeThreads);
+			//	Admission keeps the queue below this, the server itself never has to refuse a connection.
+			WebServerHttpParams->setMaxQueued(HandshakeQueue ? (int)HandshakeQueue + 1 : std::numeric_limits<int>::max());
 			WebServerHttpParams->setKeepAlive(true);
 			WebServerHttpParams->setName("ws:ap_dispatch");
+			Poco::Net::TCPServerConnectionFactory::Ptr ConnectionFactory = new AP_WS_HandshakeConnectionFactory(WebServerHttpParams,
+											Poco::Net::HTTPRequestHandlerFactory::Ptr(new AP_WS_RequestHandlerFactory(Logger())), Admission_);
 
 			if (Svr.Address() == "*") {
 				Poco::Net::IPAddress Addr(Poco::Net::IPAddress::wildcard(
 					Poco::Net::Socket::supportsIPv6() ? Poco::Net::AddressFamily::IPv6
 													  : Poco::Net::AddressFamily::IPv4));
 				Poco::Net::SocketAddress SockAddr(Addr, Svr.Port());
-				auto NewWebServer = std::make_unique<Poco::Net::HTTPServer>(
-					new AP_WS_RequestHandlerFactory(Logger()), DeviceConnectionPool_, Poco::Net::SecureServerSocket(SockAddr, Svr.Backlog(), Context), WebServerHttpParams);
+				auto NewWebServer = std::make_unique<Poco::Net::TCPServer>(
+					ConnectionFactory, *DeviceConnectionPool_, Poco::Net::SecureServerSocket(SockAddr, Svr.Backlog(), Context), WebServerHttpParams);
+				NewWebServer->setConnectionFilter(new AP_WS_AdmissionFilter(Admission_));
 				WebServers_.push_back(std::move(NewWebServer));
 			} else {
 				Poco::Net::IPAddress Addr(Svr.Address());
 				Poco::Net::SocketAddress SockAddr(Addr, Svr.Port());
-				auto NewWebServer = std::make_unique<Poco::Net::HTTPServer>(
-					new AP_WS_RequestHandlerFactory(Logger()), DeviceConnectionPool_, Poco::Net::SecureServerSocket(SockAddr, Svr.Backlog(), Context), WebServerHttpParams);
+				auto NewWebServer = std::make_unique<Poco::Net::TCPServer>(
+					ConnectionFactory, *DeviceConnectionPool_, Poco::Net::SecureServerSocket(SockAddr, Svr.Backlog(), Context), WebServerHttpParams);
+				NewWebServer->setConnectionFilter(new AP_WS_AdmissionFilter(Admission_));
 				WebServers_.push_back(std::move(NewWebServer));
 			}
 		}
@@ -155,49 +197,81 @@ namespace OpenWifi {
 	}
 
 	void AP_WS_Server::onGarbageCollecting([[maybe_unused]] Poco::Timer &timer) {
-		std::lock_guard			Lock(LocalMutex_);
-		if(Garbage_.size()>0) {
-			std::cout << "Removing " << Garbage_.size() << " old connections." << std::endl;
-			Garbage_.clear();
+		auto Removed = CollectGarbage();
+		if(Removed) {
+			std::cout << "Removing " << Removed << " old connections." << std::endl;
 		}
 
-		static std::uint64_t last_log = OpenWifi::Now();
+		TLSSessions_.Rotate();
+		Reactor_pool_->Sample();
 
-		NumberOfConnectedDevices_ = 0;
-		NumberOfConnectingDevices_ = 0;
-		AverageDeviceConnectionTime_ = 0;
-		std::uint64_t	total_connected_time=0;
+		static std::uint64_t last_log = OpenWifi::Now();
 
 		auto now = OpenWifi::Now();
-		for (auto connection=SerialNumbers_.begin(); connection!=SerialNumbers_.end();) {
-
-			if(connection->second.second== nullptr) {
-				connection++;
-				continue;
-			}
-
-			if (connection->second.second->State_.Connected) {
-				NumberOfConnectedDevices_++;
-				total_connected_time += (now - connection->second.second->State_.started);
-				connection++;
-			} else {
-				NumberOfConnectingDevices_++;
-				connection++;
-			}
-		}
-
-		AverageDeviceConnectionTime_ = (NumberOfConnectedDevices_!=0) ? total_connected_time/NumberOfConnectedDevices_ : 0;
+		auto AverageConnectionTime = AverageDeviceConnectionTime();
 		if((now-last_log)>120) {
 			last_log = now;
 			poco_information(Logger(),
 							 fmt::format("Active AP connections: {} Connecting: {} Average connection time: {} seconds",
-										 NumberOfConnectedDevices_, NumberOfConnectingDevices_, AverageDeviceConnectionTime_));
+										 NumberOfConnectedDevices_, NumberOfConnectingDevices_, AverageConnectionTime));
+			auto Handshakes = Admission_.Stats();
+			poco_information(Logger(),
+							 fmt::format("Handshakes: admitted {} rejected {} (rate) {} (busy) in progress {} queued {} "
+										 "average queue time {} ms max queue time {} ms",
+										 Handshakes.Admitted, Handshakes.RejectedRate, Handshakes.RejectedBusy,
+										 Handshakes.InProgress, Handshakes.Queued,
+										 Handshakes.Handshakes ? Handshakes.TotalQueueTime / Handshakes.Handshakes : 0,
+										 Handshakes.MaxQueueTime));
+			std::string Reactors;
+			for(const auto &Reactor:Reactor_pool_->Stats()) {
+				Reactors += fmt::format("{}{}c/{:.0f}fps/{:.0f}%/{}ms", Reactors.empty() ? "" : " ", Reactor.Connections,
+										Reactor.FramesPerSecond, Reactor.Load * 100.0, Reactor.MaxLag / 1000);
+			}
+			poco_information(Logger(),
+							 fmt::format("Reactors (connections/frames per second/busy/max lag): {}", Reactors));
+			if(DeflateOptions_.Enabled) {
+				const auto &Compression = AP_WS_Deflate::Totals();
+				poco_information(Logger(),
+								 fmt::format("Compression: received {} bytes ({} on the wire) sent {} bytes ({} on the wire) errors {}",
+											 Compression.RxRaw.load(), Compression.RxWire.load(),
+											 Compression.TxRaw.load(), Compression.TxWire.load(), Compression.Errors.load()));
+			}
+			if(TLSSessions_.Enabled()) {
+				auto Sessions = TLSSessions_.Stats();
+				poco_information(Logger(),
+								 fmt::format("TLS sessions: handshakes {} resumed {} ({}%) cache misses {} timeouts {} cache full {} "
+											 "tickets issued {} renewed {} unknown key {}",
+											 Sessions.Handshakes, Sessions.Resumed,
+											 Sessions.Handshakes ? Sessions.Resumed * 100 / Sessions.Handshakes : 0,
+											 Sessions.CacheMisses, Sessions.Timeouts, Sessions.CacheFull,
+											 Sessions.TicketsIssued, Sessions.TicketsRenewed, Sessions.TicketsUnknown));
+			}
 		}
 		WebSocketClientNotificationNumberOfConnections(NumberOfConnectedDevices_,
-													   AverageDeviceConnectionTime_,
+													   AverageConnectionTime,
 													   NumberOfConnectingDevices_);
 	}
 
+	void AP_WS_Server::Discard(std::shared_ptr<AP_WS_Connection> Connection) {
+		auto Node = new GarbageNode{std::move(Connection)};
+		Node->Next = Garbage_.load(std::memory_order_relaxed);
+		while(!Garbage_.compare_exchange_weak(Node->Next, Node, std::memory_order_release, std::memory_order_relaxed))
+			;
+	}
+
+	//	Taking the whole list with one exchange leaves nothing for a concurrent push to race with.
+	std::uint64_t AP_WS_Server::CollectGarbage() {
+		auto Node = Garbage_.exchange(nullptr, std::memory_order_acquire);
+		std::uint64_t Removed = 0;
+		while(Node!=nullptr) {
+			auto Next = Node->Next;
+			delete Node;
+			Node = Next;
+			Removed++;
+		}
+		return Removed;
+	}
+
 	void AP_WS_Server::Stop() {
 		poco_information(Logger(),"Stopping...");
 		Running_ = false;
@@ -205,7 +279,7 @@ namespace OpenWifi {
 		Timer_.stop();
 
 		for(auto &server:WebServers_) {
-			server->stopAll();
+			server->stop();
 		}
 		Reactor_pool_->Stop();
 		Reactor_.stop();
@@ -213,93 +287,94 @@ namespace OpenWifi {
 		poco_information(Logger(),"Stopped...");
 	}
 
+	std::shared_ptr<AP_WS_Connection> AP_WS_Server::FindDevice(std::uint64_t SerialNumber) const {
+		auto Shard = ShardIndex(SerialNumber);
+		std::shared_lock		Lock(SerialNumbersMutex_[Shard]);
+		auto Device = SerialNumbers_[Shard].find(SerialNumber);
+		if(Device == SerialNumbers_[Shard].end())
+			return nullptr;
+		return Device->second.second;
+	}
+
 	bool AP_WS_Server::GetStatistics(std::uint64_t SerialNumber, std::string &Statistics) const {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device == SerialNumbers_.end() || Device->second.second==nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return false;
-		Statistics = Device->second.second->LastStats_;
+		Statistics = Device->LastStats_;
 		return true;
 	}
 
 	bool AP_WS_Server::GetState(uint64_t SerialNumber, GWObjects::ConnectionState & State) const {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device == SerialNumbers_.end() || Device->second.second==nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return false;
-		State = Device->second.second->State_;
+		State = Device->State_;
 		return true;
 	}
 
 	bool AP_WS_Server::GetHealthcheck(uint64_t SerialNumber, GWObjects::HealthCheck & CheckData) const {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device == SerialNumbers_.end() || Device->second.second==nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return false;
-
-		CheckData = Device->second.second->LastHealthcheck_;
+		CheckData = Device->LastHealthcheck_;
 		return true;
 	}
 
 	void AP_WS_Server::SetSessionDetails(std::uint64_t connection_id, uint64_t SerialNumber) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Conn = Sessions_.find(connection_id);
-		if(Conn == end(Sessions_))
+		auto Connection = FindConnection(connection_id);
+		if(Connection==nullptr)
 			return;
 
-		auto CurrentSerialNumber = SerialNumbers_.find(SerialNumber);
-		if(	(CurrentSerialNumber==SerialNumbers_.end())	||
-			(CurrentSerialNumber->second.first<connection_id)) {
-			SerialNumbers_[SerialNumber] = std::make_pair(connection_id, Conn->second.first);
-			return;
+		//	the replaced connection (if any) must outlive the lock, its destructor may call back into EndSession.
+		std::shared_ptr<AP_WS_Connection>	Previous;
+		auto Shard = ShardIndex(SerialNumber);
+		std::unique_lock		Lock(SerialNumbersMutex_[Shard]);
+		auto CurrentSerialNumber = SerialNumbers_[Shard].find(SerialNumber);
+		if(CurrentSerialNumber==SerialNumbers_[Shard].end()) {
+			SerialNumbers_[Shard][SerialNumber] = std::make_pair(connection_id, std::move(Connection));
+		} else if(CurrentSerialNumber->second.first<connection_id) {
+			Previous = std::move(CurrentSerialNumber->second.second);
+			CurrentSerialNumber->second = std::make_pair(connection_id, std::move(Connection));
 		}
 	}
 
 	bool AP_WS_Server::EndSession(std::uint64_t session_id, std::uint64_t serial_number) {
-		std::unique_lock G(LocalMutex_);
-
-		auto Session = Sessions_.find(session_id);
-		if(Session==end(Sessions_))
-			return false;
-
-		Garbage_.push_back(Session->second.first);
-
-		auto Device = SerialNumbers_.find(serial_number);
-		if (Device == end(SerialNumbers_)) {
-			Sessions_.erase(Session);
-			return false;
+		{
+			auto SessionShard = ShardIndex(session_id);
+			std::unique_lock	SessionLock(SessionMutex_[SessionShard]);
+			auto Session = Sessions_[SessionShard].find(session_id);
+			if(Session==end(Sessions_[SessionShard]))
+				return false;
+			Discard(std::move(Session->second));
+			Sessions_[SessionShard].erase(Session);
 		}
 
-		if(Device->second.first==session_id) {
-			Sessions_.erase(Session);
-			SerialNumbers_.erase(Device);
-			return true;
+		std::shared_ptr<AP_WS_Connection>	Previous;
+		auto Shard = ShardIndex(serial_number);
+		std::unique_lock		Lock(SerialNumbersMutex_[Shard]);
+		auto Device = SerialNumbers_[Shard].find(serial_number);
+		if (Device == end(SerialNumbers_[Shard]) || Device->second.first!=session_id) {
+			return false;
 		}
-
-		Sessions_.erase(Session);
-		return false;
+		Previous = std::move(Device->second.second);
+		SerialNumbers_[Shard].erase(Device);
+		return true;
 	}
 
 	bool AP_WS_Server::Connected(uint64_t SerialNumber) const {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_) || Device->second.second== nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return false;
-
-		return  Device->second.second->State_.Connected;
+		return Device->State_.Connected;
 	}
 
 	bool AP_WS_Server::SendFrame(uint64_t SerialNumber, const std::string & Payload) const {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==SerialNumbers_.end() || Device->second.second== nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return false;
 
 		try {
-			// std::cout << "Device connection pointer: " << (std::uint64_t) Device->second.second << std::endl;
-			return Device->second.second->Send(Payload);
+			return Device->Send(Payload);
 		} catch (...) {
 			poco_debug(Logger(),fmt::format(": SendFrame: Could not send data to device '{}'", Utils::IntToSerialNumber(SerialNumber)));
 		}
@@ -307,39 +382,31 @@ namespace OpenWifi {
 	}
 
 	void AP_WS_Server::StopWebSocketTelemetry(std::uint64_t RPCID, uint64_t SerialNumber) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_) || Device->second.second==nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return;
-		Device->second.second->StopWebSocketTelemetry(RPCID);
+		Device->StopWebSocketTelemetry(RPCID);
 	}
 
 	void AP_WS_Server::SetWebSocketTelemetryReporting(std::uint64_t RPCID, uint64_t SerialNumber, uint64_t Interval, uint64_t Lifetime) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_) || Device->second.second==nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return;
-		Device->second.second->SetWebSocketTelemetryReporting(RPCID, Interval, Lifetime);
+		Device->SetWebSocketTelemetryReporting(RPCID, Interval, Lifetime);
 	}
 
 	void AP_WS_Server::SetKafkaTelemetryReporting(std::uint64_t RPCID, uint64_t SerialNumber, uint64_t Interval, uint64_t Lifetime) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_) || Device->second.second== nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return;
-		Device->second.second->SetKafkaTelemetryReporting(RPCID, Interval, Lifetime);
+		Device->SetKafkaTelemetryReporting(RPCID, Interval, Lifetime);
 	}
 
 	void AP_WS_Server::StopKafkaTelemetry(std::uint64_t RPCID, uint64_t SerialNumber) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_) || Device->second.second== nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return;
-		Device->second.second->StopKafkaTelemetry(RPCID);
+		Device->StopKafkaTelemetry(RPCID);
 	}
 
 	void AP_WS_Server::GetTelemetryParameters(uint64_t SerialNumber , bool & TelemetryRunning,
@@ -350,29 +417,26 @@ namespace OpenWifi {
 												uint64_t & TelemetryKafkaCount,
 												uint64_t & TelemetryWebSocketPackets,
 												uint64_t & TelemetryKafkaPackets) {
-		std::lock_guard			Lock(LocalMutex_);
-
-		auto Device = SerialNumbers_.find(SerialNumber);
-		if(Device==end(SerialNumbers_)|| Device->second.second== nullptr)
+		auto Device = FindDevice(SerialNumber);
+		if(Device==nullptr)
 			return;
-		Device->second.second->GetTelemetryParameters(TelemetryRunning,
-													  TelemetryInterval,
-													  TelemetryWebSocketTimer,
-													  TelemetryKafkaTimer,
-													  TelemetryWebSocketCount,
-													  TelemetryKafkaCount,
-													  TelemetryWebSocketPackets,
-													  TelemetryKafkaPackets);
+		Device->GetTelemetryParameters(TelemetryRunning,
+									   TelemetryInterval,
+									   TelemetryWebSocketTimer,
+									   TelemetryKafkaTimer,
+									   TelemetryWebSocketCount,
+									   TelemetryKafkaCount,
+									   TelemetryWebSocketPackets,
+									   TelemetryKafkaPackets);
 	}
 
 	bool AP_WS_Server::SendRadiusAccountingData(const std::string & SerialNumber, const unsigned char * buffer, std::size_t size) {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = 		SerialNumbers_.find(Utils::SerialNumberToInt(SerialNumber));
-		if(Device==SerialNumbers_.end() || Device->second.second== nullptr)
+		auto Device = FindDevice(Utils::SerialNumberToInt(SerialNumber));
+		if(Device==nullptr)
 			return false;
 
 		try {
-			return Device->second.second->SendRadiusAccountingData(buffer,size);
+			return Device->SendRadiusAccountingData(buffer,size);
 		} catch (...) {
 			poco_debug(Logger(),fmt::format(": SendRadiusAuthenticationData: Could not send data to device '{}'", SerialNumber));
 		}
@@ -380,13 +444,12 @@ namespace OpenWifi {
 	}
 
 	bool AP_WS_Server::SendRadiusAuthenticationData(const std::string & SerialNumber, const unsigned char * buffer, std::size_t size) {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = 		SerialNumbers_.find(Utils::SerialNumberToInt(SerialNumber));
-		if(Device==SerialNumbers_.end() || Device->second.second== nullptr)
+		auto Device = FindDevice(Utils::SerialNumberToInt(SerialNumber));
+		if(Device==nullptr)
 			return false;
 
 		try {
-			return Device->second.second->SendRadiusAuthenticationData(buffer,size);
+			return Device->SendRadiusAuthenticationData(buffer,size);
 		} catch (...) {
 			poco_debug(Logger(),fmt::format(": SendRadiusAuthenticationData: Could not send data to device '{}'", SerialNumber));
 		}
@@ -394,13 +457,12 @@ namespace OpenWifi {
 	}
 
 	bool AP_WS_Server::SendRadiusCoAData(const std::string & SerialNumber, const unsigned char * buffer, std::size_t size) {
-		std::lock_guard			Lock(LocalMutex_);
-		auto Device = 		SerialNumbers_.find(Utils::SerialNumberToInt(SerialNumber));
-		if(Device==SerialNumbers_.end() || Device->second.second== nullptr)
+		auto Device = FindDevice(Utils::SerialNumberToInt(SerialNumber));
+		if(Device==nullptr)
 			return false;
 
 		try {
-			return Device->second.second->SendRadiusCoAData(buffer,size);
+			return Device->SendRadiusCoAData(buffer,size);
 		} catch (...) {
 			poco_debug(Logger(),fmt::format(": SendRadiusCoAData: Could not send data to device '{}'", SerialNumber));
 		}
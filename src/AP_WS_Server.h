@@ -9,6 +9,8 @@
 #pragma once
 
 #include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include <thread>
 #include <array>
 #include <ctime>
@@ -19,10 +21,14 @@
 #include "Poco/Net/SocketReactor.h"
 #include "Poco/Net/ParallelSocketAcceptor.h"
 #include "Poco/Net/SocketAcceptor.h"
+#include "Poco/Net/TCPServer.h"
 #include "Poco/Timer.h"
 
+#include "AP_WS_Admission.h"
 #include "AP_WS_Connection.h"
+#include "AP_WS_Deflate.h"
 #include "AP_WS_ReactorPool.h"
+#include "AP_WS_TLSSessions.h"
 
 namespace OpenWifi {
 
@@ -94,23 +100,27 @@ namespace OpenWifi {
 			return MismatchDepth_;
 		}
 
+		inline const AP_WS_Deflate::Options & DeflateOptions() const { return DeflateOptions_; }
+
 		inline bool UseProvisioning() const { return LookAtProvisioning_; }
 		inline bool UseDefaults() const { return UseDefaultConfig_; }
 
-		[[nodiscard]] inline Poco::Net::SocketReactor & NextReactor() { return Reactor_pool_->NextReactor(); }
+		[[nodiscard]] inline AP_WS_Reactor & NextReactor() { return Reactor_pool_->NextReactor(); }
 		[[nodiscard]] inline bool Running() const { return Running_; }
 
 		inline void AddConnection(std::uint64_t session_id, std::shared_ptr<AP_WS_Connection> Connection ) {
-			std::lock_guard			Lock(LocalMutex_);
-			Sessions_[session_id] = std::make_pair(std::move(Connection),false);
+			auto Shard = ShardIndex(session_id);
+			std::unique_lock		Lock(SessionMutex_[Shard]);
+			Sessions_[Shard][session_id] = std::move(Connection);
 		}
 
 		inline std::shared_ptr<AP_WS_Connection> FindConnection(std::uint64_t session_id) const {
-			std::lock_guard			Lock(LocalMutex_);
+			auto Shard = ShardIndex(session_id);
+			std::shared_lock		Lock(SessionMutex_[Shard]);
 
-			auto Connection = Sessions_.find(session_id);
-			if(Connection!=end(Sessions_))
-				return Connection->second.first;
+			auto Connection = Sessions_[Shard].find(session_id);
+			if(Connection!=end(Sessions_[Shard]))
+				return Connection->second;
 			return nullptr;
 		}
 
@@ -161,38 +171,88 @@ namespace OpenWifi {
 
 		inline void AverageDeviceStatistics( std::uint64_t & Connections, std::uint64_t & AverageConnectionTime, std::uint64_t & NumberOfConnectingDevices) const {
 			Connections = NumberOfConnectedDevices_;
-			AverageConnectionTime = AverageDeviceConnectionTime_;
+			AverageConnectionTime = AverageDeviceConnectionTime();
 			NumberOfConnectingDevices = NumberOfConnectingDevices_;
 		}
 
+		//	Connections report every change of their state, so the statistics never need a sweep.
+		inline void CountDevice(AP_WS_Connection::DeviceCount From, AP_WS_Connection::DeviceCount To, std::uint64_t Started) {
+			if(From==AP_WS_Connection::DeviceCount::Connecting) {
+				NumberOfConnectingDevices_--;
+			} else if(From==AP_WS_Connection::DeviceCount::Connected) {
+				NumberOfConnectedDevices_--;
+				ConnectedSince_ -= Started;
+			}
+			if(To==AP_WS_Connection::DeviceCount::Connecting) {
+				NumberOfConnectingDevices_++;
+			} else if(To==AP_WS_Connection::DeviceCount::Connected) {
+				ConnectedSince_ += Started;
+				NumberOfConnectedDevices_++;
+			}
+		}
+
+		//	The sum of the start times gives the average age of the connections without visiting them.
+		inline std::uint64_t AverageDeviceConnectionTime() const {
+			std::uint64_t Connected = NumberOfConnectedDevices_;
+			if(Connected==0)
+				return 0;
+			auto AverageStart = ConnectedSince_ / Connected;
+			auto now = OpenWifi::Now();
+			return now > AverageStart ? now - AverageStart : 0;
+		}
+
 	private:
-		mutable std::recursive_mutex								LocalMutex_;
+		//	Sessions and serial numbers are spread over independent shards so that lookups from
+		//	different reactor threads do not contend on a single lock.
+		static constexpr std::uint64_t								NumberOfShards = 64;
+		using SessionMap = std::unordered_map<std::uint64_t, std::shared_ptr<AP_WS_Connection>>;
+		using SerialNumberMap = std::unordered_map<std::uint64_t, std::pair<std::uint64_t,std::shared_ptr<AP_WS_Connection>>>;
+
 		std::unique_ptr<Poco::Crypto::X509Certificate>				IssuerCert_;
-		std::list<std::unique_ptr<Poco::Net::HTTPServer>>			WebServers_;
+		std::list<std::unique_ptr<Poco::Net::TCPServer>>			WebServers_;
 		Poco::Net::SocketReactor									Reactor_;
 		Poco::Thread												ReactorThread_;
 		std::string 												SimulatorId_;
-		Poco::ThreadPool											DeviceConnectionPool_{"ws:dev-pool", 2, 64};
+		std::unique_ptr<Poco::ThreadPool>							DeviceConnectionPool_;
+		AP_WS_Admission												Admission_;
+		AP_WS_TLSSessions											TLSSessions_;
+		AP_WS_Deflate::Options										DeflateOptions_;
 		bool 														LookAtProvisioning_ = false;
 		bool 														UseDefaultConfig_ = true;
 		bool 														SimulatorEnabled_=false;
 		std::unique_ptr<AP_WS_ReactorThreadPool>					Reactor_pool_;
 		std::atomic_bool 											Running_=false;
-		std::map<std::uint64_t,	std::pair<std::shared_ptr<AP_WS_Connection>,bool>>	Sessions_;
-		std::map<std::uint64_t, std::pair<std::uint64_t,std::shared_ptr<AP_WS_Connection>>>	SerialNumbers_;
+		mutable std::array<std::shared_mutex,NumberOfShards>		SessionMutex_;
+		mutable std::array<std::shared_mutex,NumberOfShards>		SerialNumbersMutex_;
+		std::array<SessionMap,NumberOfShards>						Sessions_;
+		std::array<SerialNumberMap,NumberOfShards>					SerialNumbers_;
 		std::atomic_bool 											AllowSerialNumberMismatch_=true;
 		std::atomic_uint64_t 										MismatchDepth_=2;
 
 		std::atomic_uint64_t 										NumberOfConnectedDevices_=0;
-		std::atomic_uint64_t 										AverageDeviceConnectionTime_=0;
 		std::atomic_uint64_t 										NumberOfConnectingDevices_=0;
+		std::atomic_uint64_t 										ConnectedSince_=0;
 
-		std::vector<std::shared_ptr<AP_WS_Connection>>				Garbage_;
+		//	Ended connections cannot be destroyed by the reactor callback that ends them. They are pushed
+		//	on a lock free list and released by the timer, which takes the whole list at once.
+		struct GarbageNode {
+			std::shared_ptr<AP_WS_Connection>						Connection;
+			GarbageNode												*Next=nullptr;
+		};
+		std::atomic<GarbageNode *>									Garbage_=nullptr;
 
 		std::unique_ptr<Poco::TimerCallback<AP_WS_Server>>   		GarbageCollectorCallback_;
 		Poco::Timer                     							Timer_;
 		Poco::Thread												GarbageCollector_;
 
+		static inline std::uint64_t ShardIndex(std::uint64_t Id) {
+			return (Id ^ (Id >> 24)) % NumberOfShards;
+		}
+
+		std::shared_ptr<AP_WS_Connection> FindDevice(std::uint64_t SerialNumber) const;
+		void Discard(std::shared_ptr<AP_WS_Connection> Connection);
+		std::uint64_t CollectGarbage();
+
 		AP_WS_Server() noexcept:
 			SubSystemServer("WebSocketServer", "WS-SVR", "ucentral.websocket") {
 		}
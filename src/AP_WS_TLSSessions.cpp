@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include "AP_WS_TLSSessions.h"
+
+namespace OpenWifi {
+
+	static int SessionsIndex() {
+		static int Index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+		return Index;
+	}
+
+	void AP_WS_TLSSessions::Configure(bool Enabled, uint64_t Lifetime, uint64_t RotationInterval, uint64_t CacheSize) {
+		std::unique_lock	G(Mutex_);
+		Enabled_ = Enabled;
+		Lifetime_ = std::max((uint64_t)1, Lifetime);
+		RotationInterval_ = std::max((uint64_t)60, RotationInterval);
+		CacheSize_ = CacheSize;
+	}
+
+	void AP_WS_TLSSessions::Attach(Poco::Net::Context &Context, const std::string &SessionIdContext) {
+		std::unique_lock	G(Mutex_);
+		if(!Enabled_) {
+			Context.enableSessionCache(false);
+			Context.disableStatelessSessionResumption();
+			return;
+		}
+
+		//	Client certificates are part of the session: without an id context OpenSSL refuses to resume.
+		Context.enableSessionCache(true, SessionIdContext);
+		Context.setSessionCacheSize(CacheSize_);
+		Context.setSessionTimeout((long)Lifetime_);
+
+		if(Keys_.empty())
+			NewKey();
+		auto SSLContext = Context.sslContext();
+		SSL_CTX_set_ex_data(SSLContext, SessionsIndex(), this);
+		SSL_CTX_set_tlsext_ticket_key_cb(SSLContext, &AP_WS_TLSSessions::TicketKeyCallback);
+		Contexts_.push_back(SSLContext);
+	}
+
+	//	Caller holds the lock.
+	bool AP_WS_TLSSessions::NewKey() {
+		TicketKey Key;
+		if(RAND_bytes(Key.Name.data(), (int)Key.Name.size())!=1 ||
+		   RAND_bytes(Key.AESKey.data(), (int)Key.AESKey.size())!=1 ||
+		   RAND_bytes(Key.HMACKey.data(), (int)Key.HMACKey.size())!=1)
+			return false;
+		Keys_.push_front(Key);
+		//	Keep every key that may have sealed a ticket that has not expired yet.
+		auto Keep = (Lifetime_ + RotationInterval_ - 1) / RotationInterval_ + 1;
+		while(Keys_.size()>Keep)
+			Keys_.pop_back();
+		LastRotation_ = Clock::now();
+		return true;
+	}
+
+	void AP_WS_TLSSessions::Rotate() {
+		std::unique_lock	G(Mutex_);
+		if(!Enabled_ || Keys_.empty())
+			return;
+		if(Clock::now() - LastRotation_ < std::chrono::seconds(RotationInterval_))
+			return;
+		NewKey();
+	}
+
+	//	Returns 1 to use the ticket, 2 to use it and issue a fresh one sealed with the current key, 0 when
+	//	the key is unknown (the device falls back to a full handshake) and -1 on error.
+	int AP_WS_TLSSessions::TicketKeyCallback(SSL *S, unsigned char *KeyName, unsigned char *IV, EVP_CIPHER_CTX *Cipher,
+											 HMAC_CTX *HMAC, int Encrypt) {
+		auto Sessions = static_cast<AP_WS_TLSSessions *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(S), SessionsIndex()));
+		if(Sessions==nullptr)
+			return -1;
+
+		std::shared_lock	G(Sessions->Mutex_);
+		if(Sessions->Keys_.empty())
+			return -1;
+
+		if(Encrypt) {
+			const auto &Key = Sessions->Keys_.front();
+			if(RAND_bytes(IV, EVP_MAX_IV_LENGTH)!=1)
+				return -1;
+			std::memcpy(KeyName, Key.Name.data(), Key.Name.size());
+			if(EVP_EncryptInit_ex(Cipher, EVP_aes_256_cbc(), nullptr, Key.AESKey.data(), IV)!=1 ||
+			   HMAC_Init_ex(HMAC, Key.HMACKey.data(), (int)Key.HMACKey.size(), EVP_sha256(), nullptr)!=1)
+				return -1;
+			Sessions->TicketsIssued_++;
+			return 1;
+		}
+
+		auto Key = std::find_if(Sessions->Keys_.begin(), Sessions->Keys_.end(), [KeyName](const TicketKey &K) {
+			return std::memcmp(K.Name.data(), KeyName, K.Name.size())==0;
+		});
+		if(Key==Sessions->Keys_.end()) {
+			Sessions->TicketsUnknown_++;
+			return 0;
+		}
+		if(HMAC_Init_ex(HMAC, Key->HMACKey.data(), (int)Key->HMACKey.size(), EVP_sha256(), nullptr)!=1 ||
+		   EVP_DecryptInit_ex(Cipher, EVP_aes_256_cbc(), nullptr, Key->AESKey.data(), IV)!=1)
+			return -1;
+		if(Key!=Sessions->Keys_.begin()) {
+			Sessions->TicketsRenewed_++;
+			return 2;
+		}
+		return 1;
+	}
+
+	AP_WS_TLSSessions::SessionStats AP_WS_TLSSessions::Stats() const {
+		std::shared_lock	G(Mutex_);
+		SessionStats	Result;
+		for(const auto &i:Contexts_) {
+			Result.Handshakes += SSL_CTX_sess_accept(i);
+			Result.Resumed += SSL_CTX_sess_hits(i);
+			Result.CacheMisses += SSL_CTX_sess_misses(i);
+			Result.Timeouts += SSL_CTX_sess_timeouts(i);
+			Result.CacheFull += SSL_CTX_sess_cache_full(i);
+		}
+		Result.TicketsIssued = TicketsIssued_;
+		Result.TicketsRenewed = TicketsRenewed_;
+		Result.TicketsUnknown = TicketsUnknown_;
+		return Result;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <shared_mutex>
+#include <vector>
+
+#include "Poco/Net/Context.h"
+
+#include <openssl/ssl.h>
+
+namespace OpenWifi {
+
+	//	TLS session resumption for devices. Sessions are kept in the server cache of each listener and
+	//	handed out as session tickets, so a device reconnecting within the lifetime skips the full
+	//	handshake and the certificate chain validation. Ticket keys are generated in memory and rotated:
+	//	tickets sealed with the previous keys are still accepted, and renewed, until they expire.
+	class AP_WS_TLSSessions {
+	  public:
+		struct SessionStats {
+			uint64_t	Handshakes=0, Resumed=0, CacheMisses=0, Timeouts=0, CacheFull=0,
+						TicketsIssued=0, TicketsRenewed=0, TicketsUnknown=0;
+		};
+
+		void Configure(bool Enabled, uint64_t Lifetime, uint64_t RotationInterval, uint64_t CacheSize);
+		void Attach(Poco::Net::Context &Context, const std::string &SessionIdContext);
+		//	Called periodically: generates a new ticket key once the current one is old enough.
+		void Rotate();
+		[[nodiscard]] SessionStats Stats() const;
+		[[nodiscard]] inline bool Enabled() const { return Enabled_; }
+
+	  private:
+		struct TicketKey {
+			std::array<unsigned char,16>	Name{};
+			std::array<unsigned char,32>	AESKey{};
+			std::array<unsigned char,32>	HMACKey{};
+		};
+
+		using Clock = std::chrono::steady_clock;
+
+		mutable std::shared_mutex			Mutex_;
+		bool								Enabled_=true;
+		uint64_t							Lifetime_=3600;
+		uint64_t							RotationInterval_=3600;
+		uint64_t							CacheSize_=20480;
+		//	Newest first: the front key seals new tickets, the others only open existing ones.
+		std::deque<TicketKey>				Keys_;
+		Clock::time_point					LastRotation_;
+		std::vector<SSL_CTX *>				Contexts_;
+		std::atomic_uint64_t				TicketsIssued_=0, TicketsRenewed_=0, TicketsUnknown_=0;
+
+		bool NewKey();
+		static int TicketKeyCallback(SSL *S, unsigned char *KeyName, unsigned char *IV, EVP_CIPHER_CTX *Cipher,
+									 HMAC_CTX *HMAC, int Encrypt);
+	};
+}
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <fstream>
+
+#include "CapabilitiesCache.h"
+
+namespace OpenWifi {
+
+	int CapabilitiesCache::Start() {
+		poco_information(Logger(),"Starting...");
+		auto Interval = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("capabilitiescache.flushinterval", 30));
+		FlushCallback_ = std::make_unique<Poco::TimerCallback<CapabilitiesCache>>(*this, &CapabilitiesCache::onTimer);
+		Timer_.setStartInterval(Interval * 1000);
+		Timer_.setPeriodicInterval(Interval * 1000);
+		Timer_.start(*FlushCallback_, MicroService::instance().TimerPool());
+		return 0;
+	}
+
+	void CapabilitiesCache::Stop() {
+		poco_information(Logger(),"Stopping...");
+		Timer_.stop();
+		Flush();
+		poco_information(Logger(),"Stopped...");
+	}
+
+	void CapabilitiesCache::onTimer([[maybe_unused]] Poco::Timer & timer) {
+		Utils::SetThreadName("caps-flush");
+		Flush();
+	}
+
+	//	The files are serialized under the lock but written outside of it. A file that fails to be
+	//	written is marked dirty again and retried on the next flush.
+	void CapabilitiesCache::Flush() {
+		std::lock_guard	F(FlushMutex_);
+		std::string Platforms, Capabilities;
+		{
+			std::lock_guard	G(Mutex_);
+			if(PlatformsDirty_) {
+				Platforms = nlohmann::json(Platforms_).dump();
+				PlatformsDirty_ = false;
+			}
+			if(CapabilitiesDirty_) {
+				Capabilities = nlohmann::json(Capabilities_).dump();
+				CapabilitiesDirty_ = false;
+			}
+		}
+
+		if(!Platforms.empty() && !Save(PlatformCacheFileName_, Platforms)) {
+			std::lock_guard	G(Mutex_);
+			PlatformsDirty_ = true;
+		}
+		if(!Capabilities.empty() && !Save(CapabilitiesCacheFileName_, Capabilities)) {
+			std::lock_guard	G(Mutex_);
+			CapabilitiesDirty_ = true;
+		}
+	}
+
+	//	Written next to the cache file and renamed over it, so a crash never leaves a truncated cache.
+	bool CapabilitiesCache::Save(const std::string &FileName, const std::string &Contents) {
+		auto TempFileName = FileName + ".tmp";
+		{
+			std::ofstream o(TempFileName, std::ios_base::trunc | std::ios_base::out | std::ios_base::binary);
+			o << Contents;
+			o.flush();
+			if(!o.good()) {
+				poco_warning(Logger(),fmt::format("Could not write {}.", TempFileName));
+				return false;
+			}
+		}
+		if(std::rename(TempFileName.c_str(), FileName.c_str())!=0) {
+			poco_warning(Logger(),fmt::format("Could not replace {}.", FileName));
+			return false;
+		}
+		return true;
+	}
+
+	void CapabilitiesCache::LoadPlatforms() {
+		try {
+			std::ifstream i(PlatformCacheFileName_);
+			nlohmann::json cache;
+			i >> cache;
+
+			for(const auto &[Type,Platform]:cache.items()) {
+				Platforms_[Type] = Platform;
+			}
+		} catch(...) {
+
+		}
+		PlatformsLoaded_ = true;
+	}
+
+	void CapabilitiesCache::LoadCapabilities() {
+		try {
+			std::ifstream i(CapabilitiesCacheFileName_, std::ios_base::binary|std::ios_base::in);
+			nlohmann::json cache;
+			i >> cache;
+
+			for(const auto &[Type,Caps]:cache.items()) {
+				Capabilities_[Type] = Caps;
+			}
+		} catch(...) {
+
+		}
+		CapabilitiesLoaded_ = true;
+	}
+}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "framework/MicroService.h"
+#include "Poco/Timer.h"
 
 #include "nlohmann/json.hpp"
 
@@ -14,7 +15,10 @@ namespace OpenWifi {
 
 	typedef std::map<std::string,nlohmann::json>	CapabilitiesCache_t;
 
-	class CapabilitiesCache {
+	//	Devices report their capabilities on every connection, and most of them report what their
+	//	device type already reported. Add only compares a hash of the capabilities for those, and
+	//	changes are kept in memory and written to disk by a timer, so connecting never touches a file.
+	class CapabilitiesCache : public SubSystemServer {
 	  public:
 
 		static auto instance() {
@@ -22,6 +26,10 @@ namespace OpenWifi {
 			return instance;
 		}
 
+		int Start() override;
+		void Stop() override;
+		void onTimer(Poco::Timer & timer);
+
 		inline void Add(const std::string & DeviceType, const std::string & Platform, const std::string & FullCapabilities) {
 			if(DeviceType.empty() || Platform.empty())
 				return;
@@ -33,22 +41,26 @@ namespace OpenWifi {
 			auto Hint = Platforms_.find(DeviceType);
 			if(Hint==Platforms_.end()) {
 				Platforms_.insert(std::make_pair(DeviceType,P));
-				SavePlatforms();
+				PlatformsDirty_ = true;
 			} else if(Hint->second != P) {
 				Hint->second = P;
-				SavePlatforms();
+				PlatformsDirty_ = true;
 			}
 
 			if(!CapabilitiesLoaded_)
 				LoadCapabilities();
 
-			auto CapHint = Capabilities_.find(DeviceType);
-			if(CapHint==Capabilities_.end()) {
+			auto Hash = std::hash<std::string>{}(FullCapabilities);
+			auto HashHint = Hashes_.find(DeviceType);
+			if(HashHint!=Hashes_.end() && HashHint->second==Hash)
+				return;
+
+			try {
 				Capabilities_[DeviceType] = nlohmann::json::parse(FullCapabilities);
-				SaveCapabilities();
-			} else {
-				CapHint->second = nlohmann::json::parse(FullCapabilities);
-				SaveCapabilities();
+				Hashes_[DeviceType] = Hash;
+				CapabilitiesDirty_ = true;
+			} catch (...) {
+
 			}
 		}
 
@@ -78,7 +90,7 @@ namespace OpenWifi {
 			return Hint->second;
 		}
 
-		inline const CapabilitiesCache_t & AllCapabilities() {
+		inline CapabilitiesCache_t AllCapabilities() {
 			std::lock_guard	G(Mutex_);
 			if(!CapabilitiesLoaded_) {
 				LoadCapabilities();
@@ -86,63 +98,33 @@ namespace OpenWifi {
 			return Capabilities_;
 		}
 
+		void Flush();
+
 	  private:
-		std::recursive_mutex					Mutex_;
 		std::atomic_bool 						PlatformsLoaded_=false;
 		std::atomic_bool 						CapabilitiesLoaded_=false;
+		bool 									PlatformsDirty_=false;
+		bool 									CapabilitiesDirty_=false;
 		std::map<std::string,std::string>		Platforms_;
 		CapabilitiesCache_t						Capabilities_;
+		//	Hash of the capabilities last seen for each device type. Types loaded from disk have none
+		//	until they report again.
+		std::map<std::string,std::size_t>		Hashes_;
+		std::mutex								FlushMutex_;
+		Poco::Timer								Timer_;
+		std::unique_ptr<Poco::TimerCallback<CapabilitiesCache>>	FlushCallback_;
 		std::string 							PlatformCacheFileName_{ MicroService::instance().DataDir()+PlatformCacheFileName };
 		std::string 							CapabilitiesCacheFileName_{ MicroService::instance().DataDir()+CapabilitiesCacheFileName };
 
-		inline void LoadPlatforms() {
-			try {
-				std::ifstream i(PlatformCacheFileName_);
-				nlohmann::json cache;
-				i >> cache;
+		void LoadPlatforms();
+		void LoadCapabilities();
+		bool Save(const std::string &FileName, const std::string &Contents);
 
-				for(const auto &[Type,Platform]:cache.items()) {
-					Platforms_[Type] = Platform;
-				}
-			} catch(...) {
-
-			}
-			PlatformsLoaded_ = true;
-		}
-
-		inline void SavePlatforms() {
-			try {
-				std::ofstream i(PlatformCacheFileName_);
-				nlohmann::json cache(Platforms_);
-				i << cache;
-			} catch (...) {
-
-			}
-		}
-
-		inline void LoadCapabilities() {
-			try {
-				std::ifstream i(CapabilitiesCacheFileName_, std::ios_base::binary|std::ios_base::in);
-				nlohmann::json cache;
-				i >> cache;
-
-				for(const auto &[Type,Caps]:cache.items()) {
-					Capabilities_[Type] = Caps;
-				}
-			} catch(...) {
-
-			}
-			CapabilitiesLoaded_ = true;
-		}
-
-		inline void SaveCapabilities() {
-			try {
-				std::ofstream i(CapabilitiesCacheFileName_, std::ios_base::trunc | std::ios_base::out | std::ios_base::binary );
-				nlohmann::json cache(Capabilities_);
-				i << cache;
-			} catch (...) {
-
-			}
+		CapabilitiesCache() noexcept:
+			SubSystemServer("CapabilitiesCache", "CAPS-CACHE", "capabilitiescache")
+		{
 		}
 	};
-}
\ No newline at end of file
+
+	inline auto CapabilitiesCache() { return CapabilitiesCache::instance(); }
+}
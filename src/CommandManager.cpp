@@ -7,6 +7,7 @@
 //
 
 #include <algorithm>
+#include <thread>
 
 #include "framework/MicroService.h"
 
@@ -21,7 +22,6 @@ namespace OpenWifi {
 
 	void CommandManager::run() {
 		Utils::SetThreadName("cmd:mgr");
-		Running_ = true;
 
 		Poco::AutoPtr<Poco::Notification> NextMsg(ResponseQueue_.waitDequeueNotification());
 		while (NextMsg && Running_) {
@@ -41,26 +41,39 @@ namespace OpenWifi {
 						uint64_t ID = Payload.get(uCentralProtocol::ID);
 						poco_debug(Logger(),fmt::format("({}): Processing {} response.", SerialNumber, ID));
 						if (ID > 1) {
-							std::lock_guard	Lock(LocalMutex_);
-							auto RPC = OutStandingRequests_.find(ID);
-							if (RPC == OutStandingRequests_.end() ||
-								RPC->second.SerialNumber !=
-									Utils::SerialNumberToInt(Resp->SerialNumber_)) {
+							CommandInfo RPC;
+							bool Found = false;
+							{
+								std::lock_guard	Lock(LocalMutex_);
+								auto Entry = OutStandingRequests_.Find(ID);
+								if (Entry != nullptr && Entry->SerialNumber == Utils::SerialNumberToInt(Resp->SerialNumber_)) {
+									RPC = *Entry;
+									OutStandingRequests_.Remove(ID);
+									Found = true;
+								}
+							}
+							if (!Found) {
 								poco_debug(Logger(),
 									fmt::format("({}): RPC {} completed.", SerialNumber, ID));
 							} else {
 								std::chrono::duration<double, std::milli> rpc_execution_time =
 									std::chrono::high_resolution_clock::now() -
-									RPC->second.submitted;
-								StorageService()->CommandCompleted(RPC->second.UUID, Payload,
-																   rpc_execution_time, true);
-								if (RPC->second.rpc_entry) {
-									RPC->second.rpc_entry->set_value(Payload);
+									RPC.submitted;
+								//	Asynchronous commands store their own, fully processed, result.
+								if (RPC.on_completion) {
+									RPC.on_completion(Payload, rpc_execution_time);
+								} else {
+									StorageService()->CommandCompleted(RPC.UUID, Payload,
+																	   rpc_execution_time, true);
+								}
+								if (RPC.rpc_entry) {
+									RPC.rpc_entry->set_value(Payload);
 								}
 								poco_debug(Logger(),
 									fmt::format("({}): Received RPC answer {}. Command={}",
-												SerialNumber, ID, RPC->second.Command));
-								OutStandingRequests_.erase(ID);
+												SerialNumber, ID, RPC.Command));
+								//	The device is free again, its next pending command can go out.
+								MarkReady(RPC.SerialNumber);
 							}
 						}
 					}
@@ -78,16 +91,21 @@ namespace OpenWifi {
     int CommandManager::Start() {
         poco_notice(Logger(),"Starting...");
 
+		DispatchRate_ = std::max((std::uint64_t)1, MicroService::instance().ConfigGetInt("command.manager.dispatch.rate", 100));
+		LoadPendingCommands();
+
+		Running_ = true;
 		ManagerThread.start(*this);
+		SchedulerThread_.start(SchedulerRunner_);
 
 		JanitorCallback_ = std::make_unique<Poco::TimerCallback<CommandManager>>(*this,&CommandManager::onJanitorTimer);
 		JanitorTimer_.setStartInterval( 10000 );
-		JanitorTimer_.setPeriodicInterval(10 * 60 * 1000); // 1 hours
+		JanitorTimer_.setPeriodicInterval(60 * 1000);	//	one wheel bucket
 		JanitorTimer_.start(*JanitorCallback_, MicroService::instance().TimerPool());
 
 		CommandRunnerCallback_ = std::make_unique<Poco::TimerCallback<CommandManager>>(*this,&CommandManager::onCommandRunnerTimer);
 		CommandRunnerTimer_.setStartInterval( 10000 );
-		CommandRunnerTimer_.setPeriodicInterval(30 * 1000); // 1 hours
+		CommandRunnerTimer_.setPeriodicInterval(30 * 1000);
 		CommandRunnerTimer_.start(*CommandRunnerCallback_, MicroService::instance().TimerPool());
 
         return 0;
@@ -95,12 +113,17 @@ namespace OpenWifi {
 
     void CommandManager::Stop() {
         poco_notice(Logger(),"Stopping...");
-		Running_ = false;
+		{
+			std::lock_guard	G(SchedulerMutex_);
+			Running_ = false;
+		}
+		SchedulerReady_.notify_all();
 		JanitorTimer_.stop();
 		CommandRunnerTimer_.stop();
 		ResponseQueue_.wakeUpAll();
 		ManagerThread.wakeUp();
         ManagerThread.join();
+		SchedulerThread_.join();
 		poco_notice(Logger(),"Stopped...");
     }
 
@@ -110,132 +133,282 @@ namespace OpenWifi {
     }
 
 	void CommandManager::onJanitorTimer([[maybe_unused]] Poco::Timer & timer) {
-		std::lock_guard	Lock(LocalMutex_);
 		Utils::SetThreadName("cmd:janitor");
 		Poco::Logger	& MyLogger = Poco::Logger::get("CMD-MGR-JANITOR");
-		auto now = std::chrono::high_resolution_clock::now();
-		for(auto request=OutStandingRequests_.begin();request!=OutStandingRequests_.end();) {
-			std::chrono::duration<double, std::milli> delta = now - request->second.submitted;
-			if(delta > 10min) {
+		std::vector<std::uint64_t>	Freed;
+		std::vector<expiry_type_t>	Expired;
+		std::size_t					Outstanding;
+		{
+			std::lock_guard	Lock(LocalMutex_);
+			OutStandingRequests_.Expire(OpenWifi::Now(), [&](const CommandInfo &Request) {
 				MyLogger.debug(fmt::format("{}: Command={} for {} Timed out.",
-										   request->second.UUID,
-										   request->second.Command,
-										   Utils::IntToSerialNumber(request->second.SerialNumber)));
-				request = OutStandingRequests_.erase(request);
-			} else {
-				++request;
-			}
+										   Request.UUID,
+										   Request.Command,
+										   Utils::IntToSerialNumber(Request.SerialNumber)));
+				Freed.push_back(Request.SerialNumber);
+				if(Request.on_expiry)
+					Expired.push_back(Request.on_expiry);
+			});
+			Outstanding = OutStandingRequests_.size();
 		}
-		poco_information(MyLogger,
-			fmt::format("Outstanding-requests {}", OutStandingRequests_.size()));
+		//	Asynchronous commands record their own outcome, which touches the database: not under the lock.
+		for(auto &OnExpiry:Expired)
+			OnExpiry();
+		for(const auto &SerialNumber:Freed)
+			MarkReady(SerialNumber);
+		poco_debug(MyLogger,
+			fmt::format("Outstanding-requests {}", Outstanding));
 	}
 
 	bool CommandManager::IsCommandRunning(const std::string &C) {
 		std::lock_guard	Lock(LocalMutex_);
-		for (const auto &request : OutStandingRequests_) {
-			if (request.second.UUID == C) {
-				return true;
+		return OutStandingRequests_.HasUUID(C);
+	}
+
+	//	Read a page at a time: a large backlog of pending commands should not be held twice in memory.
+	void CommandManager::LoadPendingCommands() {
+		constexpr uint64_t PageSize = 1000;
+		uint64_t Loaded = 0;
+		while(true) {
+			std::vector<GWObjects::CommandDetails> Commands;
+			if(!StorageService()->GetPendingCommands(Loaded, PageSize, Commands))
+				break;
+			for(const auto &Cmd:Commands)
+				CommandQueued(Cmd, true);
+			Loaded += Commands.size();
+			if(Commands.size()<PageSize)
+				break;
+		}
+		poco_information(Logger(),fmt::format("{} pending commands loaded.", Loaded));
+	}
+
+	void CommandManager::CommandQueued(const GWObjects::CommandDetails &Cmd, bool Pending) {
+		std::uint64_t SerialNumber;
+		try {
+			SerialNumber = Utils::SerialNumberToInt(Cmd.SerialNumber);
+		} catch (...) {
+			return;
+		}
+
+		{
+			std::lock_guard	G(SchedulerMutex_);
+			//	Storing a command replaces any uncompleted command of the same kind for this device.
+			auto Hint = Pending_.find(SerialNumber);
+			if(Hint!=Pending_.end()) {
+				auto &Queue = Hint->second;
+				Queue.erase(std::remove_if(Queue.begin(), Queue.end(),
+										   [&](const PendingCommand &P){ return P.Command==Cmd.Command; }),
+							Queue.end());
+				if(Queue.empty() && !Pending)
+					Pending_.erase(Hint);
+			}
+			if(!Pending)
+				return;
+
+			Pending_[SerialNumber].push_back(PendingCommand{Cmd.UUID, Cmd.Command, Cmd.Submitted, Cmd.RunAt});
+			if(Cmd.RunAt > OpenWifi::Now()) {
+				Deferred_.emplace(Cmd.RunAt, SerialNumber);
+				SchedulerReady_.notify_one();
+				return;
 			}
 		}
-		return false;
+		if(AP_WS_Server()->Connected(SerialNumber))
+			MarkReady(SerialNumber);
 	}
 
-	void CommandManager::onCommandRunnerTimer([[maybe_unused]] Poco::Timer &timer) {
+	void CommandManager::DeviceConnected(std::uint64_t SerialNumber) {
+		MarkReady(SerialNumber);
+	}
+
+	void CommandManager::MarkReady(std::uint64_t SerialNumber) {
+		{
+			std::lock_guard	G(SchedulerMutex_);
+			if(Pending_.find(SerialNumber)==Pending_.end() || !ReadySet_.insert(SerialNumber).second)
+				return;
+			Ready_.push_back(SerialNumber);
+		}
+		SchedulerReady_.notify_one();
+	}
+
+	void CommandManager::RunScheduler() {
 		Utils::SetThreadName("cmd:schdlr");
 		Poco::Logger &MyLogger = Poco::Logger::get("CMD-MGR-SCHEDULER");
 
-		poco_trace(MyLogger,"Scheduler starting.");
+		//	Backlogs are paced at DispatchRate_ commands per second, so a large reconnect wave does
+		//	not flood the devices or the database.
+		const auto Slot = std::chrono::microseconds(1000000 / DispatchRate_);
+		auto NextSlot = std::chrono::steady_clock::now();
+
+		while(Running_) {
+			std::uint64_t SerialNumber;
+			{
+				std::unique_lock	Lock(SchedulerMutex_);
+				SchedulerReady_.wait_for(Lock, std::chrono::seconds(1),
+										 [this]{ return !Ready_.empty() || !Running_; });
+				if(!Running_)
+					break;
+
+				auto Now = OpenWifi::Now();
+				while(!Deferred_.empty() && Deferred_.begin()->first<=Now) {
+					auto Due = Deferred_.begin()->second;
+					Deferred_.erase(Deferred_.begin());
+					if(ReadySet_.insert(Due).second)
+						Ready_.push_back(Due);
+				}
+				if(Ready_.empty())
+					continue;
+				SerialNumber = Ready_.front();
+				Ready_.pop_front();
+				ReadySet_.erase(SerialNumber);
+			}
+
+			auto Now = std::chrono::steady_clock::now();
+			if(NextSlot > Now)
+				std::this_thread::sleep_for(NextSlot - Now);
+
+			try {
+				if(DispatchNext(SerialNumber, MyLogger))
+					NextSlot = std::max(NextSlot, std::chrono::steady_clock::now()) + Slot;
+			} catch (const Poco::Exception &E) {
+				MyLogger.log(E);
+			} catch (...) {
+				poco_warning(MyLogger,"Exception during command processing.");
+			}
+		}
+		poco_information(MyLogger,"Scheduler stopping.");
+	}
+
+	bool CommandManager::DispatchNext(std::uint64_t SerialNumber, Poco::Logger &MyLogger) {
+		//	A disconnected device keeps its commands until it connects again.
+		if(!AP_WS_Server()->Connected(SerialNumber))
+			return false;
+
+		//	A busy device is looked at again when it answers, or by the maintenance sweep.
+		std::string ExecutingCommand, ExecutingUUID;
+		if (CommandRunningForDevice(SerialNumber, ExecutingUUID, ExecutingCommand)) {
+			poco_trace(MyLogger, fmt::format("Serial={} Device is already busy with command {} (Command={}).",
+											 Utils::IntToSerialNumber(SerialNumber), ExecutingUUID, ExecutingCommand));
+			return false;
+		}
+
+		PendingCommand Next;
+		{
+			std::lock_guard	G(SchedulerMutex_);
+			auto Hint = Pending_.find(SerialNumber);
+			if(Hint==Pending_.end())
+				return false;
+			auto &Queue = Hint->second;
+			auto Now = OpenWifi::Now();
+			auto Due = std::find_if(Queue.begin(), Queue.end(), [Now](const PendingCommand &P){ return P.RunAt<=Now; });
+			if(Due==Queue.end())
+				return false;
+			Next = *Due;
+			Queue.erase(Due);
+			if(Queue.empty())
+				Pending_.erase(Hint);
+		}
+
+		auto SerialNumberStr = Utils::IntToSerialNumber(SerialNumber);
+		GWObjects::CommandDetails Cmd;
+		//	The command may have been deleted, expired, or executed elsewhere since it was indexed.
+		if(!StorageService()->GetPendingCommand(Next.UUID, Cmd)) {
+			MarkReady(SerialNumber);
+			return false;
+		}
 
 		try {
+			auto now = OpenWifi::Now();
+			if ((now - Cmd.Submitted) > (1 * 60 * 60)) {
+				poco_information(
+					MyLogger, fmt::format("{}: Serial={} Command={} has expired.",
+										  Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
+				StorageService()->SetCommandTimedOut(Cmd.UUID);
+				MarkReady(SerialNumber);
+				return false;
+			}
 
-			StorageService()->RemovedExpiredCommands();
-			StorageService()->RemoveTimedOutCommands();
+			Poco::JSON::Parser P;
+			bool Sent;
+			poco_information(MyLogger, fmt::format("{}: Serial={} Command={} Preparing execution.",
+											 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
+			auto Params = P.parse(Cmd.Details).extract<Poco::JSON::Object::Ptr>();
+			auto Result = PostCommandDisk(NextRPCId(), Cmd.SerialNumber, Cmd.Command,
+										  *Params, Cmd.UUID, Sent);
+			if (Sent) {
+				StorageService()->SetCommandExecuted(Cmd.UUID);
+				poco_debug(MyLogger,
+					fmt::format("{}: Serial={} Command={} Sent.",
+						 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
+				return true;
+			}
 
-			std::vector<GWObjects::CommandDetails> Commands;
-			if (StorageService()->GetReadyToExecuteCommands(0, 200, Commands)) {
-				poco_trace(MyLogger,fmt::format("Scheduler about to process {} commands.", Commands.size()));
-				for (auto &Cmd : Commands) {
-					if (!Running_) {
-						poco_warning(MyLogger,"Scheduler quitting because service is stopping.");
-						break;
-					}
-					poco_trace(
-						MyLogger, fmt::format("{}: Serial={} Command={} Starting processing.",
-											  Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-					try {
-
-						//	Skip an already running command
-						if(IsCommandRunning(Cmd.UUID))
-							continue;
-
-						auto now = OpenWifi::Now();
-						// 2 hour timeout for commands
-						if ((now - Cmd.Submitted) > (1 * 60 * 60)) {
-							poco_information(
-								MyLogger, fmt::format("{}: Serial={} Command={} has expired.",
-													  Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-							StorageService()->SetCommandTimedOut(Cmd.UUID);
-							continue;
-						}
+			poco_debug(MyLogger,
+				fmt::format("{}: Serial={} Command={} Re-queued command.",
+					 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
+			std::lock_guard	G(SchedulerMutex_);
+			Pending_[SerialNumber].push_front(Next);
+		} catch (const Poco::Exception &E) {
+			poco_debug(MyLogger,
+				fmt::format("{}: Serial={} Command={} Failed. Command marked as completed.",
+						 Cmd.UUID, SerialNumberStr, Cmd.Command));
+			MyLogger.log(E);
+			StorageService()->SetCommandExecuted(Cmd.UUID);
+			MarkReady(SerialNumber);
+		} catch (...) {
+			poco_debug(MyLogger,
+				 fmt::format("{}: Serial={} Command={} Hard failure. Command marked as completed.",
+							 Cmd.UUID, SerialNumberStr, Cmd.Command));
+			StorageService()->SetCommandExecuted(Cmd.UUID);
+			MarkReady(SerialNumber);
+		}
+		return false;
+	}
 
-						if (!AP_WS_Server()->Connected(
-								Utils::SerialNumberToInt(Cmd.SerialNumber))) {
-							poco_trace(
-								MyLogger,
-								fmt::format(
-									"{}: Serial={} Command={} Device is not connected.",
-									Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-							continue;
-						}
+	void CommandManager::onCommandRunnerTimer([[maybe_unused]] Poco::Timer &timer) {
+		Utils::SetThreadName("cmd:maint");
+		Poco::Logger &MyLogger = Poco::Logger::get("CMD-MGR-SCHEDULER");
 
-						std::string ExecutingCommand, ExecutingUUID;
-						if (CommandRunningForDevice(Utils::SerialNumberToInt(Cmd.SerialNumber),
-													ExecutingUUID, ExecutingCommand)) {
-							poco_trace(
-								MyLogger,
-								fmt::format(
-									"{}: Serial={} Command={} Device is already busy with command {} (Command={})."
-									, Cmd.UUID, Cmd.SerialNumber, Cmd.Command,ExecutingUUID, ExecutingCommand));
-							continue;
-						}
+		poco_trace(MyLogger,"Maintenance starting.");
 
-						Poco::JSON::Parser P;
-						bool Sent;
-						poco_information(MyLogger, fmt::format("{}: Serial={} Command={} Preparing execution.",
-														 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-						auto Params = P.parse(Cmd.Details).extract<Poco::JSON::Object::Ptr>();
-						auto Result = PostCommandDisk(NextRPCId(), Cmd.SerialNumber, Cmd.Command,
-													  *Params, Cmd.UUID, Sent);
-						if (Sent) {
-							StorageService()->SetCommandExecuted(Cmd.UUID);
-							poco_debug(MyLogger,
-								fmt::format("{}: Serial={} Command={} Sent.",
-									 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-						} else {
-							poco_debug(MyLogger,
-								fmt::format("{}: Serial={} Command={} Re-queued command.",
-									 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-						}
-					} catch (const Poco::Exception &E) {
-						poco_debug(MyLogger,
-							fmt::format("{}: Serial={} Command={} Failed. Command marked as completed.",
-									 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-						MyLogger.log(E);
-						StorageService()->SetCommandExecuted(Cmd.UUID);
-					} catch (...) {
-						poco_debug(MyLogger,
-							 fmt::format("{}: Serial={} Command={} Hard failure. Command marked as completed.",
-										 Cmd.UUID, Cmd.SerialNumber, Cmd.Command));
-						StorageService()->SetCommandExecuted(Cmd.UUID);
+		try {
+			StorageService()->RemovedExpiredCommands();
+			StorageService()->RemoveTimedOutCommands();
+
+			//	Drop what the database just expired, and collect the devices with due work. This only
+			//	walks the in-memory index: it catches devices whose outstanding command was dropped by
+			//	the janitor instead of being answered.
+			std::vector<std::uint64_t>	Candidates;
+			{
+				std::lock_guard	G(SchedulerMutex_);
+				auto Now = OpenWifi::Now(), Window = Now - (4*60*60);
+				for(auto Hint = Pending_.begin(); Hint!=Pending_.end(); ) {
+					auto &Queue = Hint->second;
+					Queue.erase(std::remove_if(Queue.begin(), Queue.end(),
+											   [Window](const PendingCommand &P){ return P.Submitted<Window; }),
+								Queue.end());
+					if(Queue.empty()) {
+						Hint = Pending_.erase(Hint);
+						continue;
 					}
+					if(ReadySet_.find(Hint->first)==ReadySet_.end() &&
+						std::any_of(Queue.begin(), Queue.end(), [Now](const PendingCommand &P){ return P.RunAt<=Now; }))
+						Candidates.push_back(Hint->first);
+					++Hint;
 				}
 			}
-		} catch (Poco::Exception &E) {
+
+			std::string ExecutingCommand, ExecutingUUID;
+			for(const auto &SerialNumber:Candidates) {
+				if(AP_WS_Server()->Connected(SerialNumber) &&
+					!CommandRunningForDevice(SerialNumber, ExecutingUUID, ExecutingCommand))
+					MarkReady(SerialNumber);
+			}
+			poco_trace(MyLogger,fmt::format("Maintenance done. {} devices re-queued.", Candidates.size()));
+		} catch (const Poco::Exception &E) {
 			MyLogger.log(E);
 		} catch (...) {
-			poco_warning(MyLogger,"Exception during command processing.");
+			poco_warning(MyLogger,"Exception during command maintenance.");
 		}
-		poco_trace(MyLogger,"Scheduler done.");
 	}
 
 	std::shared_ptr<CommandManager::promise_type_t> CommandManager::PostCommand(
@@ -246,7 +419,9 @@ namespace OpenWifi {
 		const std::string &UUID,
 		bool oneway_rpc,
 		bool disk_only,
-		bool & Sent) {
+		bool & Sent,
+		completion_type_t Completion,
+		expiry_type_t Expiry) {
 
 		auto SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
 		Sent=false;
@@ -265,19 +440,28 @@ namespace OpenWifi {
 		CompleteRPC.set(uCentralProtocol::METHOD, Command);
 		CompleteRPC.set(uCentralProtocol::PARAMS, Params);
 		Poco::JSON::Stringifier::stringify(CompleteRPC, ToSend);
-		Idx.rpc_entry = disk_only ? nullptr : std::make_shared<CommandManager::promise_type_t>();
+		Idx.rpc_entry = (disk_only || Completion) ? nullptr : std::make_shared<CommandManager::promise_type_t>();
+		Idx.on_completion = std::move(Completion);
+		Idx.on_expiry = std::move(Expiry);
+
+		//	Registered before it is sent: a device can answer before SendFrame even returns.
+		auto Entry = Idx.rpc_entry;
+		if(!oneway_rpc) {
+			std::lock_guard M(LocalMutex_);
+			OutStandingRequests_.Add(RPCID, Idx);
+		}
 
 		poco_debug(Logger(), fmt::format("{}: Sending command. ID: {}", UUID, RPCID));
 		if(AP_WS_Server()->SendFrame(SerialNumber, ToSend.str())) {
-			if(!oneway_rpc) {
-				std::lock_guard M(Mutex_);
-				OutStandingRequests_[RPCID] = Idx;
-			}
 			poco_debug(Logger(), fmt::format("{}: Sent command. ID: {}", UUID, RPCID));
 			Sent=true;
-			return Idx.rpc_entry;
+			return Entry;
 		}
 
+		if(!oneway_rpc) {
+			std::lock_guard M(LocalMutex_);
+			OutStandingRequests_.Remove(RPCID);
+		}
 		poco_warning(Logger(), fmt::format("{}: Failed to send command. ID: {}", UUID, RPCID));
 		return nullptr;
 	}
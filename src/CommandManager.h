@@ -8,10 +8,16 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <future>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <functional>
 #include <shared_mutex>
 
@@ -20,6 +26,7 @@
 #include "Poco/JSON/Object.h"
 #include "Poco/Net/HTTPServerRequest.h"
 #include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/RunnableAdapter.h"
 #include "Poco/Timer.h"
 
 #include "RESTObjects/RESTAPI_GWobjects.h"
@@ -44,6 +51,8 @@ namespace OpenWifi {
 	    public:
 		  	typedef Poco::JSON::Object 		objtype_t;
 		  	typedef std::promise<objtype_t> promise_type_t;
+			typedef std::function<void(const objtype_t &Answer, std::chrono::duration<double, std::milli> ExecutionTime)> completion_type_t;
+			typedef std::function<void()> expiry_type_t;
 
 			struct CommandInfo {
 				std::uint64_t 	Id=0;
@@ -52,6 +61,32 @@ namespace OpenWifi {
 				std::string 	UUID;
 				std::chrono::time_point<std::chrono::high_resolution_clock> submitted = std::chrono::high_resolution_clock::now();
 				std::shared_ptr<promise_type_t> rpc_entry;
+				completion_type_t 	on_completion;
+				expiry_type_t 		on_expiry;
+			};
+
+			//	Outstanding RPCs indexed by RPC id, command UUID, and device. Expiry uses a wheel of one
+			//	minute buckets, so the janitor only visits the requests that are actually due.
+			class RequestTable {
+			  public:
+				static constexpr std::uint64_t ExpiryMinutes = 10;
+
+				void Add(std::uint64_t Id, const CommandInfo &Info);
+				CommandInfo *Find(std::uint64_t Id);
+				bool Remove(std::uint64_t Id);
+				[[nodiscard]] bool HasUUID(const std::string &UUID) const { return ByUUID_.find(UUID)!=ByUUID_.end(); }
+				[[nodiscard]] const CommandInfo *FindForDevice(std::uint64_t SerialNumber) const;
+				std::vector<CommandInfo> RemoveDevice(std::uint64_t SerialNumber);
+				template <typename F> void Expire(std::uint64_t Now, F OnExpired);
+				[[nodiscard]] inline std::size_t size() const { return Requests_.size(); }
+
+			  private:
+				std::unordered_map<std::uint64_t, CommandInfo>					Requests_;
+				std::unordered_map<std::string, std::uint64_t>					ByUUID_;
+				std::unordered_map<std::uint64_t, std::set<std::uint64_t>>		BySerialNumber_;
+				//	Each bucket holds (RPC id, minute added). Removed requests are skipped lazily.
+				std::array<std::vector<std::pair<std::uint64_t,std::uint64_t>>, ExpiryMinutes + 1>	Wheel_;
+				std::uint64_t													WheelMinute_=0;
 			};
 
 			struct RPCResponse {
@@ -132,9 +167,36 @@ namespace OpenWifi {
 								   false, Sent  );
 			}
 
+			//	The answer is handed to Completion on the RPC processor thread, nobody waits for it. When the
+			//	device never answers, the janitor calls Expiry instead.
+			std::shared_ptr<promise_type_t> PostCommandAsync(
+				uint64_t RPCID,
+				const std::string &SerialNumber,
+				const std::string &Method,
+				const Poco::JSON::Object &Params,
+				const std::string &UUID,
+				completion_type_t Completion,
+				expiry_type_t Expiry,
+				bool & Sent) {
+					return 	PostCommand(RPCID,
+								   SerialNumber,
+								   Method,
+								   Params,
+								   UUID,
+								   false,
+								   false, Sent, std::move(Completion), std::move(Expiry) );
+			}
+
 			bool IsCommandRunning(const std::string &C);
 
+			//	Pending commands are kept in memory per device. The scheduler thread only looks at a
+			//	device when something happens to it: it connects, a command is queued for it, it answers
+			//	the command it was busy with, or a deferred command becomes due.
+			void DeviceConnected(std::uint64_t SerialNumber);
+			void CommandQueued(const GWObjects::CommandDetails &Cmd, bool Pending);
+
 			void run() override;
+			void RunScheduler();
 
 			static auto instance() {
 			    static auto instance_ = new CommandManager;
@@ -149,44 +211,66 @@ namespace OpenWifi {
 
 			void RemovePendingCommand(std::uint64_t Id) {
 				std::unique_lock	Lock(LocalMutex_);
-				OutStandingRequests_.erase(Id);
+				OutStandingRequests_.Remove(Id);
 			}
 
 			inline bool CommandRunningForDevice(std::uint64_t SerialNumber, std::string & uuid, std::string &command) {
 				std::lock_guard	Lock(LocalMutex_);
-
-				for(const auto &[Request,Command]:OutStandingRequests_) {
-					if(Command.SerialNumber==SerialNumber) {
-						uuid = Command.UUID;
-						command = Command.Command;
-						return true;
-					}
-				}
-				return false;
+				auto Command = OutStandingRequests_.FindForDevice(SerialNumber);
+				if(Command==nullptr)
+					return false;
+				uuid = Command->UUID;
+				command = Command->Command;
+				return true;
 			}
 
+			//	A reconnecting device will never answer what it was sent before: asynchronous commands get
+			//	the same outcome as when they expire. They record it in the database, so not under the lock.
 			inline void ClearQueue(std::uint64_t SerialNumber) {
-				std::lock_guard	Lock(LocalMutex_);
-				for(auto Request = OutStandingRequests_.begin(); Request != OutStandingRequests_.end() ; ) {
-					if(Request->second.SerialNumber==SerialNumber)
-						Request = OutStandingRequests_.erase(Request);
-					else
-						++Request;
+				std::vector<CommandInfo>	Removed;
+				{
+					std::lock_guard	Lock(LocalMutex_);
+					Removed = OutStandingRequests_.RemoveDevice(SerialNumber);
+				}
+				for(auto &Request:Removed) {
+					if(Request.on_expiry)
+						Request.on_expiry();
 				}
 			}
 
 	    private:
+			struct PendingCommand {
+				std::string 	UUID;
+				std::string 	Command;
+				std::uint64_t 	Submitted=0;
+				std::uint64_t 	RunAt=0;
+			};
+
 		  	mutable std::recursive_mutex			LocalMutex_;
 			std::atomic_bool 						Running_ = false;
 			Poco::Thread    						ManagerThread;
 			std::atomic_uint64_t 					Id_=3;	//	do not start @1. We ignore ID=1 & 0 is illegal..
-			std::map<std::uint64_t , CommandInfo>	OutStandingRequests_;
+			RequestTable							OutStandingRequests_;
 			Poco::Timer                     		JanitorTimer_;
 			std::unique_ptr<Poco::TimerCallback<CommandManager>>   JanitorCallback_;
 			Poco::Timer                     		CommandRunnerTimer_;
 			std::unique_ptr<Poco::TimerCallback<CommandManager>>   CommandRunnerCallback_;
 			Poco::NotificationQueue					ResponseQueue_;
 
+			std::mutex								SchedulerMutex_;
+			std::condition_variable					SchedulerReady_;
+			std::unordered_map<std::uint64_t, std::deque<PendingCommand>>	Pending_;	//	per device, in submission order
+			std::set<std::pair<std::uint64_t,std::uint64_t>>	Deferred_;			//	RunAt, SerialNumber
+			std::deque<std::uint64_t>				Ready_;
+			std::set<std::uint64_t>					ReadySet_;
+			std::uint64_t							DispatchRate_=100;
+			Poco::Thread							SchedulerThread_;
+			Poco::RunnableAdapter<CommandManager>	SchedulerRunner_{*this, &CommandManager::RunScheduler};
+
+			void LoadPendingCommands();
+			void MarkReady(std::uint64_t SerialNumber);
+			bool DispatchNext(std::uint64_t SerialNumber, Poco::Logger &MyLogger);
+
 			std::shared_ptr<promise_type_t> PostCommand(
 				uint64_t RPCID,
 				const std::string &SerialNumber,
@@ -195,13 +279,96 @@ namespace OpenWifi {
 				const std::string &UUID,
 				bool oneway_rpc,
 				bool disk_only,
-				bool & Sent);
+				bool & Sent,
+				completion_type_t Completion = nullptr,
+				expiry_type_t Expiry = nullptr);
 
 			CommandManager() noexcept:
 				SubSystemServer("CommandManager", "CMD-MGR", "command.manager") {
 			}
 	};
 
+	inline void CommandManager::RequestTable::Add(std::uint64_t Id, const CommandInfo &Info) {
+		Remove(Id);
+		Requests_[Id] = Info;
+		ByUUID_[Info.UUID] = Id;
+		BySerialNumber_[Info.SerialNumber].insert(Id);
+		auto Minute = OpenWifi::Now() / 60;
+		Wheel_[Minute % Wheel_.size()].emplace_back(Id, Minute);
+	}
+
+	inline CommandManager::CommandInfo *CommandManager::RequestTable::Find(std::uint64_t Id) {
+		auto Hint = Requests_.find(Id);
+		return Hint==Requests_.end() ? nullptr : &Hint->second;
+	}
+
+	inline bool CommandManager::RequestTable::Remove(std::uint64_t Id) {
+		auto Hint = Requests_.find(Id);
+		if(Hint==Requests_.end())
+			return false;
+		auto UUID = ByUUID_.find(Hint->second.UUID);
+		if(UUID!=ByUUID_.end() && UUID->second==Id)
+			ByUUID_.erase(UUID);
+		auto Device = BySerialNumber_.find(Hint->second.SerialNumber);
+		if(Device!=BySerialNumber_.end()) {
+			Device->second.erase(Id);
+			if(Device->second.empty())
+				BySerialNumber_.erase(Device);
+		}
+		Requests_.erase(Hint);
+		return true;
+	}
+
+	inline const CommandManager::CommandInfo *CommandManager::RequestTable::FindForDevice(std::uint64_t SerialNumber) const {
+		auto Device = BySerialNumber_.find(SerialNumber);
+		if(Device==BySerialNumber_.end() || Device->second.empty())
+			return nullptr;
+		auto Hint = Requests_.find(*Device->second.begin());
+		return Hint==Requests_.end() ? nullptr : &Hint->second;
+	}
+
+	inline std::vector<CommandManager::CommandInfo> CommandManager::RequestTable::RemoveDevice(std::uint64_t SerialNumber) {
+		std::vector<CommandInfo>	Removed;
+		auto Device = BySerialNumber_.find(SerialNumber);
+		if(Device==BySerialNumber_.end())
+			return Removed;
+		auto Ids = std::move(Device->second);
+		BySerialNumber_.erase(Device);
+		for(const auto &Id:Ids) {
+			auto Hint = Requests_.find(Id);
+			if(Hint!=Requests_.end())
+				Removed.push_back(Hint->second);
+			Remove(Id);
+		}
+		return Removed;
+	}
+
+	template <typename F> void CommandManager::RequestTable::Expire(std::uint64_t Now, F OnExpired) {
+		auto Minute = Now / 60;
+		if(Minute < ExpiryMinutes)
+			return;
+		auto Due = Minute - ExpiryMinutes;
+		//	Never walk more than one turn of the wheel, whatever the janitor's lag.
+		auto From = std::max(WheelMinute_ + 1, Due + 1 >= Wheel_.size() ? Due + 1 - Wheel_.size() : 0);
+		for(auto M = From; M <= Due; M++) {
+			auto &Bucket = Wheel_[M % Wheel_.size()];
+			std::vector<std::pair<std::uint64_t,std::uint64_t>> Keep;
+			for(const auto &[Id,Added]:Bucket) {
+				if(Added > Due) {
+					Keep.emplace_back(Id, Added);
+					continue;
+				}
+				auto Hint = Requests_.find(Id);
+				if(Hint==Requests_.end())
+					continue;
+				OnExpired(Hint->second);
+				Remove(Id);
+			}
+			Bucket = std::move(Keep);
+		}
+		WheelMinute_ = std::max(WheelMinute_, Due);
+	}
+
 	inline auto CommandManager() { return CommandManager::instance(); }
 
 }  // namespace
@@ -15,8 +15,10 @@
 
 
 #include "AP_WS_Server.h"
+#include "CapabilitiesCache.h"
 #include "CommandManager.h"
 #include "Daemon.h"
+#include "DeviceHistory.h"
 #include "FileUploader.h"
 #include "FindCountry.h"
 #include "OUIServer.h"
@@ -24,6 +26,7 @@
 #include "SerialNumberCache.h"
 #include "StorageArchiver.h"
 #include "StorageService.h"
+#include "StorageWriteBehind.h"
 #include "TelemetryStream.h"
 #include "VenueBroadcaster.h"
 #include "framework/ConfigurationValidator.h"
@@ -38,6 +41,9 @@ namespace OpenWifi {
 								   vDAEMON_BUS_TIMER,
 								   SubSystemVec{
 										StorageService(),
+										StorageWriteBehind(),
+										DeviceHistory(),
+										CapabilitiesCache(),
 										SerialNumberCache(),
 										ConfigurationValidator(),
 								   		WebSocketClientServer(),
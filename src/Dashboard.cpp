@@ -3,17 +3,264 @@
 //
 
 #include "Dashboard.h"
+#include "OUIServer.h"
 #include "StorageService.h"
 
 namespace OpenWifi {
+
+	static const char * ComputeCertificateTag( GWObjects::CertificateValidation V) {
+		switch(V) {
+		case GWObjects::NO_CERTIFICATE: return "no certificate";
+		case GWObjects::VALID_CERTIFICATE: return "non TIP certificate";
+		case GWObjects::MISMATCH_SERIAL: return "serial mismatch";
+		case GWObjects::VERIFIED: return "verified";
+		}
+		return "unknown";
+	}
+
+	static const uint64_t SECONDS_MONTH = 30*24*60*60;
+	static const uint64_t SECONDS_WEEK = 7*24*60*60;
+	static const uint64_t SECONDS_DAY = 1*24*60*60;
+	static const uint64_t SECONDS_HOUR = 60*60;
+
+	static const char * ComputeUpLastContactTag(uint64_t T1, uint64_t Now) {
+		uint64_t T = Now > T1 ? Now - T1 : 0;
+		if( T>SECONDS_MONTH) return ">month";
+		if( T>SECONDS_WEEK) return ">week";
+		if( T>SECONDS_DAY) return ">day";
+		if( T>SECONDS_HOUR) return ">hour";
+		return "now";
+	}
+
+	static const char * ComputeSanityTag(uint64_t T) {
+		if( T==100) return "100%";
+		if( T>90) return ">90%";
+		if( T>60) return ">60%";
+		return "<60%";
+	}
+
+	static const char * ComputeUpTimeTag(uint64_t T) {
+		if( T>SECONDS_MONTH) return ">month";
+		if( T>SECONDS_WEEK) return ">week";
+		if( T>SECONDS_DAY) return ">day";
+		if( T>SECONDS_HOUR) return ">hour";
+		return "now";
+	}
+
+	static const char * ComputeLoadTag(uint64_t T) {
+		auto V=100.0*((float)T/65536.0);
+		if(V<5.0) return "< 5%";
+		if(V<25.0) return "< 25%";
+		if(V<50.0) return "< 50%";
+		if(V<75.0) return "< 75%";
+		return ">75%";
+	}
+
+	static const char * ComputeUsedMemoryTag(uint64_t Free, uint64_t Total) {
+		if(Total==0)
+			return "< 5%";
+		auto V = 100.0 * ((float)(Total-Free)/(float(Total)));
+		if(V<5.0) return "< 5%";
+		if(V<25.0) return "< 25%";
+		if(V<50.0) return "< 50%";
+		if(V<75.0) return "< 75%";
+		return ">75%";
+	}
+
+	template <typename M, typename K> static void AdjustCount(M &Map, const K &Key, bool Add, uint64_t Count=1) {
+		if(Count==0)
+			return;
+		if(Add) {
+			Map[Key] += Count;
+			return;
+		}
+		auto It = Map.find(Key);
+		if(It==Map.end())
+			return;
+		if(It->second<=Count)
+			Map.erase(It);
+		else
+			It->second -= Count;
+	}
+
+	static void AdjustTag(Types::CountedMap &Map, const char *Tag, bool Add) {
+		if(Tag!=nullptr)
+			AdjustCount(Map, std::string(Tag), Add);
+	}
+
+	void DeviceDashboard::Apply(const DeviceEntry &E, bool Add) {
+		if(!E.Known)
+			return;
+
+		if(Add)
+			DB_.numberOfDevices++;
+		else if(DB_.numberOfDevices)
+			DB_.numberOfDevices--;
+
+		AdjustCount(OUIs_, E.OUI, Add);
+		AdjustCount(DB_.deviceType, E.DeviceType, Add);
+		AdjustTag(DB_.status, E.Connected ? "connected" : "not connected", Add);
+		if(!E.Connected)
+			return;
+
+		AdjustTag(DB_.certificates, E.Certificate, Add);
+		AdjustCount(LastContacts_, E.LastContact / 60, Add);
+		AdjustTag(DB_.healths, E.Health, Add);
+		if(!E.HasStats)
+			return;
+
+		AdjustTag(DB_.upTimes, E.UpTime, Add);
+		AdjustTag(DB_.memoryUsed, E.Memory, Add);
+		AdjustTag(DB_.load1, E.Load1, Add);
+		AdjustTag(DB_.load5, E.Load5, Add);
+		AdjustTag(DB_.load15, E.Load15, Add);
+		AdjustCount(DB_.associations, std::string("2G"), Add, E.Associations_2G);
+		AdjustCount(DB_.associations, std::string("5G"), Add, E.Associations_5G);
+	}
+
+	template <typename F> void DeviceDashboard::Update(const std::string &SerialNumber, F Change) {
+		uint64_t SerialNumberInt;
+		try {
+			SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
+		} catch (...) {
+			return;
+		}
+
+		std::lock_guard	G(Mutex_);
+		auto Hint = Devices_.find(SerialNumberInt);
+		if(Hint==Devices_.end()) {
+			Hint = Devices_.emplace(SerialNumberInt, DeviceEntry{}).first;
+			Hint->second.OUI = Utils::SerialNumberToOUI(SerialNumber);
+		}
+		auto &Entry = Hint->second;
+		Apply(Entry, false);
+		Change(Entry);
+		Apply(Entry, true);
+		if(!Entry.Known && !Entry.Connected)
+			Devices_.erase(Hint);
+	}
+
+	void DeviceDashboard::AddDevice(const std::string &SerialNumber, const std::string &DeviceType) {
+		Update(SerialNumber, [&](DeviceEntry &E) {
+			E.Known = true;
+			E.DeviceType = DeviceType;
+		});
+	}
+
+	void DeviceDashboard::RemoveDevice(const std::string &SerialNumber) {
+		Update(SerialNumber, [](DeviceEntry &E) { E.Known = false; });
+	}
+
+	void DeviceDashboard::DeviceConnected(const std::string &SerialNumber, const std::string &DeviceType,
+										  GWObjects::CertificateValidation Certificate) {
+		Update(SerialNumber, [&](DeviceEntry &E) {
+			if(!DeviceType.empty())
+				E.DeviceType = DeviceType;
+			E.Connected = true;
+			E.HasStats = false;
+			E.Certificate = ComputeCertificateTag(Certificate);
+			E.LastContact = OpenWifi::Now();
+			E.Health = ComputeSanityTag(100);
+		});
+	}
+
+	void DeviceDashboard::DeviceDisconnected(const std::string &SerialNumber) {
+		Update(SerialNumber, [](DeviceEntry &E) {
+			E.Connected = E.HasStats = false;
+			E.Certificate = E.Health = nullptr;
+			E.LastContact = 0;
+			E.UpTime = E.Memory = E.Load1 = E.Load5 = E.Load15 = nullptr;
+			E.Associations_2G = E.Associations_5G = 0;
+		});
+	}
+
+	void DeviceDashboard::StateUpdated(const std::string &SerialNumber, const Poco::JSON::Object::Ptr &State,
+									   uint64_t Associations_2G, uint64_t Associations_5G) {
+		const char *UpTime=nullptr, *Memory=nullptr, *Load1=nullptr, *Load5=nullptr, *Load15=nullptr;
+		try {
+			if(State->has("unit")) {
+				auto Unit = State->getObject("unit");
+				if (Unit->has("uptime")) {
+					UpTime = ComputeUpTimeTag(Unit->get("uptime"));
+				}
+				if (Unit->has("memory")) {
+					auto MemoryObj = Unit->getObject("memory");
+					uint64_t Free = MemoryObj->get("free");
+					uint64_t Total = MemoryObj->get("total");
+					Memory = ComputeUsedMemoryTag(Free, Total);
+				}
+				if (Unit->has("load")) {
+					auto Load = Unit->getArray("load");
+					Load1 = ComputeLoadTag(Load->getElement<uint64_t>(0));
+					Load5 = ComputeLoadTag(Load->getElement<uint64_t>(1));
+					Load15 = ComputeLoadTag(Load->getElement<uint64_t>(2));
+				}
+			}
+		} catch (const Poco::Exception &) {
+			return;
+		}
+
+		Update(SerialNumber, [&](DeviceEntry &E) {
+			if(!E.Connected)
+				return;
+			E.HasStats = true;
+			E.LastContact = OpenWifi::Now();
+			E.UpTime = UpTime;
+			E.Memory = Memory;
+			E.Load1 = Load1;
+			E.Load5 = Load5;
+			E.Load15 = Load15;
+			E.Associations_2G = Associations_2G;
+			E.Associations_5G = Associations_5G;
+		});
+	}
+
+	void DeviceDashboard::HealthcheckUpdated(const std::string &SerialNumber, uint64_t Sanity) {
+		Update(SerialNumber, [&](DeviceEntry &E) {
+			if(!E.Connected)
+				return;
+			E.LastContact = OpenWifi::Now();
+			E.Health = ComputeSanityTag(Sanity);
+		});
+	}
+
 	void DeviceDashboard::Create() {
 		uint64_t Now = OpenWifi::Now();
 
-		if(LastRun_==0 || (Now-LastRun_)>120) {
-			DB_.reset();
-			StorageService()->AnalyzeCommands(DB_.commands);
-			StorageService()->AnalyzeDevices(DB_);
+		{
+			std::lock_guard	G(Mutex_);
+			if(LastRun_!=0 && (Now-LastRun_)<=120)
+				return;
 			LastRun_ = Now;
 		}
+
+		//	Commands are the only figures still coming from the database, and only as a grouped count.
+		Types::CountedMap	Commands;
+		StorageService()->AnalyzeCommands(Commands);
+		std::lock_guard	G(Mutex_);
+		DB_.commands = std::move(Commands);
+	}
+
+	GWObjects::Dashboard DeviceDashboard::Report() const {
+		GWObjects::Dashboard 		Result;
+		std::map<uint64_t,uint64_t>	OUIs, LastContacts;
+		{
+			std::lock_guard	G(Mutex_);
+			Result = DB_;
+			OUIs = OUIs_;
+			LastContacts = LastContacts_;
+		}
+
+		auto Now = OpenWifi::Now();
+		Result.lastContact.clear();
+		for(const auto &[Minute,Count]:LastContacts)
+			UpdateCountedMap(Result.lastContact, ComputeUpLastContactTag(Minute * 60, Now), Count);
+
+		//	Vendors are resolved at report time so an updated OUI database applies to every device.
+		Result.vendors.clear();
+		for(const auto &[OUI,Count]:OUIs)
+			UpdateCountedMap(Result.vendors, OUIServer()->GetManufacturer(OUI), Count);
+		Result.snapshot = Now;
+		return Result;
 	}
 }
@@ -4,19 +4,59 @@
 
 #pragma once
 
+#include <mutex>
+#include <unordered_map>
+
+#include "Poco/JSON/Object.h"
+
 #include "RESTObjects//RESTAPI_GWobjects.h"
 #include "framework/OpenWifiTypes.h"
 
 namespace OpenWifi {
+
+	//	The dashboard is maintained incrementally: each device keeps the tags it currently contributes,
+	//	and every event removes the old contribution before adding the new one. Producing a report
+	//	never touches the Devices table or the connection registry.
 	class DeviceDashboard {
 	  public:
 			DeviceDashboard() { DB_.reset(); }
 			void Create();
-			[[nodiscard]] const GWObjects::Dashboard & Report() const { return DB_;}
+			[[nodiscard]] GWObjects::Dashboard Report() const;
+
+			void AddDevice(const std::string &SerialNumber, const std::string &DeviceType);
+			void RemoveDevice(const std::string &SerialNumber);
+			void DeviceConnected(const std::string &SerialNumber, const std::string &DeviceType,
+								 GWObjects::CertificateValidation Certificate);
+			void DeviceDisconnected(const std::string &SerialNumber);
+			void StateUpdated(const std::string &SerialNumber, const Poco::JSON::Object::Ptr &State,
+							  uint64_t Associations_2G, uint64_t Associations_5G);
+			void HealthcheckUpdated(const std::string &SerialNumber, uint64_t Sanity);
+
 	  private:
-			GWObjects::Dashboard 	DB_;
-			uint64_t 				LastRun_=0;
-			inline void Reset() { DB_.reset(); }
+			//	Tags point to string literals, so a device entry stays small on large fleets.
+			struct DeviceEntry {
+				uint64_t 		OUI=0;
+				std::string 	DeviceType;
+				bool 			Known=false;
+				bool 			Connected=false;
+				bool 			HasStats=false;
+				uint64_t 		LastContact=0;
+				const char 		*Certificate=nullptr, *Health=nullptr;
+				const char 		*UpTime=nullptr, *Memory=nullptr, *Load1=nullptr, *Load5=nullptr, *Load15=nullptr;
+				uint64_t 		Associations_2G=0, Associations_5G=0;
+			};
+
+			mutable std::mutex 							Mutex_;
+			GWObjects::Dashboard 						DB_;
+			std::map<uint64_t,uint64_t>					OUIs_;
+			//	Connected devices per minute of last contact: how long ago that was depends on when the
+			//	report is made, so the buckets are only computed then.
+			std::map<uint64_t,uint64_t>					LastContacts_;
+			std::unordered_map<uint64_t,DeviceEntry>	Devices_;
+			uint64_t 									LastRun_=0;
+
+			void Apply(const DeviceEntry &E, bool Add);
+			template <typename F> void Update(const std::string &SerialNumber, F Change);
 	};
 }
 
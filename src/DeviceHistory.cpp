@@ -0,0 +1,211 @@
+#include "DeviceHistory.h"
+
+namespace OpenWifi {
+
+	int DeviceHistory::Start() {
+		poco_information(Logger(),"Starting...");
+		Enabled_ = MicroService::instance().ConfigGetBool("devicehistory.enable", true);
+		MaxRecords_ = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("devicehistory.records", 32));
+		ShardBudget_ = MicroService::instance().ConfigGetInt("devicehistory.memory", 256) * 1024 * 1024 / NumberOfShards;
+		return 0;
+	}
+
+	void DeviceHistory::Stop() {
+		poco_information(Logger(),"Stopping...");
+		poco_information(Logger(),fmt::format("Queries answered from memory: {} from the database: {}", Hits_.load(), Misses_.load()));
+		Enabled_ = false;
+		Clear();
+		poco_information(Logger(),"Stopped...");
+	}
+
+	template <typename T> static inline uint64_t RecordSize(const T &Record) {
+		return sizeof(T) + Record.SerialNumber.capacity() + Record.Data.capacity();
+	}
+
+	template <typename T> void DeviceHistory::Add(const std::string &SerialNumber, Ring<T> Entry::*Which, const T &Record) {
+		if(!Enabled_ || ShardBudget_==0)
+			return;
+
+		uint64_t SerialNumberInt;
+		try {
+			SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
+		} catch (...) {
+			return;
+		}
+
+		auto &S = Shards_[SerialNumberInt % NumberOfShards];
+		std::lock_guard	G(S.Mutex);
+		auto Hint = S.Devices.find(SerialNumberInt);
+		if(Hint==S.Devices.end()) {
+			Hint = S.Devices.emplace(SerialNumberInt, Entry{}).first;
+			S.LRU.push_front(SerialNumberInt);
+			Hint->second.LRU = S.LRU.begin();
+		} else {
+			S.LRU.splice(S.LRU.begin(), S.LRU, Hint->second.LRU);
+		}
+
+		auto &E = Hint->second;
+		auto &R = E.*Which;
+		auto Size = RecordSize(Record);
+
+		//	Records from before we started watching this device, including any from that same second,
+		//	may already be in the database.
+		if(!R.Watching) {
+			R.Watching = true;
+			R.Floor = Record.Recorded;
+		}
+		//	Clocks can step backwards: only keep what is still known to be complete.
+		if(!R.Records.empty() && Record.Recorded < R.Records.back().Recorded) {
+			for(const auto &i:R.Records) {
+				E.Bytes -= RecordSize(i);
+				S.Bytes -= RecordSize(i);
+			}
+			R.Records.clear();
+			R.Floor = Record.Recorded;
+		}
+
+		R.Records.push_back(Record);
+		E.Bytes += Size;
+		S.Bytes += Size;
+		while(R.Records.size()>MaxRecords_) {
+			auto Evicted = RecordSize(R.Records.front());
+			R.Floor = R.Records.front().Recorded;
+			R.Records.pop_front();
+			E.Bytes -= Evicted;
+			S.Bytes -= Evicted;
+		}
+
+		while(S.Bytes > ShardBudget_ && S.LRU.size()>1) {
+			auto Oldest = S.Devices.find(S.LRU.back());
+			S.Bytes -= Oldest->second.Bytes;
+			S.Devices.erase(Oldest);
+			S.LRU.pop_back();
+		}
+	}
+
+	void DeviceHistory::AddStatistics(const GWObjects::Statistics &Stats) {
+		Add(Stats.SerialNumber, &Entry::Stats, Stats);
+	}
+
+	void DeviceHistory::AddHealthCheck(const GWObjects::HealthCheck &Check) {
+		Add(Check.SerialNumber, &Entry::Checks, Check);
+	}
+
+	void DeviceHistory::Remove(const std::string &SerialNumber) {
+		uint64_t SerialNumberInt;
+		try {
+			SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
+		} catch (...) {
+			return;
+		}
+		auto &S = Shards_[SerialNumberInt % NumberOfShards];
+		std::lock_guard	G(S.Mutex);
+		auto Hint = S.Devices.find(SerialNumberInt);
+		if(Hint==S.Devices.end())
+			return;
+		S.Bytes -= Hint->second.Bytes;
+		S.LRU.erase(Hint->second.LRU);
+		S.Devices.erase(Hint);
+	}
+
+	void DeviceHistory::Clear() {
+		for(auto &S:Shards_) {
+			std::lock_guard	G(S.Mutex);
+			S.Devices.clear();
+			S.LRU.clear();
+			S.Bytes = 0;
+		}
+	}
+
+	//	Newest first, like the database query it replaces: ties come out in reverse insertion order.
+	template <typename T> bool DeviceHistory::GetNewest(const std::string &SerialNumber, Ring<T> Entry::*Which,
+														uint64_t HowMany, std::vector<T> &Records) {
+		uint64_t SerialNumberInt;
+		try {
+			SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
+		} catch (...) {
+			return false;
+		}
+
+		auto &S = Shards_[SerialNumberInt % NumberOfShards];
+		{
+			std::lock_guard	G(S.Mutex);
+			auto Hint = S.Devices.find(SerialNumberInt);
+			if(Hint!=S.Devices.end() && HowMany>0) {
+				const auto &R = Hint->second.*Which;
+				if(R.Records.size()>=HowMany) {
+					Records.insert(Records.end(), R.Records.rbegin(), R.Records.rbegin() + HowMany);
+					Hits_++;
+					return true;
+				}
+			}
+		}
+		Misses_++;
+		return false;
+	}
+
+	//	Oldest first with Offset and HowMany applied, like the database query it replaces. Only answered
+	//	when the whole range is newer than the ring's floor. The ring is in insertion order, which is the
+	//	database's last tie-breaker, so records from the same second are only reordered on UUID.
+	template <typename T> bool DeviceHistory::GetRange(const std::string &SerialNumber, Ring<T> Entry::*Which,
+													   uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
+													   uint64_t HowMany, std::vector<T> &Records) {
+		uint64_t SerialNumberInt;
+		try {
+			SerialNumberInt = Utils::SerialNumberToInt(SerialNumber);
+		} catch (...) {
+			return false;
+		}
+
+		auto &S = Shards_[SerialNumberInt % NumberOfShards];
+		{
+			std::lock_guard	G(S.Mutex);
+			auto Hint = S.Devices.find(SerialNumberInt);
+			if(Hint!=S.Devices.end()) {
+				const auto &R = Hint->second.*Which;
+				if(R.Watching && FromDate > R.Floor) {
+					std::vector<const T *>	InRange;
+					for(const auto &i:R.Records) {
+						if(i.Recorded<FromDate || (ToDate && i.Recorded>ToDate))
+							continue;
+						InRange.push_back(&i);
+					}
+					std::stable_sort(InRange.begin(), InRange.end(), [](const T *A, const T *B) {
+						return A->Recorded < B->Recorded || (A->Recorded == B->Recorded && A->UUID < B->UUID);
+					});
+					for(const auto i:InRange) {
+						if(Offset) {
+							Offset--;
+							continue;
+						}
+						if(Records.size()>=HowMany)
+							break;
+						Records.push_back(*i);
+					}
+					Hits_++;
+					return true;
+				}
+			}
+		}
+		Misses_++;
+		return false;
+	}
+
+	bool DeviceHistory::GetNewestStatistics(const std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats) {
+		return GetNewest(SerialNumber, &Entry::Stats, HowMany, Stats);
+	}
+
+	bool DeviceHistory::GetStatistics(const std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
+									  uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats) {
+		return GetRange(SerialNumber, &Entry::Stats, FromDate, ToDate, Offset, HowMany, Stats);
+	}
+
+	bool DeviceHistory::GetNewestHealthChecks(const std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::HealthCheck> &Checks) {
+		return GetNewest(SerialNumber, &Entry::Checks, HowMany, Checks);
+	}
+
+	bool DeviceHistory::GetHealthChecks(const std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
+										uint64_t HowMany, std::vector<GWObjects::HealthCheck> &Checks) {
+		return GetRange(SerialNumber, &Entry::Checks, FromDate, ToDate, Offset, HowMany, Checks);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "framework/MicroService.h"
+#include "RESTObjects/RESTAPI_GWobjects.h"
+
+namespace OpenWifi {
+
+	//	The last few statistics and healthchecks of every device, filled as they are ingested. It answers
+	//	the "newest" and recent time range queries the UI keeps polling, the database is only used for
+	//	anything older than what is kept here.
+	//
+	//	A ring holds every record of its device recorded after Floor: older records were either evicted
+	//	or written before this gateway started watching the device. Devices that have not reported for
+	//	the longest time are dropped first when the memory budget is reached.
+	class DeviceHistory : public SubSystemServer {
+	  public:
+		static auto instance() {
+			static auto instance_ = new DeviceHistory;
+			return instance_;
+		}
+
+		int Start() override;
+		void Stop() override;
+
+		void AddStatistics(const GWObjects::Statistics &Stats);
+		void AddHealthCheck(const GWObjects::HealthCheck &Check);
+		void Remove(const std::string &SerialNumber);
+		void Clear();
+
+		bool GetNewestStatistics(const std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats);
+		bool GetStatistics(const std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
+						   uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats);
+		bool GetNewestHealthChecks(const std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::HealthCheck> &Checks);
+		bool GetHealthChecks(const std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
+							 uint64_t HowMany, std::vector<GWObjects::HealthCheck> &Checks);
+
+	  private:
+		template <typename T> struct Ring {
+			std::deque<T>	Records;
+			uint64_t 		Floor=0;
+			bool 			Watching=false;
+		};
+
+		struct Entry {
+			Ring<GWObjects::Statistics>		Stats;
+			Ring<GWObjects::HealthCheck>	Checks;
+			uint64_t 						Bytes=0;
+			std::list<uint64_t>::iterator	LRU;
+		};
+
+		struct Shard {
+			std::mutex							Mutex;
+			std::unordered_map<uint64_t,Entry>	Devices;
+			std::list<uint64_t>					LRU;
+			uint64_t 							Bytes=0;
+		};
+
+		static constexpr std::size_t 	NumberOfShards=64;
+		std::array<Shard,NumberOfShards>	Shards_;
+		std::atomic_bool 				Enabled_=false;
+		uint64_t 						MaxRecords_=32;
+		uint64_t 						ShardBudget_=0;
+		std::atomic_uint64_t			Hits_=0, Misses_=0;
+
+		template <typename T> void Add(const std::string &SerialNumber, Ring<T> Entry::*Which, const T &Record);
+		template <typename T> bool GetNewest(const std::string &SerialNumber, Ring<T> Entry::*Which, uint64_t HowMany,
+											 std::vector<T> &Records);
+		template <typename T> bool GetRange(const std::string &SerialNumber, Ring<T> Entry::*Which, uint64_t FromDate,
+											uint64_t ToDate, uint64_t Offset, uint64_t HowMany, std::vector<T> &Records);
+
+		DeviceHistory() noexcept:
+			SubSystemServer("DeviceHistory", "DEV-HISTORY", "devicehistory")
+		{
+		}
+	};
+
+	inline auto DeviceHistory() { return DeviceHistory::instance(); }
+}
@@ -4,13 +4,193 @@
 
 #pragma once
 
+#include <fstream>
+#include <shared_mutex>
+
 #include "framework/MicroService.h"
 
+#include "Poco/File.h"
+#include "Poco/ExpireLRUCache.h"
 #include "Poco/Net/IPAddress.h"
 #include "nlohmann/json.hpp"
 
 namespace OpenWifi {
 
+	//	Offline IP to country database loaded from a CSV file. Each line is either "start,end,country",
+	//	where start and end are addresses or decimal numbers (DB-IP and IP2Location LITE layouts), or
+	//	"network/prefix,country". Nested ranges are flattened so the most specific one wins, which gives
+	//	longest prefix match semantics with a single binary search per lookup.
+	class IPRangeDatabase {
+	  public:
+		typedef unsigned __int128	uint128_t;
+
+		inline bool Load(const std::string &FileName) {
+			std::ifstream	File(FileName);
+			if(!File.is_open())
+				return false;
+
+			std::vector<Range<uint32_t>>	V4;
+			std::vector<Range<uint128_t>>	V6;
+			std::string 					Line;
+			while(std::getline(File,Line)) {
+				auto Fields = Poco::StringTokenizer(Line, ",", Poco::StringTokenizer::TOK_TRIM);
+				if(Fields.count()<2)
+					continue;
+
+				std::string Country;
+				uint128_t	Start, End;
+				bool 		StartV6, EndV6;
+				auto Slash = Fields[0].find('/');
+				if(Slash!=std::string::npos) {
+					int Bits;
+					if(!ParseAddress(Fields[0].substr(0,Slash), Start, StartV6))
+						continue;
+					try {
+						Bits = std::stoi(Fields[0].substr(Slash+1));
+					} catch (...) {
+						continue;
+					}
+					int Width = StartV6 ? 128 : 32;
+					if(Bits<0 || Bits>Width)
+						continue;
+					uint128_t HostMask = (Width-Bits)==128 ? ~(uint128_t)0 : (((uint128_t)1 << (Width-Bits)) - 1);
+					Start &= ~HostMask;
+					End = Start | HostMask;
+					EndV6 = StartV6;
+					Country = Unquote(Fields[1]);
+				} else {
+					if(Fields.count()<3 || !ParseAddress(Fields[0], Start, StartV6) || !ParseAddress(Fields[1], End, EndV6) || StartV6!=EndV6 || End<Start)
+						continue;
+					Country = Unquote(Fields[2]);
+				}
+				if(Country.size()!=2 || Country=="--" || Country=="-")
+					continue;
+
+				if(StartV6)
+					V6.push_back(Range<uint128_t>{ Start, End, { Country[0], Country[1] }});
+				else
+					V4.push_back(Range<uint32_t>{ (uint32_t)Start, (uint32_t)End, { Country[0], Country[1] }});
+			}
+
+			V4_ = Flatten(V4);
+			V6_ = Flatten(V6);
+			return !V4_.empty() || !V6_.empty();
+		}
+
+		[[nodiscard]] inline bool Find(const Poco::Net::IPAddress &A, std::string &Country) const {
+			uint128_t	Address=0;
+			auto Bytes = (const uint8_t *) A.addr();
+			for(std::size_t i=0;i<A.length();i++)
+				Address = (Address << 8) | Bytes[i];
+			if(A.family()==Poco::Net::IPAddress::IPv4)
+				return Find(V4_, (uint32_t)Address, Country);
+			if(A.isIPv4Mapped())
+				return Find(V4_, (uint32_t)Address, Country);
+			return Find(V6_, Address, Country);
+		}
+
+		[[nodiscard]] inline std::size_t size() const { return V4_.size() + V6_.size(); }
+
+	  private:
+		template <typename T> struct Range {
+			T 		Start, End;
+			char 	Country[2];
+		};
+
+		std::vector<Range<uint32_t>>	V4_;
+		std::vector<Range<uint128_t>>	V6_;
+
+		static inline std::string Unquote(const std::string &S) {
+			if(S.size()>=2 && S.front()=='"' && S.back()=='"')
+				return S.substr(1,S.size()-2);
+			return S;
+		}
+
+		//	Decimal numbers up to 2^32-1 are IPv4, as are IPv4-mapped IPv6 numbers.
+		static inline bool ParseAddress(const std::string &Field, uint128_t &Value, bool &IsV6) {
+			auto S = Unquote(Field);
+			if(S.empty())
+				return false;
+			if(S.find_first_of(".:")!=std::string::npos) {
+				Poco::Net::IPAddress	A;
+				if(!Poco::Net::IPAddress::tryParse(S,A))
+					return false;
+				Value = 0;
+				auto Bytes = (const uint8_t *) A.addr();
+				for(std::size_t i=0;i<A.length();i++)
+					Value = (Value << 8) | Bytes[i];
+				IsV6 = A.family()==Poco::Net::IPAddress::IPv6 && !A.isIPv4Mapped();
+				if(!IsV6)
+					Value &= 0xffffffff;
+				return true;
+			}
+			Value = 0;
+			for(const auto &c:S) {
+				if(c<'0' || c>'9')
+					return false;
+				Value = Value * 10 + (c - '0');
+			}
+			IsV6 = Value > 0xffffffff;
+			if(IsV6 && (Value >> 32) == 0xffff) {
+				Value &= 0xffffffff;
+				IsV6 = false;
+			}
+			return true;
+		}
+
+		template <typename T> static std::vector<Range<T>> Flatten(std::vector<Range<T>> &Ranges) {
+			std::sort(Ranges.begin(),Ranges.end(),[](const Range<T> &L, const Range<T> &R) {
+				return L.Start < R.Start || (L.Start == R.Start && L.End > R.End);
+			});
+
+			std::vector<Range<T>>	Result, Open;
+			T 		Cursor = 0;
+			bool	Exhausted = false;
+			auto Emit = [&](T Start, T End, const char *Country) {
+				if(!Result.empty() && Result.back().End + 1 == Start &&
+					Result.back().Country[0]==Country[0] && Result.back().Country[1]==Country[1]) {
+					Result.back().End = End;
+				} else {
+					Result.push_back(Range<T>{ Start, End, { Country[0], Country[1] }});
+				}
+				Exhausted = End == std::numeric_limits<T>::max();
+				Cursor = End + 1;
+			};
+			auto Close = [&](const Range<T> &R) {
+				if(!Exhausted && Cursor <= R.End)
+					Emit(std::max(Cursor, R.Start), R.End, R.Country);
+			};
+
+			for(const auto &R:Ranges) {
+				while(!Open.empty() && Open.back().End < R.Start) {
+					Close(Open.back());
+					Open.pop_back();
+				}
+				if(!Open.empty() && !Exhausted && Cursor < R.Start)
+					Emit(std::max(Cursor, Open.back().Start), R.Start - 1, Open.back().Country);
+				Open.push_back(R);
+			}
+			while(!Open.empty()) {
+				Close(Open.back());
+				Open.pop_back();
+			}
+			Result.shrink_to_fit();
+			return Result;
+		}
+
+		template <typename T> static bool Find(const std::vector<Range<T>> &Ranges, T Address, std::string &Country) {
+			auto It = std::upper_bound(Ranges.begin(), Ranges.end(), Address,
+									   [](T A, const Range<T> &R) { return A < R.Start; });
+			if(It==Ranges.begin())
+				return false;
+			--It;
+			if(Address > It->End)
+				return false;
+			Country.assign(It->Country, 2);
+			return true;
+		}
+	};
+
 	class IPToCountryProvider {
 	  public:
 		virtual bool Init() = 0 ;
@@ -143,15 +323,35 @@ namespace OpenWifi {
 				}
 			}
 			Default_ = MicroService::instance().ConfigGetString("iptocountry.default", "US");
+
+			LocalFileName_ = MicroService::instance().ConfigPath("iptocountry.local.file","");
+			if(!LocalFileName_.empty()) {
+				LoadLocalDatabase();
+				auto Reload = MicroService::instance().ConfigGetInt("iptocountry.local.reload",3600);
+				if(Reload) {
+					ReloadCallback_ = std::make_unique<Poco::TimerCallback<FindCountryFromIP>>(*this, &FindCountryFromIP::onTimer);
+					Timer_.setStartInterval(Reload * 1000);
+					Timer_.setPeriodicInterval(Reload * 1000);
+					Timer_.start(*ReloadCallback_, MicroService::instance().TimerPool());
+				}
+			}
 			return 0;
 		}
 
 		inline void Stop() final {
 			poco_notice(Logger(),"Stopping...");
-			//	Nothing to do - just to provide the same look at the others.
+			if(ReloadCallback_) {
+				Timer_.stop();
+				ReloadCallback_.reset();
+			}
 			poco_notice(Logger(),"Stopped...");
 		}
 
+		inline void onTimer([[maybe_unused]] Poco::Timer &timer) {
+			Utils::SetThreadName("iptoc-reload");
+			LoadLocalDatabase();
+		}
+
 		[[nodiscard]] static inline std::string ReformatAddress(const std::string & I )
 		{
 			if(I.substr(0,7) == "::ffff:")
@@ -163,34 +363,97 @@ namespace OpenWifi {
 		}
 
 		inline std::string Get(const Poco::Net::IPAddress & IP) {
-			if (!Enabled_)
+			if (!Enabled())
 				return Default_;
 			return Get(ReformatAddress(IP.toString()));
 		}
 
+		//	Local database first, then answers we already got from the remote provider, and only then
+		//	the remote provider itself.
 		inline std::string Get(const std::string & IP) {
+			if (!Enabled())
+				return Default_;
+
+			std::string Country;
+			std::shared_ptr<const IPRangeDatabase>	Local;
+			{
+				std::shared_lock	G(LocalMutex_);
+				Local = Local_;
+			}
+			if(Local) {
+				Poco::Net::IPAddress	A;
+				if(Poco::Net::IPAddress::tryParse(IP,A) && Local->Find(A,Country))
+					return Country;
+			}
+
 			if (!Enabled_)
 				return Default_;
+
+			auto Cached = Cache_.get(IP);
+			if(!Cached.isNull())
+				return *Cached;
+
 			try {
 				std::string URL = Provider_->URI(IP).toString();
 				std::string Response;
 				if (Utils::wgets(URL, Response)) {
 					auto Answer = Provider_->Country(Response);
-					if(!Answer.empty())
+					if(!Answer.empty()) {
+						Cache_.add(IP, Answer);
 						return Answer;
+					}
 				}
 			} catch(...) {
 			}
 			return Default_;
 		}
 
-		inline auto Enabled() const { return Enabled_; }
+		inline bool Enabled() const {
+			if(Enabled_)
+				return true;
+			std::shared_lock	G(LocalMutex_);
+			return Local_!=nullptr;
+		}
 
 	  private:
 		bool 									Enabled_=false;
 		std::string 							Default_;
 		std::unique_ptr<IPToCountryProvider>	Provider_;
 		std::string 							ProviderName_;
+		Poco::ExpireLRUCache<std::string,std::string>	Cache_{8192, 24*60*60*1000};
+
+		mutable std::shared_mutex				LocalMutex_;
+		std::shared_ptr<const IPRangeDatabase>	Local_;
+		std::string 							LocalFileName_;
+		Poco::Timestamp							LocalFileModified_=0;
+		Poco::Timer								Timer_;
+		std::unique_ptr<Poco::TimerCallback<FindCountryFromIP>>	ReloadCallback_;
+
+		//	The new database is built aside and swapped in, lookups never wait on a reload.
+		inline void LoadLocalDatabase() {
+			try {
+				Poco::File	F(LocalFileName_);
+				if(!F.exists()) {
+					poco_warning(Logger(),fmt::format("IP to country database {} does not exist.", LocalFileName_));
+					return;
+				}
+				auto Modified = F.getLastModified();
+				if(Modified==LocalFileModified_)
+					return;
+
+				auto Db = std::make_shared<IPRangeDatabase>();
+				if(!Db->Load(LocalFileName_)) {
+					poco_warning(Logger(),fmt::format("IP to country database {} could not be loaded.", LocalFileName_));
+					return;
+				}
+				poco_information(Logger(),fmt::format("Loaded {} IP ranges from {}.", Db->size(), LocalFileName_));
+				LocalFileModified_ = Modified;
+				std::unique_lock	G(LocalMutex_);
+				Local_ = std::move(Db);
+			} catch (const Poco::Exception &E) {
+				Logger().log(E);
+			}
+		}
 
 		FindCountryFromIP() noexcept:
 			SubSystemServer("IpToCountry", "IPTOC-SVR", "iptocountry")
@@ -4,16 +4,21 @@
 
 #include "GwWebSocketClient.h"
 #include "SerialNumberCache.h"
+#include "sdks/sdk_prov.h"
 
 namespace OpenWifi {
 
 	GwWebSocketClient::GwWebSocketClient(Poco::Logger &Logger):
 		 Logger_(Logger){
 		WebSocketClientServer()->SetProcessor(this);
+		WebSocketClientServer()->SetVenueResolver([this](const std::string &Venue, Types::StringVec &SerialNumbers) {
+			return SDK::Prov::GetSerialNumbersForVenue(Venue, SerialNumbers, Logger_);
+		});
 	}
 
 	GwWebSocketClient::~GwWebSocketClient() {
 		WebSocketClientServer()->SetProcessor(nullptr);
+		WebSocketClientServer()->SetVenueResolver(nullptr);
 	}
 
 	void GwWebSocketClient::Processor(const Poco::JSON::Object::Ptr &O, std::string &Answer, bool &Done ) {
@@ -164,9 +164,13 @@ namespace OpenWifi {
 	}
 
 	std::string OUIServer::GetManufacturer(const std::string &MAC) {
+		return GetManufacturer(Utils::SerialNumberToOUI(MAC));
+	}
+
+	std::string OUIServer::GetManufacturer(uint64_t OUI) {
 		std::shared_lock 	Lock(LocalMutex_);
 
-		auto Manufacturer = OUIs_.find(Utils::SerialNumberToOUI(MAC));
+		auto Manufacturer = OUIs_.find(OUI);
 		if(Manufacturer != OUIs_.end())
 			return Manufacturer->second;
 		return "";
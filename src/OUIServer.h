@@ -28,6 +28,7 @@ namespace OpenWifi {
 
 		void reinitialize(Poco::Util::Application &self) override;
 		[[nodiscard]] std::string GetManufacturer(const std::string &MAC);
+		[[nodiscard]] std::string GetManufacturer(uint64_t OUI);
 		[[nodiscard]] bool GetFile(const std::string &FileName);
 		[[nodiscard]] bool ProcessFile(const std::string &FileName, OUIMap &Map);
 
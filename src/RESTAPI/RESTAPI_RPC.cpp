@@ -12,15 +12,24 @@
 #include "StorageService.h"
 #include "framework/ow_constants.h"
 #include "ParseWifiScan.h"
+#include "framework/WebSocketClientNotifications.h"
 
 namespace OpenWifi::RESTAPI_RPC {
+	//	Storing a command replaces any uncompleted command of the same kind, the scheduler must follow.
+	static bool StoreCommand(GWObjects::CommandDetails &Cmd, Storage::CommandExecutionType Status) {
+		if(!StorageService()->AddCommand(Cmd.SerialNumber, Cmd, Status))
+			return false;
+		CommandManager()->CommandQueued(Cmd, Status==Storage::CommandExecutionType::COMMAND_PENDING);
+		return true;
+	}
+
 	void SetCommandStatus(GWObjects::CommandDetails &Cmd,
 							 	[[maybe_unused]] Poco::Net::HTTPServerRequest &Request,
 					  			[[maybe_unused]] Poco::Net::HTTPServerResponse &Response,
 					  		 	RESTAPIHandler *Handler,
 					  		 	OpenWifi::Storage::CommandExecutionType Status,
 					  			[[maybe_unused]] Poco::Logger &Logger) {
-		if (StorageService()->AddCommand(Cmd.SerialNumber, Cmd, Status)) {
+		if (StoreCommand(Cmd, Status)) {
 			Poco::JSON::Object RetObj;
 			Cmd.to_json(RetObj);
 			if(Handler!= nullptr)
@@ -31,6 +40,112 @@ namespace OpenWifi::RESTAPI_RPC {
 			return Handler->ReturnStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
 	}
 
+	//	Turns a device answer into the stored command record. Used for both waiting and asynchronous commands.
+	static Storage::CommandExecutionType ProcessAnswer(GWObjects::CommandDetails &Cmd,
+													   uint64_t RPCID,
+													   const Poco::JSON::Object &rpc_answer,
+													   std::chrono::duration<double, std::milli> rpc_execution_time,
+													   Poco::Logger &Logger) {
+		if (!rpc_answer.has(uCentralProtocol::RESULT) || !rpc_answer.isObject(uCentralProtocol::RESULT)) {
+			Logger.information(fmt::format("{},{}: Invalid response. Missing result.", Cmd.UUID, RPCID));
+			return Storage::CommandExecutionType::COMMAND_FAILED;
+		}
+
+		auto ResultFields = rpc_answer.get(uCentralProtocol::RESULT).extract<Poco::JSON::Object::Ptr>();
+		if (!ResultFields->has(uCentralProtocol::STATUS) || !ResultFields->isObject(uCentralProtocol::STATUS)) {
+			Cmd.executionTime = rpc_execution_time.count();
+			if(Cmd.Command=="ping") {
+				Logger.information(fmt::format("{},{}: Invalid response from device (ping: fix override). Missing status.", Cmd.UUID, RPCID));
+				return Storage::CommandExecutionType::COMMAND_COMPLETED;
+			}
+			Logger.information(fmt::format("{},{}: Invalid response from device. Missing status.", Cmd.UUID,RPCID));
+			return Storage::CommandExecutionType::COMMAND_FAILED;
+		}
+
+		auto StatusInnerObj = ResultFields->get(uCentralProtocol::STATUS).extract<Poco::JSON::Object::Ptr>();
+		if (StatusInnerObj->has(uCentralProtocol::ERROR))
+			Cmd.ErrorCode = StatusInnerObj->get(uCentralProtocol::ERROR);
+		if (StatusInnerObj->has(uCentralProtocol::TEXT))
+			Cmd.ErrorText = StatusInnerObj->get(uCentralProtocol::TEXT).toString();
+		std::stringstream ResultText;
+		if(rpc_answer.has(uCentralProtocol::RESULT)) {
+			if(Cmd.Command==uCentralProtocol::WIFISCAN) {
+				auto ScanObj = rpc_answer.get(uCentralProtocol::RESULT).extract<Poco::JSON::Object::Ptr>();
+				ParseWifiScan(ScanObj, ResultText, Logger);
+			} else {
+				Poco::JSON::Stringifier::stringify(
+					rpc_answer.get(uCentralProtocol::RESULT), ResultText);
+			}
+		} if (rpc_answer.has(uCentralProtocol::RESULT_64)) {
+			uint64_t sz=0;
+			if(rpc_answer.has(uCentralProtocol::RESULT_SZ))
+				sz=rpc_answer.get(uCentralProtocol::RESULT_SZ);
+			std::string UnCompressedData;
+			Utils::ExtractBase64CompressedData(rpc_answer.get(uCentralProtocol::RESULT_64).toString(),
+											   UnCompressedData,sz);
+			Poco::JSON::Stringifier::stringify(UnCompressedData, ResultText);
+		}
+		Cmd.Results = ResultText.str();
+		Cmd.Status = "completed";
+		Cmd.Completed = OpenWifi::Now();
+		Cmd.executionTime = rpc_execution_time.count();
+
+		if (Cmd.ErrorCode && Cmd.Command == uCentralProtocol::TRACE) {
+			Cmd.WaitingForFile = 0;
+			Cmd.AttachDate = Cmd.AttachSize = 0;
+			Cmd.AttachType = "";
+		}
+		return Storage::CommandExecutionType::COMMAND_COMPLETED;
+	}
+
+	//	The command is recorded as executed before it is sent, and the answer completes it from the
+	//	RPC processor thread. The REST worker returns right away: callers poll the command or listen
+	//	for its completion notification.
+	static void PostAsynchronousCommand(uint64_t RPCID,
+										bool RetryLater,
+										GWObjects::CommandDetails &Cmd,
+										Poco::JSON::Object  & Params,
+										Poco::Net::HTTPServerRequest &Request,
+										Poco::Net::HTTPServerResponse &Response,
+										RESTAPIHandler * Handler,
+										Poco::Logger &Logger) {
+		Cmd.Executed = OpenWifi::Now();
+		if(!StoreCommand(Cmd, Storage::CommandExecutionType::COMMAND_EXECUTED))
+			return Handler->ReturnStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+
+		auto Completion = [Cmd, RPCID, Log = &Logger](const CommandManager::objtype_t &Answer,
+													  std::chrono::duration<double, std::milli> ExecutionTime) mutable {
+			auto Status = ProcessAnswer(Cmd, RPCID, Answer, ExecutionTime, *Log);
+			StoreCommand(Cmd, Status);
+			WebSocketClientNotificationCommandCompleted(Cmd.SerialNumber, Cmd.UUID, Cmd.Command, Cmd.Status,
+														Cmd.ErrorCode, Cmd.ErrorText);
+			Log->information(fmt::format("{},{}: Completed asynchronously in {:.3f}ms.", Cmd.UUID, RPCID, Cmd.executionTime));
+		};
+
+		//	The device never answered: same outcome as a waiting caller whose wait ran out.
+		auto Expiry = [Cmd, RPCID, RetryLater, Log = &Logger]() mutable {
+			auto Status = RetryLater ? Storage::CommandExecutionType::COMMAND_PENDING : Storage::CommandExecutionType::COMMAND_FAILED;
+			StoreCommand(Cmd, Status);
+			WebSocketClientNotificationCommandCompleted(Cmd.SerialNumber, Cmd.UUID, Cmd.Command, Cmd.Status,
+														Cmd.ErrorCode, Cmd.ErrorText);
+			Log->information(fmt::format("{},{}: No answer from the device, command is now {}.", Cmd.UUID, RPCID, Cmd.Status));
+		};
+
+		bool Sent;
+		CommandManager()->PostCommandAsync(RPCID, Cmd.SerialNumber, Cmd.Command, Params, Cmd.UUID, std::move(Completion), std::move(Expiry), Sent);
+		if(!Sent) {
+			Logger.information(fmt::format("{},{}: Device is not connected.", Cmd.UUID, RPCID));
+			return SetCommandStatus(Cmd, Request, Response, Handler,
+									RetryLater ? Storage::CommandExecutionType::COMMAND_PENDING : Storage::CommandExecutionType::COMMAND_FAILED,
+									Logger);
+		}
+
+		Logger.information(fmt::format("{},{}: Command sent asynchronously.", Cmd.UUID, RPCID));
+		Poco::JSON::Object RetObj;
+		Cmd.to_json(RetObj);
+		Handler->ReturnObject(RetObj);
+	}
+
 	void WaitForCommand(uint64_t RPCID,
 						bool RetryLater,
 						GWObjects::CommandDetails &Cmd,
@@ -57,6 +172,10 @@ namespace OpenWifi::RESTAPI_RPC {
 			return SetCommandStatus(Cmd, Request, Response, Handler, Storage::CommandExecutionType::COMMAND_FAILED, Logger);
 		}
 
+		if (Handler != nullptr && Handler->GetBoolParameter(RESTAPI::Protocol::ASYNCHRONOUS, false)) {
+			return PostAsynchronousCommand(RPCID, RetryLater, Cmd, Params, Request, Response, Handler, Logger);
+		}
+
 		Cmd.Executed = OpenWifi::Now();
 
 		bool Sent;
@@ -80,69 +199,13 @@ namespace OpenWifi::RESTAPI_RPC {
 		if (rpc_result == std::future_status::ready) {
 			std::chrono::duration<double, std::milli> rpc_execution_time = std::chrono::high_resolution_clock::now() - rpc_submitted;
 			auto rpc_answer = rpc_future.get();
-			if (!rpc_answer.has(uCentralProtocol::RESULT) || !rpc_answer.isObject(uCentralProtocol::RESULT)) {
-				SetCommandStatus(Cmd, Request, Response, Handler, Storage::CommandExecutionType::COMMAND_FAILED, Logger);
-				Logger.information(fmt::format("{},{}: Invalid response. Missing result.", Cmd.UUID, RPCID));
-				return;
-			}
-
-			auto ResultFields = rpc_answer.get(uCentralProtocol::RESULT).extract<Poco::JSON::Object::Ptr>();
-			if (!ResultFields->has(uCentralProtocol::STATUS) || !ResultFields->isObject(uCentralProtocol::STATUS)) {
-				Cmd.executionTime = rpc_execution_time.count();
-				if(Cmd.Command=="ping") {
-					SetCommandStatus(Cmd, Request, Response, Handler, Storage::CommandExecutionType::COMMAND_COMPLETED, Logger);
-					Logger.information(fmt::format("{},{}: Invalid response from device (ping: fix override). Missing status.", Cmd.UUID, RPCID));
-				} else {
-					SetCommandStatus(Cmd, Request, Response, Handler, Storage::CommandExecutionType::COMMAND_FAILED, Logger);
-					Logger.information(fmt::format("{},{}: Invalid response from device. Missing status.", Cmd.UUID,RPCID));
-				}
-				return;
-			}
-
-			auto StatusInnerObj = ResultFields->get(uCentralProtocol::STATUS).extract<Poco::JSON::Object::Ptr>();
-			if (StatusInnerObj->has(uCentralProtocol::ERROR))
-				Cmd.ErrorCode = StatusInnerObj->get(uCentralProtocol::ERROR);
-			if (StatusInnerObj->has(uCentralProtocol::TEXT))
-				Cmd.ErrorText = StatusInnerObj->get(uCentralProtocol::TEXT).toString();
-			std::stringstream ResultText;
-			if(rpc_answer.has(uCentralProtocol::RESULT)) {
-				if(Cmd.Command==uCentralProtocol::WIFISCAN) {
-					auto ScanObj = rpc_answer.get(uCentralProtocol::RESULT).extract<Poco::JSON::Object::Ptr>();
-					ParseWifiScan(ScanObj, ResultText, Logger);
-				} else {
-					Poco::JSON::Stringifier::stringify(
-						rpc_answer.get(uCentralProtocol::RESULT), ResultText);
-				}
-			} if (rpc_answer.has(uCentralProtocol::RESULT_64)) {
-				uint64_t sz=0;
-				if(rpc_answer.has(uCentralProtocol::RESULT_SZ))
-					sz=rpc_answer.get(uCentralProtocol::RESULT_SZ);
-				std::string UnCompressedData;
-				Utils::ExtractBase64CompressedData(rpc_answer.get(uCentralProtocol::RESULT_64).toString(),
-												   UnCompressedData,sz);
-				Poco::JSON::Stringifier::stringify(UnCompressedData, ResultText);
-			}
-			Cmd.Results = ResultText.str();
-			Cmd.Status = "completed";
-			Cmd.Completed = OpenWifi::Now();
-			Cmd.executionTime = rpc_execution_time.count();
-
-			if (Cmd.ErrorCode && Cmd.Command == uCentralProtocol::TRACE) {
-				Cmd.WaitingForFile = 0;
-				Cmd.AttachDate = Cmd.AttachSize = 0;
-				Cmd.AttachType = "";
-			}
-
-			//	Add the completed command to the database...
-			StorageService()->AddCommand(Cmd.SerialNumber, Cmd, Storage::CommandExecutionType::COMMAND_COMPLETED);
-
-			if (ObjectToReturn && Handler) {
-				Handler->ReturnObject(*ObjectToReturn);
+			auto Status = ProcessAnswer(Cmd, RPCID, rpc_answer, rpc_execution_time, Logger);
+			if (Status != Storage::CommandExecutionType::COMMAND_COMPLETED || ObjectToReturn == nullptr || Handler == nullptr) {
+				SetCommandStatus(Cmd, Request, Response, Handler, Status, Logger);
 			} else {
-				Poco::JSON::Object O;
-				Cmd.to_json(O);
-				if(Handler)
-					Handler->ReturnObject(O);
+				//	Add the completed command to the database...
+				StoreCommand(Cmd, Status);
+				Handler->ReturnObject(*ObjectToReturn);
 			}
 			Logger.information( fmt::format("{},{}: Completed in {:.3f}ms.", Cmd.UUID, RPCID, Cmd.executionTime));
 			return;
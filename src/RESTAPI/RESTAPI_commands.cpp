@@ -6,7 +6,10 @@
 //	Arilia Wireless Inc.
 //
 
+#include <algorithm>
+
 #include "RESTAPI_commands.h"
+#include "RESTAPI_cursor.h"
 #include "StorageService.h"
 #include "framework/ow_constants.h"
 
@@ -17,9 +20,17 @@ namespace OpenWifi {
 			return BadRequest(RESTAPI::Errors::MissingSerialNumber);
 		}
 
+		PageCursor	Cursor;
+		if (!Cursor.Decode(QB_.Cursor, true)) {
+			return BadRequest(RESTAPI::Errors::InvalidCursor);
+		}
+
 		std::vector<GWObjects::CommandDetails> Commands;
 		if (QB_.Newest) {
 			StorageService()->GetNewestCommands(SerialNumber, QB_.Limit, Commands);
+		} else if (Cursor.Present) {
+			StorageService()->GetCommands(SerialNumber, std::max(QB_.StartDate, Cursor.NumericKey()), QB_.EndDate,
+										  Cursor.Skip, QB_.Limit, Commands);
 		} else {
 			StorageService()->GetCommands(SerialNumber, QB_.StartDate, QB_.EndDate, QB_.Offset, QB_.Limit,
 								   Commands);
@@ -32,6 +43,12 @@ namespace OpenWifi {
 		}
 		Poco::JSON::Object RetObj;
 		RetObj.set(RESTAPI::Protocol::COMMANDS, ArrayObj);
+		if (!QB_.Newest) {
+			auto Next = Cursor.Next(Commands, QB_.Limit,
+									[](const GWObjects::CommandDetails &C) { return std::to_string(C.Submitted); });
+			if (!Next.empty())
+				RetObj.set(RESTAPI::Protocol::NEXTCURSOR, Next);
+		}
 		ReturnObject(RetObj);
 	}
 
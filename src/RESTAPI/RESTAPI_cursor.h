@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "framework/MicroService.h"
+
+namespace OpenWifi {
+
+	//	Opaque continuation token for keyset pagination. It carries the sort key of the last row of the
+	//	previous page and how many rows sharing that key were already returned, so the next page is an
+	//	index seek on the key instead of an OFFSET walk from the first row.
+	struct PageCursor {
+		std::string 	Key;
+		uint64_t 		Skip=0;
+		bool 			Present=false;
+
+		[[nodiscard]] inline uint64_t NumericKey() const {
+			return Present ? std::stoull(Key) : 0;
+		}
+
+		//	The token is url safe base64 without padding so it can be passed back as-is in a query string.
+		[[nodiscard]] static inline std::string Encode(const std::string &Key, uint64_t Skip) {
+			auto Raw = Key + "|" + std::to_string(Skip);
+			auto Token = Utils::base64encode((const unsigned char *)Raw.c_str(), Raw.size());
+			while(!Token.empty() && Token.back()=='=')
+				Token.pop_back();
+			for(auto &c:Token) {
+				if(c=='+') c='-';
+				else if(c=='/') c='_';
+			}
+			return Token;
+		}
+
+		[[nodiscard]] inline bool Decode(const std::string &Token, bool NumericKeys) {
+			Present = false;
+			if(Token.empty())
+				return true;
+			try {
+				auto Padded = Token;
+				for(auto &c:Padded) {
+					if(c=='-') c='+';
+					else if(c=='_') c='/';
+				}
+				while(Padded.size()%4)
+					Padded += '=';
+				auto Raw = Utils::base64decode(Padded);
+				std::string Value(Raw.begin(),Raw.end());
+				auto Sep = Value.rfind('|');
+				if(Sep==std::string::npos || Sep+1==Value.size())
+					return false;
+				auto SkipStr = Value.substr(Sep+1);
+				Key = Value.substr(0,Sep);
+				if(!RESTAPIHandler::is_number(SkipStr) || (NumericKeys && !RESTAPIHandler::is_number(Key)))
+					return false;
+				Skip = std::stoull(SkipStr);
+				Present = true;
+				return true;
+			} catch (...) {
+			}
+			return false;
+		}
+
+		//	Token for the page following Rows, or empty when Rows was the last page. Rows must be in sort
+		//	order and KeyOf returns the sort key of a row as a string.
+		template <typename T, typename F>
+		[[nodiscard]] inline std::string Next(const std::vector<T> &Rows, uint64_t Limit, F KeyOf) const {
+			if(Rows.empty() || Rows.size()<Limit)
+				return "";
+			auto LastKey = KeyOf(Rows.back());
+			uint64_t Ties = 0;
+			for(auto It=Rows.rbegin(); It!=Rows.rend() && KeyOf(*It)==LastKey; ++It)
+				Ties++;
+			//	A page made entirely of one key value continues the run that started on an earlier page.
+			if(Present && Ties==Rows.size() && Key==LastKey)
+				Ties += Skip;
+			return Encode(LastKey, Ties);
+		}
+	};
+}
@@ -15,6 +15,7 @@
 #include "CentralConfig.h"
 #include "FileUploader.h"
 #include "RESTAPI_RPC.h"
+#include "RESTAPI_cursor.h"
 #include "RESTAPI_device_commandHandler.h"
 #include "RESTObjects/RESTAPI_GWobjects.h"
 #include "StorageService.h"
@@ -225,9 +226,19 @@ namespace OpenWifi {
 			return NotFound();
 		}
 
+		PageCursor	Cursor;
+		if (!Cursor.Decode(QB_.Cursor, true)) {
+			return BadRequest(RESTAPI::Errors::InvalidCursor);
+		}
+
 		std::vector<GWObjects::Statistics> Stats;
+		auto KeyOf = [](const GWObjects::Statistics &S) { return std::to_string(S.Recorded); };
 		if (QB_.Newest) {
 			StorageService()->GetNewestStatisticsData(SerialNumber_, QB_.Limit, Stats);
+		} else if (Cursor.Present) {
+			//	Seek on (SerialNumber, Recorded) and only skip the rows tied with the last one returned.
+			StorageService()->GetStatisticsData(SerialNumber_, std::max(QB_.StartDate, Cursor.NumericKey()),
+												 QB_.EndDate, Cursor.Skip, QB_.Limit, Stats);
 		} else {
 			StorageService()->GetStatisticsData(SerialNumber_, QB_.StartDate, QB_.EndDate,
 												 QB_.Offset, QB_.Limit, Stats);
@@ -242,6 +253,11 @@ namespace OpenWifi {
 		Poco::JSON::Object RetObj;
 		RetObj.set(RESTAPI::Protocol::DATA, ArrayObj);
 		RetObj.set(RESTAPI::Protocol::SERIALNUMBER, SerialNumber_);
+		if (!QB_.Newest) {
+			auto Next = Cursor.Next(Stats, QB_.Limit, KeyOf);
+			if (!Next.empty())
+				RetObj.set(RESTAPI::Protocol::NEXTCURSOR, Next);
+		}
 		return ReturnObject(RetObj);
 
 	}
@@ -278,9 +294,20 @@ namespace OpenWifi {
 		Logger_.information(fmt::format("GET-LOGS: TID={} user={} serial={}. thr_id={}",
 										TransactionId_, Requester(), SerialNumber_,
 										Poco::Thread::current()->id()));
+		PageCursor	Cursor;
+		if (!Cursor.Decode(QB_.Cursor, true)) {
+			return BadRequest(RESTAPI::Errors::InvalidCursor);
+		}
+
 		std::vector<GWObjects::DeviceLog> Logs;
+		auto KeyOf = [](const GWObjects::DeviceLog &L) { return std::to_string(L.Recorded); };
 		if (QB_.Newest) {
 			StorageService()->GetNewestLogData(SerialNumber_, QB_.Limit, Logs, QB_.LogType);
+		} else if (Cursor.Present) {
+			//	Logs are returned newest first, so the cursor moves the upper bound down.
+			auto EndDate = QB_.EndDate ? std::min(QB_.EndDate, Cursor.NumericKey()) : Cursor.NumericKey();
+			StorageService()->GetLogData(SerialNumber_, QB_.StartDate, EndDate, Cursor.Skip,
+										 QB_.Limit, Logs, QB_.LogType);
 		} else {
 			StorageService()->GetLogData(SerialNumber_, QB_.StartDate, QB_.EndDate, QB_.Offset,
 										 QB_.Limit, Logs, QB_.LogType);
@@ -295,6 +322,11 @@ namespace OpenWifi {
 		Poco::JSON::Object RetObj;
 		RetObj.set(RESTAPI::Protocol::VALUES, ArrayObj);
 		RetObj.set(RESTAPI::Protocol::SERIALNUMBER, SerialNumber_);
+		if (!QB_.Newest) {
+			auto Next = Cursor.Next(Logs, QB_.Limit, KeyOf);
+			if (!Next.empty())
+				RetObj.set(RESTAPI::Protocol::NEXTCURSOR, Next);
+		}
 		ReturnObject(RetObj);
 	}
 
@@ -326,8 +358,16 @@ namespace OpenWifi {
 				return NotFound();
 			}
 		} else {
+			PageCursor	Cursor;
+			if (!Cursor.Decode(QB_.Cursor, true)) {
+				return BadRequest(RESTAPI::Errors::InvalidCursor);
+			}
+
 			if (QB_.Newest) {
 				StorageService()->GetNewestHealthCheckData(SerialNumber_, QB_.Limit, Checks);
+			} else if (Cursor.Present) {
+				StorageService()->GetHealthCheckData(SerialNumber_, std::max(QB_.StartDate, Cursor.NumericKey()),
+													 QB_.EndDate, Cursor.Skip, QB_.Limit, Checks);
 			} else {
 				StorageService()->GetHealthCheckData(SerialNumber_, QB_.StartDate, QB_.EndDate,
 													 QB_.Offset, QB_.Limit, Checks);
@@ -343,6 +383,12 @@ namespace OpenWifi {
 			Poco::JSON::Object RetObj;
 			RetObj.set(RESTAPI::Protocol::VALUES, ArrayObj);
 			RetObj.set(RESTAPI::Protocol::SERIALNUMBER, SerialNumber_);
+			if (!QB_.Newest) {
+				auto Next = Cursor.Next(Checks, QB_.Limit,
+										[](const GWObjects::HealthCheck &H) { return std::to_string(H.Recorded); });
+				if (!Next.empty())
+					RetObj.set(RESTAPI::Protocol::NEXTCURSOR, Next);
+			}
 			ReturnObject(RetObj);
 		}
 	}
@@ -14,6 +14,7 @@
 #include "framework/ow_constants.h"
 #include "framework/MicroService.h"
 #include "RESTAPI/RESTAPI_device_helper.h"
+#include "RESTAPI/RESTAPI_cursor.h"
 #include "Poco/StringTokenizer.h"
 #include "framework/orm.h"
 #include "AP_WS_Server.h"
@@ -77,12 +78,19 @@ namespace OpenWifi {
 		}
 
 		std::string OrderBy{" ORDER BY serialNumber ASC "}, Arg;
-		if(HasParameter("orderBy",Arg)) {
+		bool CustomOrder = HasParameter("orderBy",Arg);
+		if(CustomOrder) {
 			if(!PrepareOrderBy(Arg,OrderBy)) {
 				return BadRequest(RESTAPI::Errors::InvalidLOrderBy);
 			}
 		}
 
+		//	Cursors follow the primary key, so they only apply to the default serial number order.
+		PageCursor	Cursor;
+		if(!Cursor.Decode(QB_.Cursor,false) || (Cursor.Present && CustomOrder)) {
+			return BadRequest(RESTAPI::Errors::InvalidCursor);
+		}
+
 		auto serialOnly = GetBoolParameter(RESTAPI::Protocol::SERIALONLY, false);
 		auto deviceWithStatus = GetBoolParameter(RESTAPI::Protocol::DEVICEWITHSTATUS, false);
 		auto completeInfo = GetBoolParameter("completeInfo",false);
@@ -133,7 +141,10 @@ namespace OpenWifi {
 			RetObj.set(RESTAPI::Protocol::SERIALNUMBERS, Objects);
 		} else {
 			std::vector<GWObjects::Device> Devices;
-			StorageService()->GetDevices(QB_.Offset, QB_.Limit, Devices, OrderBy);
+			if(Cursor.Present)
+				StorageService()->GetDevicesAfter(Cursor.Key, QB_.Limit, Devices);
+			else
+				StorageService()->GetDevices(QB_.Offset, QB_.Limit, Devices, OrderBy);
 			Poco::JSON::Array Objects;
 			for (const auto &i : Devices) {
 				Poco::JSON::Object Obj;
@@ -147,6 +158,11 @@ namespace OpenWifi {
 				RetObj.set(RESTAPI::Protocol::DEVICESWITHSTATUS, Objects);
 			else
 				RetObj.set(RESTAPI::Protocol::DEVICES, Objects);
+			if(!CustomOrder) {
+				auto Next = Cursor.Next(Devices, QB_.Limit, [](const GWObjects::Device &D) { return D.SerialNumber; });
+				if(!Next.empty())
+					RetObj.set(RESTAPI::Protocol::NEXTCURSOR, Next);
+			}
 		}
 		ReturnObject(RetObj);
 	}
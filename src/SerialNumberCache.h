@@ -5,6 +5,7 @@
 #pragma once
 
 #include "framework/MicroService.h"
+#include "SerialNumberIndex.h"
 
 namespace OpenWifi {
 	class SerialNumberCache : public SubSystemServer {
@@ -18,11 +19,14 @@ namespace OpenWifi {
 		int Start() override;
 		void Stop() override;
 		void AddSerialNumber(const std::string &SerialNumber);
+		//	Used to load all the devices at startup: one sort instead of one sorted insert per device.
+		void AddSerialNumbers(std::vector<uint64_t> &SerialNumbers);
 		void DeleteSerialNumber(const std::string &SerialNumber);
+		//	"abc" or "abc*" matches a prefix, "*abc" a suffix and "*abc*" anywhere in the serial number.
 		void FindNumbers(const std::string &SerialNumber, uint HowMany, std::vector<uint64_t> &A);
 		inline bool NumberExists(uint64_t SerialNumber) {
 			std::lock_guard		G(Mutex_);
-			return std::find(SNs_.begin(),SNs_.end(),SerialNumber)!=SNs_.end();
+			return Index_.Exists(SerialNumber);
 		}
 
 		static inline std::string ReverseSerialNumber(const std::string &S) {
@@ -32,15 +36,11 @@ namespace OpenWifi {
 		}
 
 	  private:
-		std::vector<uint64_t>		SNs_;
-		std::vector<uint64_t>		Reverse_SNs_;
-
-		void ReturnNumbers(const std::string &S, uint HowMany, const std::vector<uint64_t> & SNArr, std::vector<uint64_t> &A, bool ReverseResult);
+		SerialNumberIndex				Index_;
 
 		SerialNumberCache() noexcept:
 			SubSystemServer("SerialNumberCache", "SNCACHE-SVR", "serialcache")
 			{
-				SNs_.reserve(2000);
 			}
 	};
 
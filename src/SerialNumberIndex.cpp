@@ -0,0 +1,159 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <algorithm>
+#include <cctype>
+
+#include "SerialNumberIndex.h"
+
+namespace OpenWifi {
+
+	//	Serial numbers are 12 hex digits.
+	static constexpr uint64_t SerialNumberDigits = 12;
+	static constexpr std::size_t MaxPending = 4096;
+
+	static uint64_t Reverse(uint64_t N) {
+		uint64_t Res = 0;
+
+		for (int i = 0; i < 16; i++) {
+			Res = (Res << 4) + (N & 0x000000000000000f);
+			N  >>= 4;
+		}
+		Res >>= 16;
+		return Res;
+	}
+
+	void SerialNumberIndex::Sorted::Insert(uint64_t SN) {
+		Pending.insert(std::lower_bound(Pending.begin(), Pending.end(), SN), SN);
+		if(Pending.size()>=MaxPending)
+			Merge();
+	}
+
+	void SerialNumberIndex::Sorted::Erase(uint64_t SN) {
+		auto It = std::lower_bound(Pending.begin(), Pending.end(), SN);
+		if(It!=Pending.end() && *It==SN) {
+			Pending.erase(It);
+			return;
+		}
+		It = std::lower_bound(Numbers.begin(), Numbers.end(), SN);
+		if(It!=Numbers.end() && *It==SN)
+			Numbers.erase(It);
+	}
+
+	void SerialNumberIndex::Sorted::Merge() {
+		auto Middle = Numbers.size();
+		Numbers.insert(Numbers.end(), Pending.begin(), Pending.end());
+		std::inplace_merge(Numbers.begin(), Numbers.begin() + Middle, Numbers.end());
+		Pending.clear();
+	}
+
+	void SerialNumberIndex::Sorted::Clear() {
+		Numbers.clear();
+		Pending.clear();
+	}
+
+	//	Walks both arrays in order over [Low,High) and returns up to HowMany numbers accepted by M.
+	template <typename Match> void SerialNumberIndex::Sorted::Find(uint64_t Low, uint64_t High, uint HowMany, Match M, std::vector<uint64_t> &A) const {
+		auto S = std::lower_bound(Numbers.begin(), Numbers.end(), Low);
+		auto SE = std::lower_bound(S, Numbers.end(), High);
+		auto P = std::lower_bound(Pending.begin(), Pending.end(), Low);
+		auto PE = std::lower_bound(P, Pending.end(), High);
+		while(HowMany && (S!=SE || P!=PE)) {
+			auto SN = (P==PE || (S!=SE && *S<*P)) ? *S++ : *P++;
+			if(M(SN)) {
+				A.push_back(SN);
+				--HowMany;
+			}
+		}
+	}
+
+	void SerialNumberIndex::Add(uint64_t SN) {
+		if(Members_.insert(SN).second) {
+			SNs_.Insert(SN);
+			Reverse_SNs_.Insert(Reverse(SN));
+		}
+	}
+
+	void SerialNumberIndex::Add(const std::vector<uint64_t> &SerialNumbers) {
+		Members_.reserve(Members_.size() + SerialNumbers.size());
+		for(const auto SN:SerialNumbers) {
+			if(!Members_.insert(SN).second)
+				continue;
+			SNs_.Numbers.push_back(SN);
+			Reverse_SNs_.Numbers.push_back(Reverse(SN));
+		}
+		std::sort(SNs_.Numbers.begin(), SNs_.Numbers.end());
+		std::sort(Reverse_SNs_.Numbers.begin(), Reverse_SNs_.Numbers.end());
+		SNs_.Merge();
+		Reverse_SNs_.Merge();
+	}
+
+	void SerialNumberIndex::Delete(uint64_t SN) {
+		if(Members_.erase(SN)) {
+			SNs_.Erase(SN);
+			Reverse_SNs_.Erase(Reverse(SN));
+		}
+	}
+
+	void SerialNumberIndex::Clear() {
+		Members_.clear();
+		SNs_.Clear();
+		Reverse_SNs_.Clear();
+	}
+
+	static bool HexDigits(const std::string &S, uint64_t &Value) {
+		if(S.empty() || S.size()>SerialNumberDigits)
+			return false;
+		if(!std::all_of(S.begin(), S.end(), ::isxdigit))
+			return false;
+		Value = std::stoull(S, nullptr, 16);
+		return true;
+	}
+
+	void SerialNumberIndex::Find(const std::string &S, uint HowMany, std::vector<uint64_t> &A) const {
+		if(S.empty() || HowMany==0)
+			return;
+
+		auto Any = [](uint64_t) { return true; };
+		bool Leading = S.front()=='*';
+		bool Trailing = S.size()>1 && S.back()=='*';
+		std::string Digits = S.substr(Leading ? 1 : 0, S.size() - (Leading ? 1 : 0) - (Trailing ? 1 : 0));
+
+		if(Leading && Trailing) {
+			//	No ordering helps here: check every position of every serial number.
+			uint64_t Pattern;
+			if(!HexDigits(Digits, Pattern))
+				return;
+			auto Shifts = SerialNumberDigits - Digits.size();
+			auto Mask = (uint64_t{1} << (4 * Digits.size())) - 1;
+			SNs_.Find(0, uint64_t{1} << (4 * SerialNumberDigits), HowMany,
+					  [Pattern, Shifts, Mask](uint64_t SN) {
+						  for(uint64_t i=0; i<=Shifts; ++i) {
+							  if(((SN >> (4 * i)) & Mask) == Pattern)
+								  return true;
+						  }
+						  return false;
+					  }, A);
+		} else if(Leading) {
+			//	A suffix is a prefix of the reversed serial number.
+			uint64_t Pattern;
+			if(!HexDigits(std::string(Digits.rbegin(), Digits.rend()), Pattern))
+				return;
+			auto Low = Pattern << (4 * (SerialNumberDigits - Digits.size()));
+			auto High = Low + (uint64_t{1} << (4 * (SerialNumberDigits - Digits.size())));
+			auto First = A.size();
+			Reverse_SNs_.Find(Low, High, HowMany, Any, A);
+			for(auto i=First; i<A.size(); ++i)
+				A[i] = Reverse(A[i]);
+		} else {
+			uint64_t Pattern;
+			if(!HexDigits(Digits, Pattern))
+				return;
+			auto Low = Pattern << (4 * (SerialNumberDigits - Digits.size()));
+			auto High = Low + (uint64_t{1} << (4 * (SerialNumberDigits - Digits.size())));
+			SNs_.Find(Low, High, HowMany, Any, A);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace OpenWifi {
+
+	//	Serial numbers as 48 bit integers: a hash set for membership, and the numbers and their reversed
+	//	digits in sorted arrays for prefix and suffix searches. Not thread safe, SerialNumberCache locks.
+	class SerialNumberIndex {
+	  public:
+		void Add(uint64_t SerialNumber);
+		//	One sort instead of one sorted insert per serial number.
+		void Add(const std::vector<uint64_t> &SerialNumbers);
+		void Delete(uint64_t SerialNumber);
+		void Clear();
+		[[nodiscard]] inline bool Exists(uint64_t SerialNumber) const { return Members_.find(SerialNumber)!=Members_.end(); }
+		[[nodiscard]] inline std::size_t size() const { return Members_.size(); }
+		//	"abc" or "abc*" matches a prefix, "*abc" a suffix and "*abc*" anywhere in the serial number.
+		void Find(const std::string &SerialNumber, uint HowMany, std::vector<uint64_t> &A) const;
+
+	  private:
+		//	A large sorted array plus a small sorted one that new serial numbers go to. The small one is
+		//	merged into the large one when it fills up, so adding a device does not move the whole array.
+		struct Sorted {
+			std::vector<uint64_t>	Numbers;
+			std::vector<uint64_t>	Pending;
+
+			void Insert(uint64_t SN);
+			void Erase(uint64_t SN);
+			void Merge();
+			void Clear();
+			template <typename Match> void Find(uint64_t Low, uint64_t High, uint HowMany, Match M, std::vector<uint64_t> &A) const;
+		};
+
+		std::unordered_set<uint64_t>	Members_;
+		Sorted							SNs_;
+		Sorted							Reverse_SNs_;
+	};
+}
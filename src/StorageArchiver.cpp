@@ -35,6 +35,7 @@ namespace OpenWifi {
 				poco_information(Logger(),fmt::format("Cannot archive DB '{}'", i.DBName));
 			}
 		}
+		StorageService()->RemoveOrphanedCapabilities();
 		AppServiceRegistry().Set("lastStorageArchiverRun", (uint64_t) Now);
 	}
 
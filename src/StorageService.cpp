@@ -14,7 +14,13 @@ namespace OpenWifi {
 		std::lock_guard		Guard(Mutex_);
 		StorageClass::Start();
 
+		Statements_.Start(*Pool_,
+						  MicroService::instance().ConfigGetBool("storage.statementcache.enable", true),
+						  MicroService::instance().ConfigGetInt("storage.statementcache.sessions", 8),
+						  MicroService::instance().ConfigGetInt("storage.statementcache.maxstatements", 64));
+		InitializePartitions();
 		Create_Tables();
+		StartPartitions();
         InitializeBlackListCache();
 
 		return 0;
@@ -23,6 +29,12 @@ namespace OpenWifi {
     void Storage::Stop() {
     	std::lock_guard		Guard(Mutex_);
         poco_notice(Logger(),"Stopping...");
+		StopPartitions();
+		Statements_.Stop();
+		auto S = Statements_.Stats();
+		poco_information(Logger(),fmt::format("Statement cache: hits: {} misses: {} uncached: {} errors: {} executions: {} average: {}us",
+											  S.Hits, S.Misses, S.Uncached, S.Errors, S.Executions,
+											  S.Executions ? S.ExecutionTime / S.Executions : 0));
 		StorageClass::Stop();
 		poco_notice(Logger(),"Stopped...");
     }
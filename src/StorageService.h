@@ -12,9 +12,16 @@
 #include "framework/StorageClass.h"
 #include "RESTObjects//RESTAPI_GWobjects.h"
 #include "Poco/Net/IPAddress.h"
+#include "Poco/Timer.h"
+
+#include "StorageStatementCache.h"
 
 namespace OpenWifi {
 
+	template <typename RecordTuple> struct InsertQuery : CachedStatement {
+		std::vector<RecordTuple>	Rows;
+	};
+
     class Storage : public StorageClass {
 
     public:
@@ -74,6 +81,41 @@ namespace OpenWifi {
 			return R;
 		}
 
+		//	Insert many rows using multi-row VALUES statements. Rows are split so we never go over the
+		//	bound parameter limits of the underlying database. Records are moved into the cached statement.
+		template <typename RecordTuple> bool InsertRecords(const std::string &Table, const std::string &Fields,
+														   const std::string &Values, std::vector<RecordTuple> &Records) {
+			try {
+				auto Columns = std::max((std::size_t)1, (std::size_t)std::count(Values.begin(), Values.end(), '?'));
+				auto MaxRows = std::max((std::size_t)1, (dbType_ == sqlite ? 999 : 30000) / Columns);
+				auto Lease = Statements_.Acquire();
+				for (std::size_t First = 0; First < Records.size(); First += MaxRows) {
+					auto Count = std::min(Records.size(), First + MaxRows) - First;
+					auto &Q = Lease->Get<InsertQuery<RecordTuple>>(
+						fmt::format("Insert:{}:{}", Table, Count),
+						[&](Poco::Data::Statement &Insert, InsertQuery<RecordTuple> &Query) {
+							std::string St{"INSERT INTO " + Table + " ( " + Fields + " ) VALUES "};
+							for (std::size_t i = 0; i < Count; i++) {
+								St += (i == 0 ? "( " : ",( ") + Values + " )";
+							}
+							Query.Rows.resize(Count);
+							Insert << ConvertParams(St);
+							for (auto &Row : Query.Rows) {
+								Insert , Poco::Data::Keywords::use(Row);
+							}
+						});
+					for (std::size_t i = 0; i < Count; i++) {
+						Q.Rows[i] = std::move(Records[First + i]);
+					}
+					Lease->Execute(Q);
+				}
+				return true;
+			} catch (const Poco::Exception &E) {
+				poco_warning(Logger(),fmt::format("{}({}): Failed with: {}", std::string(__func__), Table, E.displayText()));
+			}
+			return false;
+		}
+
         static auto instance() {
 			static auto instance_ = new Storage;
 			return instance_;
@@ -82,13 +124,16 @@ namespace OpenWifi {
 		// typedef std::map<std::string,std::string>	DeviceCapabilitiesCache;
 
         bool AddLog(const GWObjects::DeviceLog & Log);
+		bool AddLogs(const std::vector<GWObjects::DeviceLog> & Logs);
 		bool AddStatisticsData(const GWObjects::Statistics & Stats);
+		bool AddStatisticsData(const std::vector<GWObjects::Statistics> & Stats);
 		bool GetStatisticsData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset, uint64_t HowMany,
 							   std::vector<GWObjects::Statistics> &Stats);
 		bool DeleteStatisticsData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate );
 		bool GetNewestStatisticsData(std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats);
 
 		bool AddHealthCheckData(const GWObjects::HealthCheck &Check);
+		bool AddHealthCheckData(const std::vector<GWObjects::HealthCheck> &Checks);
 		bool GetHealthCheckData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset, uint64_t HowMany,
 								std::vector<GWObjects::HealthCheck> &Checks);
 		bool DeleteHealthCheckData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate );
@@ -102,6 +147,7 @@ namespace OpenWifi {
 
 		bool GetDevice(std::string &SerialNumber, GWObjects::Device &);
 		bool GetDevices(uint64_t From, uint64_t HowMany, std::vector<GWObjects::Device> &Devices, const std::string & orderBy="");
+		bool GetDevicesAfter(const std::string &After, uint64_t HowMany, std::vector<GWObjects::Device> &Devices);
 //		bool GetDevices(uint64_t From, uint64_t HowMany, const std::string & Select, std::vector<GWObjects::Device> &Devices, const std::string & orderBy="");
 		bool DeleteDevice(std::string &SerialNumber);
 		bool UpdateDevice(GWObjects::Device &);
@@ -121,6 +167,8 @@ namespace OpenWifi {
 		bool DeleteDeviceCapabilities(std::string & SerialNumber);
 		bool CreateDeviceCapabilities(std::string & SerialNumber, std::string & Capabilities);
 		bool InitCapabilitiesCache();
+		bool StoreDeviceCapabilities(std::string & SerialNumber, std::string & Capabilities);
+		bool RemoveOrphanedCapabilities();
 
 		bool GetLogData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset, uint64_t HowMany,
 						std::vector<GWObjects::DeviceLog> &Stats, uint64_t Type);
@@ -143,7 +191,8 @@ namespace OpenWifi {
 		bool UpdateCommand( std::string &UUID, GWObjects::CommandDetails & Command );
 		bool GetCommand( const std::string &UUID, GWObjects::CommandDetails & Command );
 		bool DeleteCommand( std::string &UUID );
-		bool GetReadyToExecuteCommands( uint64_t Offset, uint64_t HowMany, std::vector<GWObjects::CommandDetails> & Commands );
+		bool GetPendingCommands( uint64_t Offset, uint64_t HowMany, std::vector<GWObjects::CommandDetails> & Commands );
+		bool GetPendingCommand( const std::string &UUID, GWObjects::CommandDetails & Command );
 		bool CommandExecuted(std::string & UUID);
 		bool CommandCompleted(std::string & UUID, const Poco::JSON::Object & ReturnVars, const std::chrono::duration<double, std::milli> & execution_time, bool FullCommand);
 //		bool AttachFileToCommand(std::string & UUID);
@@ -177,6 +226,17 @@ namespace OpenWifi {
 		bool RemoveStatisticsRecordsOlderThan(uint64_t Date);
 		bool RemoveCommandListRecordsOlderThan(uint64_t Date);
 
+		//	Optional time partitioning of the append-only tables (Statistics, HealthChecks, DeviceLogs).
+		void InitializePartitions();
+		void StartPartitions();
+		void StopPartitions();
+		[[nodiscard]] bool Partitioned(const std::string &Table);
+		[[nodiscard]] std::string PartitionClause() const;
+		bool ListPartitions(const std::string &Table, std::vector<uint64_t> &Starts);
+		bool CreatePartitions(const std::string &Table, uint64_t UpTo);
+		bool DropPartitionsOlderThan(const std::string &Table, uint64_t Date);
+		void onPartitionTimer(Poco::Timer &timer);
+
 		int Create_Tables();
 		int Create_Statistics();
 		int Create_Devices();
@@ -187,15 +247,25 @@ namespace OpenWifi {
 		int Create_CommandList();
 		int Create_BlackList();
 		int Create_FileUploads();
+		void Upgrade_AppendOnlyTables();
+
+		//	Insertion order of a row in Statistics, HealthChecks and DeviceLogs: the last tie-breaker
+		//	of their ORDER BY.
+		[[nodiscard]] inline std::string SeqColumn() const { return dbType_ == sqlite ? "rowid" : "Seq"; }
 
 		bool AnalyzeCommands(Types::CountedMap &R);
-		bool AnalyzeDevices(GWObjects::Dashboard &D);
 
 		int 	Start() override;
 		void 	Stop() override;
 
 	  private:
-
+		StorageStatementCache							Statements_;
+		uint64_t 										PartitionPeriod_=0;
+		uint64_t 										PartitionsAhead_=3;
+		std::set<std::string>							PartitionedTables_;
+		std::mutex										PartitionMutex_;
+		Poco::Timer										PartitionTimer_;
+		std::unique_ptr<Poco::TimerCallback<Storage>>	PartitionCallback_;
    };
 
    inline auto StorageService() { return Storage::instance(); }
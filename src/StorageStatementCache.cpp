@@ -0,0 +1,94 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "Poco/Exception.h"
+
+#include "StorageStatementCache.h"
+
+namespace OpenWifi {
+
+	std::size_t StorageStatementCache::Lease::Execute(CachedStatement &Q) {
+		auto Start = std::chrono::steady_clock::now();
+		try {
+			auto Rows = Q.Statement->execute();
+			auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count();
+			std::lock_guard	G(Cache_.Mutex_);
+			Cache_.Stats_.Executions++;
+			Cache_.Stats_.ExecutionTime += Elapsed;
+			return Rows;
+		} catch (...) {
+			Failed_ = true;
+			Cache_.Count(&CacheStats::Errors);
+			throw;
+		}
+	}
+
+	void StorageStatementCache::Start(Poco::Data::SessionPool &Pool, bool Enabled, uint64_t MaxSessions, uint64_t MaxStatements) {
+		std::lock_guard	G(Mutex_);
+		Pool_ = &Pool;
+		Enabled_ = Enabled;
+		MaxSessions_ = std::max((uint64_t)1, MaxSessions);
+		MaxStatements_ = MaxStatements;
+	}
+
+	void StorageStatementCache::Stop() {
+		std::unique_lock	G(Mutex_);
+		Available_.wait(G, [this]{ return Leased_ == 0; });
+		Idle_.clear();
+		Stats_.Sessions = 0;
+		Pool_ = nullptr;
+	}
+
+	//	With the cache disabled every lease gets a fresh pooled session, which is how the service behaved
+	//	before: useful to compare query latency with and without prepared statements.
+	std::unique_ptr<StorageStatementCache::Lease> StorageStatementCache::Acquire() {
+		std::unique_lock	G(Mutex_);
+		if(Pool_==nullptr)
+			throw Poco::IllegalStateException("Statement cache is not started.");
+
+		if(Enabled_) {
+			Available_.wait(G, [this]{ return !Idle_.empty() || Stats_.Sessions < MaxSessions_; });
+			if(!Idle_.empty()) {
+				auto Session = std::move(Idle_.back());
+				Idle_.pop_back();
+				Leased_++;
+				return std::make_unique<Lease>(*this, std::move(Session));
+			}
+			Stats_.Sessions++;
+		}
+		Leased_++;
+		G.unlock();
+
+		try {
+			return std::make_unique<Lease>(*this, std::make_unique<CachedSession>(Pool_->get()));
+		} catch (...) {
+			Release(nullptr, true);
+			throw;
+		}
+	}
+
+	void StorageStatementCache::Release(std::unique_ptr<CachedSession> Session, bool Failed) {
+		//	Statements are finalized outside the lock, they may talk to the database.
+		std::unique_ptr<CachedSession>	Retired;
+		{
+			std::lock_guard	G(Mutex_);
+			Leased_--;
+			if(Enabled_ && Session && !Failed) {
+				Idle_.push_back(std::move(Session));
+			} else {
+				if(Enabled_ && Stats_.Sessions)
+					Stats_.Sessions--;
+				Retired = std::move(Session);
+			}
+		}
+		Available_.notify_all();
+		Retired.reset();
+	}
+
+	StorageStatementCache::CacheStats StorageStatementCache::Stats() const {
+		std::lock_guard	G(Mutex_);
+		return Stats_;
+	}
+}
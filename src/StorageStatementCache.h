@@ -0,0 +1,113 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Poco/Data/Session.h"
+#include "Poco/Data/SessionPool.h"
+#include "Poco/Data/Statement.h"
+
+namespace OpenWifi {
+
+	//	A statement prepared once and executed many times. Derived queries hold the parameter and result
+	//	variables as members: they are bound by reference when the statement is prepared, so a caller
+	//	only assigns new values and executes.
+	struct CachedStatement {
+		virtual ~CachedStatement() = default;
+		std::unique_ptr<Poco::Data::Statement>	Statement;
+	};
+
+	//	Sessions are checked out of the pool for the lifetime of the cache and keep the statements that
+	//	were prepared on them, so the database plans each hot query once per session instead of once
+	//	per call. A session is leased to one caller at a time.
+	class StorageStatementCache {
+	  public:
+		struct CacheStats {
+			uint64_t	Hits=0, Misses=0, Uncached=0, Executions=0, Errors=0, Sessions=0, ExecutionTime=0;
+		};
+
+		struct CachedSession {
+			explicit CachedSession(Poco::Data::Session S) : Session(std::move(S)) {}
+			Poco::Data::Session										Session;
+			std::map<std::string,std::unique_ptr<CachedStatement>>	Statements;
+		};
+
+		class Lease {
+		  public:
+			Lease(StorageStatementCache &Cache, std::unique_ptr<CachedSession> Session)
+				: Cache_(Cache), Session_(std::move(Session)) {}
+			Lease(const Lease &) = delete;
+			Lease &operator=(const Lease &) = delete;
+			~Lease() {
+				Transient_.reset();
+				Cache_.Release(std::move(Session_), Failed_);
+			}
+
+			//	Returns the statement cached under Key, or prepares it with Prepare(Statement, Query).
+			template <typename Query, typename Prepare> Query &Get(const std::string &Key, Prepare &&P) {
+				auto Hint = Session_->Statements.find(Key);
+				if(Hint!=Session_->Statements.end()) {
+					Cache_.Count(&CacheStats::Hits);
+					return static_cast<Query &>(*Hint->second);
+				}
+				auto Q = std::make_unique<Query>();
+				try {
+					Q->Statement = std::make_unique<Poco::Data::Statement>(Session_->Session);
+					P(*Q->Statement, *Q);
+				} catch (...) {
+					Failed_ = true;
+					throw;
+				}
+				auto &Result = *Q;
+				if(Cache_.Enabled_ && Session_->Statements.size()<Cache_.MaxStatements_) {
+					Cache_.Count(&CacheStats::Misses);
+					Session_->Statements[Key] = std::move(Q);
+				} else {
+					Cache_.Count(&CacheStats::Uncached);
+					Transient_ = std::move(Q);
+				}
+				return Result;
+			}
+
+			//	A failed statement also retires its session, so the next lease starts from a clean one.
+			std::size_t Execute(CachedStatement &Q);
+
+		  private:
+			StorageStatementCache 				&Cache_;
+			std::unique_ptr<CachedSession>		Session_;
+			std::unique_ptr<CachedStatement>	Transient_;
+			bool								Failed_=false;
+		};
+
+		void Start(Poco::Data::SessionPool &Pool, bool Enabled, uint64_t MaxSessions, uint64_t MaxStatements);
+		void Stop();
+		[[nodiscard]] std::unique_ptr<Lease> Acquire();
+		[[nodiscard]] CacheStats Stats() const;
+
+	  private:
+		mutable std::mutex								Mutex_;
+		std::condition_variable							Available_;
+		Poco::Data::SessionPool							*Pool_=nullptr;
+		bool											Enabled_=false;
+		uint64_t										MaxSessions_=8;
+		uint64_t										MaxStatements_=64;
+		uint64_t										Leased_=0;
+		std::vector<std::unique_ptr<CachedSession>>		Idle_;
+		CacheStats										Stats_;
+
+		void Release(std::unique_ptr<CachedSession> Session, bool Failed);
+		inline void Count(uint64_t CacheStats::*Counter, uint64_t Value=1) {
+			std::lock_guard	G(Mutex_);
+			Stats_.*Counter += Value;
+		}
+	};
+}
@@ -0,0 +1,156 @@
+#include "StorageWriteBehind.h"
+#include "StorageService.h"
+#include "DeviceHistory.h"
+
+namespace OpenWifi {
+
+	int StorageWriteBehind::Start() {
+		Enabled_ = MicroService::instance().ConfigGetBool("storage.writebehind.enable", true);
+		BatchSize_ = std::max((std::uint64_t)1, MicroService::instance().ConfigGetInt("storage.writebehind.batchsize", 500));
+		FlushInterval_ = std::max((std::uint64_t)10, MicroService::instance().ConfigGetInt("storage.writebehind.flushinterval", 1000));
+		MaxQueueSize_ = std::max(BatchSize_, MicroService::instance().ConfigGetInt("storage.writebehind.maxqueue", 50000));
+		MaxWait_ = MicroService::instance().ConfigGetInt("storage.writebehind.maxwait", 0);
+
+		if(!Enabled_) {
+			poco_information(Logger(),"Write-behind is disabled, records are written synchronously.");
+			return 0;
+		}
+
+		poco_information(Logger(),fmt::format("Starting: batch={} interval={}ms queue={} wait={}ms",
+											  BatchSize_, FlushInterval_, MaxQueueSize_, MaxWait_));
+		Running_ = true;
+		Worker_.start(*this);
+		return 0;
+	}
+
+	void StorageWriteBehind::Stop() {
+		poco_information(Logger(),"Stopping...");
+		if(Enabled_) {
+			{
+				std::lock_guard	Lock(QueueMutex_);
+				Running_ = false;
+			}
+			Readable_.notify_all();
+			Writable_.notify_all();
+			Worker_.join();
+			auto S = Stats();
+			poco_information(Logger(),fmt::format("Written: {} Dropped: {} Failed: {} Flushes: {}",
+												  S.Written, S.Dropped, S.Failed, S.Flushes));
+		}
+		poco_information(Logger(),"Stopped...");
+	}
+
+	StorageWriteBehind::WriterStats StorageWriteBehind::Stats() const {
+		std::lock_guard	Lock(QueueMutex_);
+		return Stats_;
+	}
+
+	template <typename T> StorageWriteBehind::Outcome StorageWriteBehind::Enqueue(std::deque<T> &Queue, const T &Record) {
+		std::unique_lock	Lock(QueueMutex_);
+		if(!Running_)
+			return Outcome::Synchronous;
+
+		if(QueueSize()>=MaxQueueSize_ && MaxWait_) {
+			Writable_.wait_for(Lock, std::chrono::milliseconds(MaxWait_),
+							   [this]{ return QueueSize()<MaxQueueSize_ || !Running_; });
+		}
+
+		if(QueueSize()>=MaxQueueSize_) {
+			Stats_.Dropped++;
+			return Outcome::Dropped;
+		}
+
+		Queue.push_back(Record);
+		Stats_.Queued++;
+		Stats_.MaxQueueSize = std::max(Stats_.MaxQueueSize, QueueSize());
+		if(QueueSize()>=BatchSize_)
+			Readable_.notify_one();
+		return Outcome::Queued;
+	}
+
+	//	The device history only gets records that are on their way to the database, so that it never
+	//	answers with a record a database query would not return.
+	void StorageWriteBehind::AddStatisticsData(const GWObjects::Statistics &Stats) {
+		auto Result = Enqueue(Statistics_, Stats);
+		if(Result==Outcome::Synchronous && !StorageService()->AddStatisticsData(Stats))
+			return;
+		if(Result!=Outcome::Dropped)
+			DeviceHistory()->AddStatistics(Stats);
+	}
+
+	void StorageWriteBehind::AddHealthCheckData(const GWObjects::HealthCheck &Check) {
+		auto Result = Enqueue(HealthChecks_, Check);
+		if(Result==Outcome::Synchronous && !StorageService()->AddHealthCheckData(Check))
+			return;
+		if(Result!=Outcome::Dropped)
+			DeviceHistory()->AddHealthCheck(Check);
+	}
+
+	void StorageWriteBehind::AddLog(const GWObjects::DeviceLog &Log) {
+		if(Enqueue(Logs_, Log)==Outcome::Synchronous)
+			StorageService()->AddLog(Log);
+	}
+
+	template <typename T> static void TakeBatch(std::deque<T> &Queue, std::vector<T> &Batch, std::uint64_t BatchSize) {
+		auto Count = std::min((std::uint64_t)Queue.size(), BatchSize);
+		Batch.reserve(Count);
+		for(std::uint64_t i=0;i<Count;i++) {
+			Batch.emplace_back(std::move(Queue.front()));
+			Queue.pop_front();
+		}
+	}
+
+	void StorageWriteBehind::Flush(bool All) {
+		do {
+			std::vector<GWObjects::Statistics>	Statistics;
+			std::vector<GWObjects::HealthCheck>	HealthChecks;
+			std::vector<GWObjects::DeviceLog>	Logs;
+			std::uint64_t 						Dropped, Now = OpenWifi::Now();
+			{
+				std::lock_guard	Lock(QueueMutex_);
+				if(QueueSize()==0)
+					return;
+				TakeBatch(Statistics_, Statistics, BatchSize_);
+				TakeBatch(HealthChecks_, HealthChecks, BatchSize_);
+				TakeBatch(Logs_, Logs, BatchSize_);
+				Dropped = Stats_.Dropped;
+			}
+			Writable_.notify_all();
+
+			std::uint64_t Written=0, Failed=0;
+			auto Account = [&](bool Success, std::size_t Count) { (Success ? Written : Failed) += Count; };
+			if(!Statistics.empty())
+				Account(StorageService()->AddStatisticsData(Statistics), Statistics.size());
+			if(!HealthChecks.empty())
+				Account(StorageService()->AddHealthCheckData(HealthChecks), HealthChecks.size());
+			if(!Logs.empty())
+				Account(StorageService()->AddLogs(Logs), Logs.size());
+
+			{
+				std::lock_guard	Lock(QueueMutex_);
+				Stats_.Written += Written;
+				Stats_.Failed += Failed;
+				Stats_.Flushes++;
+			}
+
+			if(Dropped!=LastDropReport_ && (Now-LastDropReportTime_)>60) {
+				poco_warning(Logger(),fmt::format("Database is falling behind: {} records dropped so far.", Dropped));
+				LastDropReport_ = Dropped;
+				LastDropReportTime_ = Now;
+			}
+		} while(All);
+	}
+
+	void StorageWriteBehind::run() {
+		Utils::SetThreadName("strg-writer");
+		while(Running_) {
+			{
+				std::unique_lock	Lock(QueueMutex_);
+				Readable_.wait_for(Lock, std::chrono::milliseconds(FlushInterval_),
+								   [this]{ return QueueSize()>=BatchSize_ || !Running_; });
+			}
+			Flush(false);
+		}
+		Flush(true);
+	}
+}
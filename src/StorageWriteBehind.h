@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "framework/MicroService.h"
+#include "RESTObjects/RESTAPI_GWobjects.h"
+
+namespace OpenWifi {
+
+	//	Append-only device records (statistics, healthchecks, and logs) are queued here and written by
+	//	a single background thread using multi-row inserts. The reactor threads never wait on the DB
+	//	unless the queue is full and a maximum wait has been configured.
+	class StorageWriteBehind : public SubSystemServer, Poco::Runnable {
+	  public:
+		static auto instance() {
+			static auto instance_ = new StorageWriteBehind;
+			return instance_;
+		}
+
+		int Start() override;
+		void Stop() override;
+		void run() override;
+
+		void AddStatisticsData(const GWObjects::Statistics &Stats);
+		void AddHealthCheckData(const GWObjects::HealthCheck &Check);
+		void AddLog(const GWObjects::DeviceLog &Log);
+
+		struct WriterStats {
+			std::uint64_t	Queued=0, Written=0, Dropped=0, Failed=0, Flushes=0, MaxQueueSize=0;
+		};
+		WriterStats Stats() const;
+
+	  private:
+		std::atomic_bool						Running_=false;
+		bool									Enabled_=true;
+		std::uint64_t							BatchSize_=500;
+		std::uint64_t							FlushInterval_=1000;
+		std::uint64_t							MaxQueueSize_=50000;
+		std::uint64_t							MaxWait_=0;
+		Poco::Thread							Worker_;
+		mutable std::mutex						QueueMutex_;
+		std::condition_variable					Readable_;
+		std::condition_variable					Writable_;
+		std::deque<GWObjects::Statistics>		Statistics_;
+		std::deque<GWObjects::HealthCheck>		HealthChecks_;
+		std::deque<GWObjects::DeviceLog>		Logs_;
+		WriterStats								Stats_;
+		std::uint64_t							LastDropReport_=0;
+		std::uint64_t							LastDropReportTime_=0;
+
+		//	What became of a record handed to Enqueue: the caller writes it itself when not running.
+		enum class Outcome { Synchronous, Queued, Dropped };
+
+		inline std::uint64_t QueueSize() const { return Statistics_.size() + HealthChecks_.size() + Logs_.size(); }
+		template <typename T> Outcome Enqueue(std::deque<T> &Queue, const T &Record);
+		void Flush(bool All);
+
+		StorageWriteBehind() noexcept:
+			SubSystemServer("StorageWriteBehind", "STORAGE-WRITER", "storage.writebehind") {
+		}
+	};
+
+	inline auto StorageWriteBehind() { return StorageWriteBehind::instance(); }
+
+}
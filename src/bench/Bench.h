@@ -0,0 +1,83 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+
+namespace OpenWifi::Bench {
+
+	//	Keeps the optimizer from dropping a result the benchmark does not otherwise use.
+	template <typename T> inline void Keep(const T &Value) {
+		asm volatile("" : : "g"(&Value) : "memory");
+	}
+
+	struct Case {
+		std::string 			Name;
+		std::string 			Description;
+		std::function<void()> 	Run;
+	};
+
+	inline std::vector<Case> &Cases() {
+		static std::vector<Case> C;
+		return C;
+	}
+
+	//	Each benchmark file registers its case with a static Register.
+	struct Register {
+		Register(const char *Name, const char *Description, std::function<void()> Run) {
+			Cases().push_back(Case{Name, Description, std::move(Run)});
+		}
+	};
+
+	//	--name=value arguments, for the benchmarks that need a file or a size.
+	inline std::map<std::string, std::string> &Options() {
+		static std::map<std::string, std::string> O;
+		return O;
+	}
+
+	inline std::string Option(const std::string &Name, const std::string &Default = "") {
+		auto Hint = Options().find(Name);
+		return Hint == Options().end() ? Default : Hint->second;
+	}
+
+	inline uint64_t Option(const std::string &Name, uint64_t Default) {
+		auto Hint = Options().find(Name);
+		return Hint == Options().end() ? Default : std::stoull(Hint->second);
+	}
+
+	//	Prints Operations done in Elapsed seconds and returns the rate in operations per second.
+	inline double Report(const std::string &Label, uint64_t Operations, double Elapsed) {
+		auto Rate = Elapsed > 0.0 ? (double)Operations / Elapsed : 0.0;
+		std::cout << fmt::format("  {:<44} {:>10} ops {:>10.1f} ms {:>14.0f} ops/s {:>10.3f} us/op", Label,
+								 Operations, Elapsed * 1000.0, Rate, Operations ? Elapsed * 1e6 / (double)Operations : 0.0)
+				  << std::endl;
+		return Rate;
+	}
+
+	inline double Since(std::chrono::steady_clock::time_point Start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+	//	Calls Body(i) Iterations times, prints the rate and returns it in operations per second.
+	template <typename F> double Measure(const std::string &Label, uint64_t Iterations, F Body) {
+		auto Start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < Iterations; i++)
+			Body(i);
+		return Report(Label, Iterations, Since(Start));
+	}
+
+	inline void Speedup(const std::string &Label, double Before, double After) {
+		std::cout << fmt::format("  {:<44} {:.2f}x", Label, Before > 0.0 ? After / Before : 0.0) << std::endl;
+	}
+}
@@ -0,0 +1,30 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+//	The framework expects the service to provide its REST routers and post initialization. The
+//	benchmark service never initializes nor serves anything, these only satisfy the linker.
+
+#include "bench/BenchService.h"
+
+namespace OpenWifi {
+
+	Poco::Net::HTTPRequestHandler *RESTAPI_ExtRouter([[maybe_unused]] const std::string &Path,
+													 [[maybe_unused]] RESTAPIHandler::BindingMap &Bindings,
+													 [[maybe_unused]] Poco::Logger &L,
+													 [[maybe_unused]] RESTAPI_GenericServer &S,
+													 [[maybe_unused]] uint64_t Id) {
+		return nullptr;
+	}
+
+	Poco::Net::HTTPRequestHandler *RESTAPI_IntRouter([[maybe_unused]] const std::string &Path,
+													 [[maybe_unused]] RESTAPIHandler::BindingMap &Bindings,
+													 [[maybe_unused]] Poco::Logger &L,
+													 [[maybe_unused]] RESTAPI_GenericServer &S,
+													 [[maybe_unused]] uint64_t Id) {
+		return nullptr;
+	}
+
+	void DaemonPostInitialization([[maybe_unused]] Poco::Util::Application &self) {}
+}
@@ -0,0 +1,30 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include "Poco/Util/MapConfiguration.h"
+
+#include "framework/MicroService.h"
+
+namespace OpenWifi::Bench {
+
+	//	The framework subsystems read their settings through MicroService::instance(). The benchmarks
+	//	use a service that is never initialized, whose configuration is an in-memory map set with Set().
+	inline MicroService &Service() {
+		static auto Instance = [] {
+			auto S = new MicroService("owgw-bench.properties", "OWGW_ROOT", "OWGW_CONFIG", "owgw-bench", 0,
+									  SubSystemVec{});
+			S->config().addWriteable(new Poco::Util::MapConfiguration, Poco::Util::Application::PRIO_DEFAULT);
+			return S;
+		}();
+		return *Instance;
+	}
+
+	inline void Set(const std::string &Key, const std::string &Value) { Service().config().setString(Key, Value); }
+
+	//	Gives a subsystem its logger and configuration, without starting it.
+	inline void Initialize(SubSystemServer &SubSystem) { SubSystem.initialize(Service()); }
+}
@@ -0,0 +1,115 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <sstream>
+
+#include "Poco/Base64Decoder.h"
+#include "Poco/Base64Encoder.h"
+#include "Poco/StreamCopier.h"
+
+#include "bench/Bench.h"
+#include "framework/MicroService.h"
+
+namespace OpenWifi::Bench {
+
+	//	Utils::ExtractBase64CompressedData as it was: base64 through streams, then inflate into a buffer
+	//	whose size is guessed, retried with a larger guess each time it is too small. The buffer has one
+	//	more byte than the guess, the original wrote its terminator past the end on an exact fit.
+	static bool ExtractBefore(const std::string &CompressedData, std::string &UnCompressedData, uint64_t compress_sz) {
+		std::istringstream ifs(CompressedData);
+		Poco::Base64Decoder b64in(ifs);
+		std::ostringstream ofs;
+		Poco::StreamCopier::copyStream(b64in, ofs);
+
+		int factor = 20;
+		unsigned long MaxSize = compress_sz ? (unsigned long)(compress_sz + 5000) : (unsigned long)(ofs.str().size() * factor);
+		while (true) {
+			std::vector<uint8_t> UncompressedBuffer(MaxSize + 1);
+			unsigned long FinalSize = MaxSize;
+			auto status = uncompress((uint8_t *)&UncompressedBuffer[0], &FinalSize, (uint8_t *)ofs.str().c_str(),
+									 ofs.str().size());
+			if (status == Z_OK) {
+				UncompressedBuffer[FinalSize] = 0;
+				UnCompressedData = (char *)&UncompressedBuffer[0];
+				return true;
+			}
+			if (status == Z_BUF_ERROR) {
+				if (factor < 300) {
+					factor += 10;
+					MaxSize = ofs.str().size() * factor;
+					continue;
+				} else {
+					return false;
+				}
+			}
+			return false;
+		}
+	}
+
+	//	A wifiscan-like document: repetitive enough to compress the way real ones do.
+	static std::string Document(uint64_t Size) {
+		std::string Result{R"({"scan":[)"};
+		for (uint64_t i = 0; Result.size() < Size; i++) {
+			if (i)
+				Result += ',';
+			Result += fmt::format(
+				R"lit({{"bssid":"aa:bb:cc:{:02x}:{:02x}:{:02x}","ssid":"Network-{}","frequency":{},"channel":{},"signal":-{},"tsf":{},"capability":{},"ies":[{{"type":0,"data":"{:08x}"}}]}})lit",
+				(i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, i % 97, 2412 + 5 * (i % 13), 1 + i % 13,
+				30 + (i * 7) % 60, i * 104729, 1057 + i % 5, (uint32_t)(i * 2654435761u));
+		}
+		return Result + "]}";
+	}
+
+	static std::string Compress64(const std::string &Data) {
+		uLongf Size = compressBound(Data.size());
+		std::vector<uint8_t> Compressed(Size);
+		compress(Compressed.data(), &Size, (const uint8_t *)Data.data(), Data.size());
+		std::ostringstream OS;
+		Poco::Base64Encoder Encoder(OS);
+		Encoder.rdbuf()->setLineLength(0);
+		Encoder.write((const char *)Compressed.data(), (std::streamsize)Size);
+		Encoder.close();
+		return OS.str();
+	}
+
+	static void Decompress() {
+		struct Payload {
+			const char 	*Name;
+			uint64_t 	Size;
+			uint64_t 	Iterations;
+		};
+		std::vector<Payload> Payloads{
+			{"4KB", 4 * 1024, 20000},
+			{"64KB", 64 * 1024, 2000},
+			{"1MB", 1024 * 1024, 100},
+		};
+
+		for (const auto &P : Payloads) {
+			auto Original = Document(P.Size);
+			auto Compressed = Compress64(Original);
+			std::string Out;
+			if (!Utils::ExtractBase64CompressedData(Compressed, Out, Original.size()) || Out != Original ||
+				!ExtractBefore(Compressed, Out, Original.size()) || Out != Original) {
+				std::cout << "  " << P.Name << ": payloads do not round trip." << std::endl;
+				continue;
+			}
+
+			//	compress_sz is sent by the devices, but not always: then the old code had to guess.
+			for (auto Known : {true, false}) {
+				auto Size = Known ? Original.size() : 0;
+				auto Label = fmt::format("{} ({} base64 bytes, compress_sz {})", P.Name, Compressed.size(),
+										 Known ? "sent" : "missing");
+				auto Before = Measure(Label + " before", P.Iterations,
+									  [&](uint64_t) { Keep(ExtractBefore(Compressed, Out, Size)); });
+				auto After = Measure(Label + " single pass", P.Iterations,
+									 [&](uint64_t) { Keep(Utils::ExtractBase64CompressedData(Compressed, Out, Size)); });
+				Speedup(Label, Before, After);
+			}
+		}
+	}
+
+	static Register DecompressCase("decompress", "compress_64 payloads decoded/s, stream based vs single pass",
+								   Decompress);
+}
@@ -0,0 +1,73 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "Poco/JSON/Object.h"
+#include "Poco/JSON/Parser.h"
+
+#include "AP_WS_FrameScanner.h"
+#include "bench/Bench.h"
+
+namespace OpenWifi::Bench {
+
+	static std::string StateFrame() {
+		std::string Associations;
+		for (int i = 0; i < 16; i++) {
+			if (!Associations.empty())
+				Associations += ',';
+			Associations += fmt::format(
+				R"lit({{"station":"aa:bb:cc:00:00:{:02x}","rssi":-{},"rx_bytes":{},"tx_bytes":{},"rx_rate":{{"bitrate":866700,"mcs":9,"nss":2}}}})lit",
+				i, 40 + i, 1000000 * i, 2000000 * i);
+		}
+		return fmt::format(
+			R"lit({{"jsonrpc":"2.0","method":"state","params":{{"serial":"24f5a2070a00","uuid":1666051200,"state":{{)lit"
+			R"lit("unit":{{"uptime":86400,"localtime":1666051200,"memory":{{"total":536870912,"free":268435456}},"load":[1200,900,600]}},)lit"
+			R"lit("interfaces":[{{"name":"up0v0","ssids":[{{"ssid":"OpenWifi","mode":"ap","associations":[{}]}}]}}]}}}}}})lit",
+			Associations);
+	}
+
+	//	What the connection did for every frame before the scanner: a full DOM, then the few fields
+	//	used to dispatch it.
+	static bool ParseFull(const std::string &Frame, std::string &Method, std::string &Serial) {
+		Poco::JSON::Parser P;
+		auto Doc = P.parse(Frame).extract<Poco::JSON::Object::Ptr>();
+		if (!Doc->has("jsonrpc") || !Doc->has("method") || !Doc->has("params"))
+			return false;
+		Method = Doc->get("method").toString();
+		auto Params = Doc->getObject("params");
+		if (Params && Params->has("serial"))
+			Serial = Params->get("serial").toString();
+		return true;
+	}
+
+	static bool Scan(const std::string &Frame, std::string &Method, std::string &Serial) {
+		AP_WS_FrameScanner S(Frame);
+		return S.Valid() && S.IsEvent() && S.Method(Method) && S.Serial(Serial);
+	}
+
+	static void FrameScanner() {
+		struct Sample {
+			const char 		*Name;
+			std::string 	Frame;
+			uint64_t 		Iterations;
+		};
+		std::vector<Sample> Samples{
+			{"ping", R"({"jsonrpc":"2.0","method":"ping","params":{"serial":"24f5a2070a00","uuid":1666051200}})", 500000},
+			{"healthcheck", R"({"jsonrpc":"2.0","method":"healthcheck","params":{"serial":"24f5a2070a00","uuid":1666051200,"sanity":100,"data":{"dhcp":{"up0v0":true},"dns":{"up0v0":true}}}})", 200000},
+			{"state", StateFrame(), 50000},
+		};
+
+		for (const auto &S : Samples) {
+			std::string Method, Serial;
+			auto Full = Measure(fmt::format("{} ({} bytes) Poco::JSON::Parser", S.Name, S.Frame.size()), S.Iterations,
+								[&](uint64_t) { Keep(ParseFull(S.Frame, Method, Serial)); });
+			auto Scanned = Measure(fmt::format("{} ({} bytes) AP_WS_FrameScanner", S.Name, S.Frame.size()), S.Iterations,
+								   [&](uint64_t) { Keep(Scan(S.Frame, Method, Serial)); });
+			Speedup(fmt::format("{} frames/s, scanner vs parser", S.Name), Full, Scanned);
+		}
+	}
+
+	static Register FrameScannerCase("framescanner", "frames/s dispatched with the frame scanner and with a full parse",
+									 FrameScanner);
+}
@@ -0,0 +1,119 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <stdexcept>
+
+#include <librdkafka/rdkafka.h>
+#include <librdkafka/rdkafka_mock.h>
+
+#include "bench/Bench.h"
+#include "bench/BenchService.h"
+
+namespace OpenWifi::Bench {
+
+	//	librdkafka's mock cluster stands in for the brokers: it speaks the protocol on a local port and
+	//	acknowledges everything, so what is measured is the producer and not a network.
+	class MockCluster {
+	  public:
+		MockCluster() {
+			char Error[512];
+			Handle_ = rd_kafka_new(RD_KAFKA_PRODUCER, rd_kafka_conf_new(), Error, sizeof(Error));
+			if (Handle_ == nullptr)
+				throw std::runtime_error(Error);
+			Cluster_ = rd_kafka_mock_cluster_new(Handle_, 1);
+			if (Cluster_ == nullptr)
+				throw std::runtime_error("Could not create the mock cluster.");
+		}
+
+		~MockCluster() {
+			rd_kafka_mock_cluster_destroy(Cluster_);
+			rd_kafka_destroy(Handle_);
+		}
+
+		void CreateTopic(const std::string &Topic, int Partitions) {
+			rd_kafka_mock_topic_create(Cluster_, Topic.c_str(), Partitions, 1);
+		}
+
+		[[nodiscard]] std::string Bootstraps() const { return rd_kafka_mock_cluster_bootstraps(Cluster_); }
+
+	  private:
+		rd_kafka_t 					*Handle_ = nullptr;
+		rd_kafka_mock_cluster_t 	*Cluster_ = nullptr;
+	};
+
+	static void Kafka() {
+		auto Messages = Option("messages", (uint64_t)200000);
+		auto Devices = Option("devices", (uint64_t)10000);
+
+		MockCluster Cluster;
+		Cluster.CreateTopic("state", 8);
+
+		Set("openwifi.kafka.client.id", "owgw-bench");
+		Set("openwifi.kafka.brokerlist", Cluster.Bootstraps());
+		Set("openwifi.kafka.producer.queue.size", std::to_string(Messages));
+		Set("openwifi.kafka.producer.queue.policy", "block");
+		Set("openwifi.kafka.producer.queue.maxwait", "60000");
+		Set("openwifi.kafka.producer.flush.timeout", "60000");
+		Initialize(*KafkaManager());
+
+		std::string Payload(2048, 'x');
+		std::vector<std::string> Keys;
+		for (uint64_t i = 0; i < Devices; i++)
+			Keys.emplace_back(fmt::format("{:012x}", 0x24f5a2000000 + i));
+
+		struct Variant {
+			const char 	*Name;
+			const char 	*Linger, *Batch, *Compression;
+			uint64_t 	Threads;
+		};
+		//	The first one is what the producer did before: every message sent on its own.
+		std::vector<Variant> Variants{
+			{"per message", "0", "1", "none", 1},
+			{"batched, linger 50ms", "50", "10000", "none", 1},
+			{"batched, linger 50ms, lz4", "50", "10000", "lz4", 1},
+			{"batched, linger 50ms, lz4, 4 threads", "50", "10000", "lz4", 4},
+		};
+
+		double Before = 0.0;
+		for (const auto &V : Variants) {
+			Set("openwifi.kafka.queue.buffering.max.ms", V.Linger);
+			Set("openwifi.kafka.producer.batch.messages", V.Batch);
+			Set("openwifi.kafka.producer.compression", V.Compression);
+
+			std::vector<std::unique_ptr<KafkaProducer>> Producers;
+			for (uint64_t i = 0; i < V.Threads; i++) {
+				Producers.emplace_back(std::make_unique<KafkaProducer>());
+				Producers.back()->Start(i);
+			}
+
+			//	Timed until the last message is acknowledged: Stop() flushes.
+			auto Start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < Messages; i++) {
+				const auto &Key = Keys[i % Keys.size()];
+				auto &Producer = Producers[std::hash<std::string>{}(Key) % Producers.size()];
+				Producer->Produce("state", Key, std::string(Payload));
+			}
+			for (auto &Producer : Producers)
+				Producer->Stop();
+			auto Elapsed = Since(Start);
+
+			KafkaProducer::ProducerStats Total;
+			for (const auto &Producer : Producers) {
+				auto S = Producer->Stats();
+				Total.Delivered += S.Delivered;
+				Total.Dropped += S.Dropped;
+				Total.Failed += S.Failed;
+			}
+			auto Rate = Report(fmt::format("{} (dropped {}, failed {})", V.Name, Total.Dropped, Total.Failed),
+							   Total.Delivered, Elapsed);
+			if (Before == 0.0)
+				Before = Rate;
+			else
+				Speedup(fmt::format("{} vs per message", V.Name), Before, Rate);
+		}
+	}
+
+	static Register KafkaCase("kafka", "messages/s delivered to a mock broker, per message and batched", Kafka);
+}
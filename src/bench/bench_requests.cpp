@@ -0,0 +1,129 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "CommandManager.h"
+#include "bench/Bench.h"
+
+namespace OpenWifi::Bench {
+
+	using CommandInfo = CommandManager::CommandInfo;
+
+	//	The outstanding requests as they were: one map by RPC id, every other lookup a full scan.
+	class ScannedRequests {
+	  public:
+		void Add(std::uint64_t Id, const CommandInfo &Info) { Requests_[Id] = Info; }
+
+		bool CommandRunningForDevice(std::uint64_t SerialNumber, std::string &UUID, std::string &Command) {
+			for (const auto &[Request, Info] : Requests_) {
+				if (Info.SerialNumber == SerialNumber) {
+					UUID = Info.UUID;
+					Command = Info.Command;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool IsCommandRunning(const std::string &C) {
+			for (const auto &Request : Requests_) {
+				if (Request.second.UUID == C)
+					return true;
+			}
+			return false;
+		}
+
+		void ClearQueue(std::uint64_t SerialNumber) {
+			for (auto Request = Requests_.begin(); Request != Requests_.end();) {
+				if (Request->second.SerialNumber == SerialNumber)
+					Request = Requests_.erase(Request);
+				else
+					++Request;
+			}
+		}
+
+		std::size_t Expire(std::chrono::time_point<std::chrono::high_resolution_clock> Now) {
+			using namespace std::chrono_literals;
+			std::size_t Expired = 0;
+			for (auto Request = Requests_.begin(); Request != Requests_.end();) {
+				std::chrono::duration<double, std::milli> Delta = Now - Request->second.submitted;
+				if (Delta > 10min) {
+					Request = Requests_.erase(Request);
+					Expired++;
+				} else {
+					++Request;
+				}
+			}
+			return Expired;
+		}
+
+	  private:
+		std::map<std::uint64_t, CommandInfo> Requests_;
+	};
+
+	//	One outstanding request per device, as after a bulk upgrade. Lookups on a full scan are much
+	//	slower, so they run fewer times: compare the rates.
+	static void Requests() {
+		using namespace std::chrono_literals;
+		auto Outstanding = Option("requests", (uint64_t)100000);
+		auto Scans = std::max((uint64_t)1, Option("scans", (uint64_t)1000));
+		const std::uint64_t FirstSerial = 0x24f5a2000000, FirstId = 3;
+
+		std::vector<CommandInfo> Infos(Outstanding);
+		for (uint64_t i = 0; i < Outstanding; i++) {
+			Infos[i].Id = FirstId + i;
+			Infos[i].SerialNumber = FirstSerial + i;
+			Infos[i].Command = "upgrade";
+			Infos[i].UUID = MicroService::CreateUUID();
+		}
+		//	Lookups spread over the table, the connect checks on devices with nothing outstanding.
+		auto Pick = [&](uint64_t i) -> const CommandInfo & { return Infos[(i * 7919) % Outstanding]; };
+
+		ScannedRequests Before;
+		CommandManager::RequestTable After;
+		std::string UUID, Command;
+
+		auto B = Measure("add, map", Outstanding, [&](uint64_t i) { Before.Add(Infos[i].Id, Infos[i]); });
+		auto A = Measure("add, indexed table", Outstanding, [&](uint64_t i) { After.Add(Infos[i].Id, Infos[i]); });
+		Speedup("add", B, A);
+
+		B = Measure("running for device, scan", Scans, [&](uint64_t i) {
+			Keep(Before.CommandRunningForDevice(Pick(i).SerialNumber, UUID, Command));
+		});
+		A = Measure("running for device, indexed table", Outstanding,
+					[&](uint64_t i) { Keep(After.FindForDevice(Pick(i).SerialNumber)); });
+		Speedup("running for device", B, A);
+
+		B = Measure("command running, scan", Scans, [&](uint64_t i) { Keep(Before.IsCommandRunning(Pick(i).UUID)); });
+		A = Measure("command running, indexed table", Outstanding, [&](uint64_t i) { Keep(After.HasUUID(Pick(i).UUID)); });
+		Speedup("command running", B, A);
+
+		B = Measure("clear queue on connect, scan", Scans,
+					[&](uint64_t i) { Before.ClearQueue(FirstSerial + Outstanding + i); });
+		A = Measure("clear queue on connect, indexed table", Outstanding,
+					[&](uint64_t i) { Keep(After.RemoveDevice(FirstSerial + Outstanding + i)); });
+		Speedup("clear queue on connect", B, A);
+
+		//	The janitor runs every minute. Most passes find nothing due; one finally expires everything.
+		auto Now = std::chrono::high_resolution_clock::now();
+		B = Measure("janitor pass, nothing due, scan", 100, [&](uint64_t) { Keep(Before.Expire(Now)); });
+		A = Measure("janitor pass, nothing due, wheel", 100, [&](uint64_t) {
+			After.Expire(OpenWifi::Now(), [](const CommandInfo &Info) { Keep(Info); });
+		});
+		Speedup("janitor pass, nothing due", B, A);
+
+		auto Start = std::chrono::steady_clock::now();
+		auto Expired = Before.Expire(Now + 11min);
+		B = Report(fmt::format("janitor pass, {} due, scan", Expired), Expired, Since(Start));
+		Expired = 0;
+		Start = std::chrono::steady_clock::now();
+		After.Expire(OpenWifi::Now() + (CommandManager::RequestTable::ExpiryMinutes + 1) * 60,
+					 [&](const CommandInfo &) { Expired++; });
+		A = Report(fmt::format("janitor pass, {} due, wheel", Expired), Expired, Since(Start));
+		Speedup("janitor pass, all due", B, A);
+	}
+
+	static Register RequestsCase("requests", "outstanding RPC lookups and expiry, full scans vs indexed table",
+								 Requests);
+}
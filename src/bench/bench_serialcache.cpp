@@ -0,0 +1,162 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <algorithm>
+#include <random>
+
+#include "Poco/StringTokenizer.h"
+
+#include "SerialNumberCache.h"
+#include "bench/Bench.h"
+
+namespace OpenWifi::Bench {
+
+	//	The serial number cache as it was: two sorted vectors, membership by linear search.
+	class SortedVectors {
+	  public:
+		static uint64_t Reverse(uint64_t N) {
+			uint64_t Res = 0;
+			for (int i = 0; i < 16; i++) {
+				Res = (Res << 4) + (N & 0x000000000000000f);
+				N >>= 4;
+			}
+			return Res >> 16;
+		}
+
+		//	Builds the state that one AddSerialNumber per device used to end up in, without waiting for it.
+		void Load(const std::vector<uint64_t> &SerialNumbers) {
+			SNs_ = SerialNumbers;
+			std::sort(SNs_.begin(), SNs_.end());
+			SNs_.erase(std::unique(SNs_.begin(), SNs_.end()), SNs_.end());
+			Reverse_SNs_.clear();
+			for (auto SN : SNs_)
+				Reverse_SNs_.push_back(Reverse(SN));
+			std::sort(Reverse_SNs_.begin(), Reverse_SNs_.end());
+		}
+
+		void AddSerialNumber(uint64_t SN) {
+			if (std::find(std::begin(SNs_), std::end(SNs_), SN) == std::end(SNs_)) {
+				SNs_.insert(std::lower_bound(SNs_.begin(), SNs_.end(), SN), SN);
+				auto RSN = Reverse(SN);
+				Reverse_SNs_.insert(std::lower_bound(Reverse_SNs_.begin(), Reverse_SNs_.end(), RSN), RSN);
+			}
+		}
+
+		bool NumberExists(uint64_t SN) const { return std::find(SNs_.begin(), SNs_.end(), SN) != SNs_.end(); }
+
+		void FindNumbers(const std::string &S, uint HowMany, std::vector<uint64_t> &A) const {
+			if (S.empty())
+				return;
+			if (S[0] == '*') {
+				std::string Reversed;
+				std::copy(rbegin(S), rend(S) - 1, std::back_inserter(Reversed));
+				if (Reversed.empty())
+					return;
+				return ReturnNumbers(Reversed, HowMany, Reverse_SNs_, A, true);
+			}
+			return ReturnNumbers(S, HowMany, SNs_, A, false);
+		}
+
+	  private:
+		std::vector<uint64_t> SNs_, Reverse_SNs_;
+
+		static void ReturnNumbers(const std::string &S, uint HowMany, const std::vector<uint64_t> &SNArr,
+								  std::vector<uint64_t> &A, bool ReverseResult) {
+			if (S.length() == 12) {
+				uint64_t SN = std::stoull(S, nullptr, 16);
+				auto It = std::find(SNArr.begin(), SNArr.end(), SN);
+				if (It != SNArr.end())
+					A.push_back(ReverseResult ? Reverse(*It) : *It);
+			} else if (S.length() < 12) {
+				std::string SS{S};
+				SS.insert(SS.end(), 12 - SS.size(), '0');
+				uint64_t SN = std::stoull(SS, nullptr, 16);
+				for (auto LB = std::lower_bound(SNArr.begin(), SNArr.end(), SN); LB != SNArr.end() && HowMany;
+					 ++LB, --HowMany) {
+					auto TSN = ReverseResult ? SerialNumberCache::ReverseSerialNumber(Utils::IntToSerialNumber(Reverse(*LB)))
+											 : Utils::IntToSerialNumber(*LB);
+					if (S != TSN.substr(0, S.size()))
+						break;
+					A.emplace_back(ReverseResult ? Reverse(*LB) : *LB);
+				}
+			}
+		}
+	};
+
+	//	Serial numbers as fleets have them: a few hundred vendor prefixes, random device parts.
+	static std::vector<uint64_t> Fleet(uint64_t Size, std::mt19937_64 &Random) {
+		std::vector<uint64_t> Prefixes(256);
+		for (auto &P : Prefixes)
+			P = (Random() & 0xffffff) << 24;
+		std::vector<uint64_t> SerialNumbers(Size);
+		for (auto &SN : SerialNumbers)
+			SN = Prefixes[Random() % Prefixes.size()] | (Random() & 0xffffff);
+		return SerialNumbers;
+	}
+
+	static void SerialCache() {
+		//	The old code is O(n) per operation: it only runs a few times at each size.
+		auto Samples = std::max((uint64_t)1, Option("samples", (uint64_t)100));
+		Poco::StringTokenizer Sizes(Option("sizes", "1000000,10000000"), ",",
+									Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY);
+
+		for (const auto &SizeOption : Sizes) {
+			auto Size = std::stoull(SizeOption);
+			std::mt19937_64 Random(Size);
+			auto SerialNumbers = Fleet(Size, Random);
+			auto Others = Fleet(Samples, Random);
+			auto Pick = [&](uint64_t i) { return SerialNumbers[(i * 7919) % SerialNumbers.size()]; };
+			auto Prefix = [&](uint64_t i) { return Utils::IntToSerialNumber(Pick(i)).substr(0, 8); };
+			auto Suffix = [&](uint64_t i) { return "*" + Utils::IntToSerialNumber(Pick(i)).substr(7); };
+			auto Infix = [&](uint64_t i) { return "*" + Utils::IntToSerialNumber(Pick(i)).substr(4, 5) + "*"; };
+			std::cout << fmt::format(" {} serial numbers", Size) << std::endl;
+
+			SerialNumberIndex After;
+			auto Start = std::chrono::steady_clock::now();
+			After.Add(SerialNumbers);
+			Report("bulk load, index", Size, Since(Start));
+
+			SortedVectors Before;
+			Before.Load(SerialNumbers);
+			auto B = Measure("add one, sorted vectors", Samples, [&](uint64_t i) { Before.AddSerialNumber(Others[i]); });
+			auto A = Measure("add one, index", Samples, [&](uint64_t i) { After.Add(Others[i]); });
+			Speedup("add one", B, A);
+
+			B = Measure("exists, sorted vectors", Samples, [&](uint64_t i) { Keep(Before.NumberExists(Pick(i))); });
+			A = Measure("exists, index", Size, [&](uint64_t i) { Keep(After.Exists(Pick(i))); });
+			Speedup("exists", B, A);
+
+			std::vector<uint64_t> Found;
+			B = Measure("prefix, sorted vectors", Samples * 100, [&](uint64_t i) {
+				Found.clear();
+				Before.FindNumbers(Prefix(i), 50, Found);
+			});
+			A = Measure("prefix, index", Samples * 100, [&](uint64_t i) {
+				Found.clear();
+				After.Find(Prefix(i), 50, Found);
+			});
+			Speedup("prefix", B, A);
+
+			B = Measure("suffix, sorted vectors", Samples * 100, [&](uint64_t i) {
+				Found.clear();
+				Before.FindNumbers(Suffix(i), 50, Found);
+			});
+			A = Measure("suffix, index", Samples * 100, [&](uint64_t i) {
+				Found.clear();
+				After.Find(Suffix(i), 50, Found);
+			});
+			Speedup("suffix", B, A);
+
+			//	The old cache had no infix search.
+			Measure("infix, index", Samples, [&](uint64_t i) {
+				Found.clear();
+				After.Find(Infix(i), 50, Found);
+			});
+		}
+	}
+
+	static Register SerialCacheCase("serialcache", "serial number cache at 1M and 10M devices, sorted vectors vs index",
+									SerialCache);
+}
@@ -0,0 +1,106 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "Poco/Data/SQLite/Connector.h"
+#include "Poco/File.h"
+#include "Poco/Path.h"
+#include "Poco/Tuple.h"
+
+#include "StorageStatementCache.h"
+#include "bench/Bench.h"
+
+namespace OpenWifi::Bench {
+
+	using DeviceTuple = Poco::Tuple<std::string, std::string, std::string, std::string, uint64_t, uint64_t>;
+
+	struct SelectDevice : CachedStatement {
+		std::string 	SerialNumber;
+		DeviceTuple 	Record;
+	};
+
+	struct UpdateFirmware : CachedStatement {
+		std::string 	SerialNumber;
+		std::string 	Firmware;
+		uint64_t 		LastModified = 0;
+	};
+
+	static std::string Serial(uint64_t i) { return fmt::format("{:012x}", 0x24f5a2000000 + i); }
+
+	//	With the cache disabled every query gets a session from the pool and a new statement, as the
+	//	storage code did before; enabled, it runs the statement prepared on its leased session.
+	static void Run(Poco::Data::SessionPool &Pool, bool Enabled, uint64_t Devices, uint64_t Iterations,
+					double &Selects, double &Updates) {
+		StorageStatementCache Cache;
+		Cache.Start(Pool, Enabled, 8, 64);
+		auto Label = Enabled ? "prepared once" : "prepared each time";
+
+		Selects = Measure(fmt::format("select by serial, {}", Label), Iterations, [&](uint64_t i) {
+			auto Lease = Cache.Acquire();
+			auto &Q = Lease->Get<SelectDevice>("SelectDevice", [](Poco::Data::Statement &Select, SelectDevice &Query) {
+				Select << "SELECT SerialNumber, DeviceType, Firmware, Compatible, UUID, LastModified FROM Devices "
+						  "WHERE SerialNumber=?",
+					Poco::Data::Keywords::into(Query.Record), Poco::Data::Keywords::use(Query.SerialNumber);
+			});
+			Q.SerialNumber = Serial((i * 7919) % Devices);
+			Lease->Execute(Q);
+			Keep(Q.Record);
+		});
+
+		Updates = Measure(fmt::format("update by serial, {}", Label), Iterations, [&](uint64_t i) {
+			auto Lease = Cache.Acquire();
+			auto &Q = Lease->Get<UpdateFirmware>("UpdateFirmware", [](Poco::Data::Statement &Update, UpdateFirmware &Query) {
+				Update << "UPDATE Devices SET Firmware=?, LastModified=? WHERE SerialNumber=?",
+					Poco::Data::Keywords::use(Query.Firmware), Poco::Data::Keywords::use(Query.LastModified),
+					Poco::Data::Keywords::use(Query.SerialNumber);
+			});
+			Q.SerialNumber = Serial((i * 7919) % Devices);
+			Q.Firmware = fmt::format("OpenWrt 21.02-SNAPSHOT r{}", i);
+			Q.LastModified = i;
+			Lease->Execute(Q);
+		});
+
+		auto S = Cache.Stats();
+		std::cout << fmt::format("  hits {} misses {} uncached {} sessions {}", S.Hits, S.Misses, S.Uncached,
+								 S.Sessions)
+				  << std::endl;
+		Cache.Stop();
+	}
+
+	static void Statements() {
+		auto Devices = std::max((uint64_t)1, Option("devices", (uint64_t)10000));
+		auto Iterations = Option("iterations", (uint64_t)50000);
+		auto FileName = Option("db", Poco::Path::temp() + "owgw-bench.db");
+
+		if (Poco::File(FileName).exists())
+			Poco::File(FileName).remove();
+		Poco::Data::SQLite::Connector::registerConnector();
+		{
+			Poco::Data::SessionPool Pool(Poco::Data::SQLite::Connector::KEY, FileName, 1, 8, 60);
+			{
+				Poco::Data::Session Session = Pool.get();
+				Session << "CREATE TABLE Devices (SerialNumber VARCHAR(30) PRIMARY KEY, DeviceType VARCHAR(32), "
+						   "Firmware TEXT, Compatible TEXT, UUID BIGINT, LastModified BIGINT)",
+					Poco::Data::Keywords::now;
+				Session.begin();
+				for (uint64_t i = 0; i < Devices; i++) {
+					DeviceTuple R{Serial(i), "AP", "OpenWrt 21.02-SNAPSHOT", "edgecore_eap101", 1666051200 + i, 0};
+					Session << "INSERT INTO Devices VALUES(?,?,?,?,?,?)", Poco::Data::Keywords::use(R),
+						Poco::Data::Keywords::now;
+				}
+				Session.commit();
+			}
+
+			double SelectsBefore, UpdatesBefore, SelectsAfter, UpdatesAfter;
+			Run(Pool, false, Devices, Iterations, SelectsBefore, UpdatesBefore);
+			Run(Pool, true, Devices, Iterations, SelectsAfter, UpdatesAfter);
+			Speedup("select by serial", SelectsBefore, SelectsAfter);
+			Speedup("update by serial", UpdatesBefore, UpdatesAfter);
+		}
+		Poco::File(FileName).remove();
+	}
+
+	static Register StatementsCase("statements", "query latency on SQLite, statements prepared each time vs cached",
+								   Statements);
+}
@@ -0,0 +1,131 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <atomic>
+#include <thread>
+
+#include "Poco/Net/Context.h"
+#include "Poco/Net/NetSSL.h"
+#include "Poco/Net/SecureServerSocket.h"
+#include "Poco/Net/SecureStreamSocket.h"
+#include "Poco/Net/StreamSocket.h"
+
+#include <openssl/ssl.h>
+
+#include "AP_WS_TLSSessions.h"
+#include "bench/Bench.h"
+
+namespace OpenWifi::Bench {
+
+	//	Accepts Count connections, completes each handshake, sends one byte and closes. The byte lets the
+	//	client read the TLS 1.3 session tickets that follow the handshake.
+	static void Serve(Poco::Net::SecureServerSocket &Server, uint64_t Count, std::atomic_uint64_t &Errors) {
+		for (uint64_t i = 0; i < Count; i++) {
+			try {
+				Poco::Net::SecureStreamSocket Socket(Server.acceptConnection());
+				Socket.completeHandshake();
+				Socket.sendBytes("x", 1);
+				Socket.close();
+			} catch (const Poco::Exception &) {
+				Errors++;
+			}
+		}
+	}
+
+	//	A device reconnecting: TCP connect, TLS handshake offering Session when there is one, read the
+	//	byte. Returns the session to offer next time, or nullptr.
+	static SSL_SESSION *Reconnect(SSL_CTX *Client, const Poco::Net::SocketAddress &Address, SSL_SESSION *Session,
+								  uint64_t &Resumed, uint64_t &Errors) {
+		Poco::Net::StreamSocket Socket(Address);
+		auto S = SSL_new(Client);
+		SSL_set_fd(S, (int)Socket.impl()->sockfd());
+		if (Session != nullptr)
+			SSL_set_session(S, Session);
+		SSL_SESSION *Next = nullptr;
+		char Byte;
+		if (SSL_connect(S) == 1 && SSL_read(S, &Byte, 1) == 1) {
+			if (SSL_session_reused(S))
+				Resumed++;
+			Next = SSL_get1_session(S);
+			SSL_shutdown(S);
+		} else {
+			Errors++;
+		}
+		SSL_free(S);
+		return Next;
+	}
+
+	static void TLS() {
+		auto Cert = Option("cert"), Key = Option("key"), CA = Option("cacert");
+		auto ClientCert = Option("client-cert"), ClientKey = Option("client-key");
+		auto Handshakes = std::max((uint64_t)1, Option("handshakes", (uint64_t)2000));
+		if (Cert.empty() || Key.empty()) {
+			std::cout << "  Needs --cert and --key for the server, see test_scripts/sim/create_sim_certificates.sh."
+					  << std::endl;
+			return;
+		}
+
+		Poco::Net::initializeSSL();
+		{
+			//	As the device listener is set up: client certificates are verified when there are some.
+			Poco::Net::Context::Params P;
+			P.privateKeyFile = Key;
+			P.certificateFile = Cert;
+			P.caLocation = CA;
+			P.verificationMode = ClientCert.empty() || CA.empty() ? Poco::Net::Context::VERIFY_NONE
+																  : Poco::Net::Context::VERIFY_ONCE;
+			P.verificationDepth = 9;
+			P.cipherList = "ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH";
+			P.dhUse2048Bits = true;
+			auto Context = Poco::AutoPtr<Poco::Net::Context>(new Poco::Net::Context(Poco::Net::Context::TLS_SERVER_USE, P));
+			Context->enableExtendedCertificateVerification(false);
+			Context->disableProtocols(Poco::Net::Context::PROTO_TLSV1 | Poco::Net::Context::PROTO_TLSV1_1);
+
+			AP_WS_TLSSessions Sessions;
+			Sessions.Configure(true, 3600, 3600, 20480);
+			Sessions.Attach(*Context, "owgw-bench");
+
+			auto Client = SSL_CTX_new(TLS_client_method());
+			SSL_CTX_set_verify(Client, SSL_VERIFY_NONE, nullptr);
+			if (!ClientCert.empty() && !ClientKey.empty()) {
+				SSL_CTX_use_certificate_chain_file(Client, ClientCert.c_str());
+				SSL_CTX_use_PrivateKey_file(Client, ClientKey.c_str(), SSL_FILETYPE_PEM);
+			}
+
+			Poco::Net::SecureServerSocket Server(Poco::Net::SocketAddress("127.0.0.1", 0), 64, Context);
+			Poco::Net::SocketAddress Address("127.0.0.1", Server.address().port());
+
+			double Rates[2];
+			for (auto Resume : {false, true}) {
+				std::atomic_uint64_t ServerErrors = 0;
+				std::thread Acceptor(Serve, std::ref(Server), Handshakes, std::ref(ServerErrors));
+				uint64_t Resumed = 0, Errors = 0;
+				SSL_SESSION *Session = nullptr;
+				Rates[Resume] = Measure(Resume ? "handshakes, resuming" : "handshakes, full", Handshakes, [&](uint64_t) {
+					auto Next = Reconnect(Client, Address, Resume ? Session : nullptr, Resumed, Errors);
+					if (Session != nullptr)
+						SSL_SESSION_free(Session);
+					Session = Next;
+				});
+				Acceptor.join();
+				if (Session != nullptr)
+					SSL_SESSION_free(Session);
+				std::cout << fmt::format("  resumed {} errors {} server errors {}", Resumed, Errors, ServerErrors.load())
+						  << std::endl;
+			}
+			Speedup("handshakes/s, resumed vs full", Rates[0], Rates[1]);
+
+			auto S = Sessions.Stats();
+			std::cout << fmt::format("  server: handshakes {} resumed {} misses {} tickets issued {} renewed {} unknown {}",
+									 S.Handshakes, S.Resumed, S.CacheMisses, S.TicketsIssued, S.TicketsRenewed,
+									 S.TicketsUnknown)
+					  << std::endl;
+			SSL_CTX_free(Client);
+		}
+		Poco::Net::uninitializeSSL();
+	}
+
+	static Register TLSCase("tls", "TLS handshakes/s on the loopback, full vs resumed", TLS);
+}
@@ -0,0 +1,78 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include <fstream>
+#include <sstream>
+
+#include "bench/Bench.h"
+#include "bench/BenchService.h"
+#include "framework/ConfigurationValidator.h"
+
+namespace OpenWifi::Bench {
+
+	//	test_scripts/curl/dual-ssid-rate-limit_bridge.json, unless --config names another one.
+	static const char *DefaultConfiguration =
+		R"lit({"uuid":2,"radios":[{"band":"5G","channel":149,"channel-mode":"HE","channel-width":80,"country":"CA"},)lit"
+		R"lit({"band":"2G","channel":11,"channel-mode":"HE","channel-width":20,"country":"CA"}],"interfaces":[{"name":"WAN",)lit"
+		R"lit("role":"upstream","services":["lldp"],"ethernet":[{"select-ports":["WAN*"]}],"ipv4":{"addressing":"dynamic"},)lit"
+		R"lit("ssids":[{"name":"OpenWifi_2GHz","wifi-bands":["2G"],"bss-mode":"ap","encryption":{"proto":"psk2","key":"OpenWifi",)lit"
+		R"lit("ieee80211w":"optional"},"rate-limit":{"ingress-rate":50,"egress-rate":50}},{"name":"OpenWifi_5GHz","wifi-bands":["5G"],)lit"
+		R"lit("bss-mode":"ap","encryption":{"proto":"psk2","key":"OpenWifi","ieee80211w":"optional"},"rate-limit":{"ingress-rate":50,)lit"
+		R"lit("egress-rate":50}}]},{"name":"LAN","role":"downstream","services":["ssh","lldp"],"ethernet":[{"select-ports":["LAN*"]}],)lit"
+		R"lit("ipv4":{"addressing":"static","subnet":"192.168.1.1/24","dhcp":{"lease-first":10,"lease-count":100,"lease-time":"6h"}}}],)lit"
+		R"lit("metrics":{"statistics":{"interval":120,"types":["ssids","lldp","clients"]},"health":{"interval":120},)lit"
+		R"lit("wifi-frames":{"filters":["probe","auth"]}},"services":{"lldp":{"describe":"uCentral","location":"universe"},)lit"
+		R"lit("ssh":{"port":22}}})lit";
+
+	//	What Validate did before: a new validator compiled from the whole schema for every configuration.
+	static bool ValidateUncompiled(const std::string &C) {
+		try {
+			json_validator Validator(nullptr, ConfigurationValidator::my_format_checker);
+			Validator.set_root_schema(ConfigurationValidator::BuiltInSchema());
+			Validator.validate(json::parse(C));
+			return true;
+		} catch (const std::exception &) {
+			return false;
+		}
+	}
+
+	static void Validator() {
+		auto Iterations = Option("iterations", (uint64_t)20000);
+		std::string Configuration{DefaultConfiguration};
+		auto FileName = Option("config");
+		if (!FileName.empty()) {
+			std::ifstream Input(FileName);
+			std::stringstream Content;
+			Content << Input.rdbuf();
+			Configuration = Content.str();
+		}
+
+		//	Every configuration pushed gets a new uuid, which makes each one a miss in the result cache.
+		auto Doc = json::parse(Configuration);
+		std::vector<std::string> Distinct;
+		for (uint64_t i = 0; i < Iterations; i++) {
+			Doc["uuid"] = 1666051200 + i;
+			Distinct.emplace_back(Doc.dump());
+		}
+
+		Set("ucentral.datamodel.internal", "true");
+		Initialize(*ConfigurationValidator());
+		ConfigurationValidator()->Start();
+
+		std::string Error;
+		auto Before = Measure("compiled for each configuration", std::max((uint64_t)1, Iterations / 100),
+							  [&](uint64_t i) { Keep(ValidateUncompiled(Distinct[i])); });
+		auto Compiled = Measure("compiled once, distinct configurations", Iterations,
+								[&](uint64_t i) { Keep(ConfigurationValidator()->Validate(Distinct[i], Error)); });
+		auto Cached = Measure("compiled once, same configuration", Iterations,
+							  [&](uint64_t) { Keep(ConfigurationValidator()->Validate(Distinct.front(), Error)); });
+		Speedup("validations/s, compiled once vs each time", Before, Compiled);
+		Speedup("validations/s, cached vs each time", Before, Cached);
+
+		ConfigurationValidator()->Stop();
+	}
+
+	static Register ValidatorCase("validator", "configuration validations/s against the uCentral schema", Validator);
+}
@@ -0,0 +1,48 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+//	owgw-bench: micro-benchmarks of the gateway's hot paths, each one next to the implementation it
+//	replaced where that still makes sense. Everything runs in process, no service is needed.
+
+#include <algorithm>
+
+#include "bench/Bench.h"
+
+int main(int argc, char **argv) {
+	using namespace OpenWifi::Bench;
+
+	std::vector<std::string> Selected;
+	for (int i = 1; i < argc; i++) {
+		std::string Arg{argv[i]};
+		if (Arg == "--list" || Arg == "--help" || Arg == "-h") {
+			std::cout << "owgw-bench [--name=value ...] [benchmark ...]" << std::endl;
+			for (const auto &C : Cases())
+				std::cout << fmt::format("  {:<16} {}", C.Name, C.Description) << std::endl;
+			return 0;
+		}
+		if (Arg.compare(0, 2, "--") == 0) {
+			auto Equal = Arg.find('=');
+			Options()[Arg.substr(2, Equal == std::string::npos ? std::string::npos : Equal - 2)] =
+				Equal == std::string::npos ? "" : Arg.substr(Equal + 1);
+			continue;
+		}
+		Selected.push_back(Arg);
+	}
+
+	int Ran = 0;
+	for (const auto &C : Cases()) {
+		if (!Selected.empty() && std::find(Selected.begin(), Selected.end(), C.Name) == Selected.end())
+			continue;
+		std::cout << C.Name << ": " << C.Description << std::endl;
+		C.Run();
+		std::cout << std::endl;
+		Ran++;
+	}
+	if (Ran == 0) {
+		std::cerr << "No benchmark selected. Use --list to see them." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -2612,30 +2612,36 @@ static json DefaultUCentralSchema = R"(
 
     class custom_error_handler : public nlohmann::json_schema::basic_error_handler
     {
+      public:
         void error(const nlohmann::json_pointer<nlohmann::basic_json<>> &pointer, const json &instance,
                    const std::string &message) override
         {
             nlohmann::json_schema::basic_error_handler::error(pointer, instance, message);
-            std::cout << "ERROR: '" << pointer << "' - '" << instance << "': " << message << "\n";
+            if(!Errors_.empty())
+                Errors_ += "; ";
+            Errors_ += fmt::format("'{}' - '{}': {}", pointer.to_string(), instance.dump(), message);
         }
+        [[nodiscard]] inline const std::string & Errors() const { return Errors_; }
+      private:
+        std::string     Errors_;
     };
 
-    void ConfigurationValidator::Init() {
-        if(Initialized_)
-            return;
+    const nlohmann::json & ConfigurationValidator::BuiltInSchema() {
+        return DefaultUCentralSchema;
+    }
 
-        std::string GitSchema;
+    bool ConfigurationValidator::LoadSchema(nlohmann::json &Schema) {
 		if(MicroService::instance().ConfigGetBool("ucentral.datamodel.internal",true)) {
-			RootSchema_ = DefaultUCentralSchema;
+			Schema = DefaultUCentralSchema;
 			Logger().information("Using uCentral validation from built-in default.");
-			Initialized_ = Working_ = true;
-			return;
+			return true;
 		}
 
+        std::string GitSchema;
         try {
 			auto GitURI = MicroService::instance().ConfigGetString("ucentral.datamodel.uri",GitUCentralJSONSchemaFile);
             if(Utils::wgets(GitURI, GitSchema)) {
-                RootSchema_ = json::parse(GitSchema);
+                Schema = json::parse(GitSchema);
                 Logger().information("Using uCentral validation schema from GIT.");
             } else {
                 std::string FileName{ MicroService::instance().DataDir() + "/ucentral.schema.json" };
@@ -2643,23 +2649,78 @@ static json DefaultUCentralSchema = R"(
                 std::stringstream   schema_file;
                 schema_file << input.rdbuf();
                 input.close();
-                RootSchema_ = json::parse(schema_file.str());
+                Schema = json::parse(schema_file.str());
                 Logger().information("Using uCentral validation schema from local file.");
             }
+            return true;
         } catch (const Poco::Exception &E) {
-            RootSchema_ = DefaultUCentralSchema;
-            Logger().information("Using uCentral validation from built-in default.");
+            Logger().log(E);
+        } catch (const std::exception &E) {
+            Logger().warning(fmt::format("Invalid uCentral validation schema: {}", E.what()));
+        }
+        Schema = DefaultUCentralSchema;
+        Logger().information("Using uCentral validation from built-in default.");
+        return false;
+    }
+
+    bool ConfigurationValidator::SetSchema(const nlohmann::json &Schema) {
+        auto Hash = Utils::ComputeHash(Schema.dump());
+        {
+            std::shared_lock    Lock(Mutex_);
+            if(Validator_ && Hash==SchemaHash_)
+                return false;
+        }
+
+        try {
+            auto Validator = std::make_shared<json_validator>(nullptr, my_format_checker);
+            Validator->set_root_schema(Schema);
+            {
+                std::unique_lock    Lock(Mutex_);
+                Validator_ = std::move(Validator);
+                SchemaHash_ = Hash;
+            }
+            Results_.clear();
+            Logger().information(fmt::format("Validation schema compiled: {}", Hash.substr(0,16)));
+            return true;
+        } catch (const std::exception &E) {
+            Logger().warning(fmt::format("Validation schema could not be compiled, keeping the current one: {}", E.what()));
         }
-        Initialized_ = Working_ = true;
+        return false;
+    }
+
+    //  SetSchema keeps the compiled validator when the schema has not changed, so this is cheap to repeat.
+    void ConfigurationValidator::Init() {
+        nlohmann::json  Schema;
+        LoadSchema(Schema);
+        SetSchema(Schema);
     }
 
     int ConfigurationValidator::Start() {
         Init();
+
+        //  Only an external schema can change while we run.
+        auto Reload = MicroService::instance().ConfigGetInt("ucentral.datamodel.reload",0);
+        if(Reload && !MicroService::instance().ConfigGetBool("ucentral.datamodel.internal",true)) {
+            ReloadCallback_ = std::make_unique<Poco::TimerCallback<ConfigurationValidator>>(*this, &ConfigurationValidator::onTimer);
+            Timer_.setStartInterval(Reload * 1000);
+            Timer_.setPeriodicInterval(Reload * 1000);
+            Timer_.start(*ReloadCallback_, MicroService::instance().TimerPool());
+        }
         return 0;
     }
 
     void ConfigurationValidator::Stop() {
+        if(ReloadCallback_) {
+            Timer_.stop();
+            ReloadCallback_.reset();
+        }
+    }
 
+    void ConfigurationValidator::onTimer([[maybe_unused]] Poco::Timer &timer) {
+        Utils::SetThreadName("cfg-reload");
+        nlohmann::json  Schema;
+        if(LoadSchema(Schema))
+            SetSchema(Schema);
     }
 
     static inline bool IsIPv4(const std::string &value) {
@@ -2779,36 +2840,54 @@ static json DefaultUCentralSchema = R"(
     }
 
     bool ConfigurationValidator::Validate(const std::string &C, std::string &Error) {
-        if(Working_) {
-            try {
-                auto Doc = json::parse(C);
-                custom_error_handler CE;
-                json_validator  Validator(nullptr, my_format_checker);
-                Validator.set_root_schema(RootSchema_);
-                Validator.validate(Doc,CE);
-                return true;
-            } catch (const std::invalid_argument &E) {
-                std::cout << "1 Validation failed, here is why: " << E.what() << "\n";
-                Error = E.what();
-                return false;
-            } catch (const std::logic_error &E) {
-                std::cout << "2 Validation failed, here is why: " << E.what() << "\n";
-                Error = E.what();
-                return false;
-            } catch(const std::exception &E) {
-                Error = E.what();
-                std::cout << "3 Validation failed, here is why: " << E.what() << "\n";
-                return false;
-            } catch(...) {
-                std::cout << "4 Some kind of bullshit exception..." << std::endl;
-            }
+        std::shared_ptr<const json_validator>   Validator;
+        std::string                             SchemaHash;
+        {
+            std::shared_lock    Lock(Mutex_);
+            Validator = Validator_;
+            SchemaHash = SchemaHash_;
         }
-        return true;
+        if(!Validator)
+            return true;
+
+        //  The same configuration is often pushed to many devices, so remember the verdict.
+        auto Key = Utils::ComputeHash(SchemaHash, C);
+        auto Cached = Results_.get(Key);
+        if(!Cached.isNull()) {
+            if(!Cached->Valid)
+                Error = Cached->Error;
+            return Cached->Valid;
+        }
+
+        ValidationResult    Result;
+        try {
+            auto Doc = json::parse(C);
+            custom_error_handler CE;
+            Validator->validate(Doc,CE);
+            if(CE)
+                poco_warning(Logger(),fmt::format("Configuration does not match the schema: {}", CE.Errors()));
+        } catch (const std::invalid_argument &E) {
+            poco_warning(Logger(),fmt::format("Validation failed, invalid argument: {}", E.what()));
+            Result = ValidationResult{ .Valid = false, .Error = E.what() };
+        } catch (const std::logic_error &E) {
+            poco_warning(Logger(),fmt::format("Validation failed, logic error: {}", E.what()));
+            Result = ValidationResult{ .Valid = false, .Error = E.what() };
+        } catch(const std::exception &E) {
+            poco_warning(Logger(),fmt::format("Validation failed: {}", E.what()));
+            Result = ValidationResult{ .Valid = false, .Error = E.what() };
+        } catch(...) {
+            poco_warning(Logger(),"Validation failed with an unknown exception, configuration accepted.");
+            return true;
+        }
+
+        Results_.add(Key, Result);
+        if(!Result.Valid)
+            Error = Result.Error;
+        return Result.Valid;
     }
 
     void ConfigurationValidator::reinitialize([[maybe_unused]] Poco::Util::Application &self) {
         Logger().information("Reinitializing.");
-        Working_ = Initialized_ = false;
         Init();
     }
 
@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include <shared_mutex>
+
 #include <nlohmann/json-schema.hpp>
 #include "framework/MicroService.h"
+#include "Poco/LRUCache.h"
 
 using nlohmann::json;
 using nlohmann::json_schema::json_validator;
@@ -21,15 +24,30 @@ namespace OpenWifi {
 
         bool Validate(const std::string &C, std::string &Error);
         static void my_format_checker(const std::string &format, const std::string &value);
+        static const nlohmann::json & BuiltInSchema();
         int Start() override;
         void Stop() override;
         void reinitialize(Poco::Util::Application &self) override;
+        void onTimer(Poco::Timer & timer);
 
     private:
-        bool            Initialized_=false;
-        bool            Working_=false;
+        struct ValidationResult {
+            bool            Valid=true;
+            std::string     Error;
+        };
+
+        //  The schema is compiled once into a validator that is shared by all REST threads. A reload
+        //  swaps the pointer, so validations in progress finish with the schema they started with.
+        std::shared_mutex                       Mutex_;
+        std::shared_ptr<const json_validator>   Validator_;
+        std::string                             SchemaHash_;
+        Poco::LRUCache<std::string,ValidationResult>    Results_{2048};
+        Poco::Timer                             Timer_;
+        std::unique_ptr<Poco::TimerCallback<ConfigurationValidator>>   ReloadCallback_;
+
         void            Init();
-        nlohmann::json  RootSchema_;
+        bool            LoadSchema(nlohmann::json &Schema);
+        bool            SetSchema(const nlohmann::json &Schema);
 
         ConfigurationValidator():
             SubSystemServer("configvalidator", "CFG-VALIDATOR", "config.validator") {
@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include <vector>
 #include <set>
+#include <functional>
 #include <thread>
 #include <chrono>
 #include <fstream>
@@ -22,6 +23,8 @@
 #include <iomanip>
 #include <queue>
 #include <variant>
+#include <deque>
+#include <condition_variable>
 
 
 // This must be defined for poco_debug and poco_trace macros to function.
@@ -53,6 +56,7 @@ using namespace std::chrono_literals;
 #include "Poco/SHA2Engine.h"
 #include "Poco/Net/HTTPServerRequest.h"
 #include "Poco/Process.h"
+#include "Poco/RunnableAdapter.h"
 #include "Poco/Net/Context.h"
 #include "Poco/Net/SecureServerSocket.h"
 #include "Poco/Net/Socket.h"
@@ -1196,37 +1200,103 @@ namespace OpenWifi::Utils {
         return stream.str();
     }
 
+    //  Largest payload we accept from a device once inflated.
+    static const uint64_t MaxUncompressedDataSize = 64*1024*1024;
+
+    //  Base64 decoding and inflate are done in a single pass, one small chunk at a time, straight into
+    //  the output string. The z_stream and the chunk buffer are reused by each thread.
     inline bool ExtractBase64CompressedData(const std::string &CompressedData,
-                                            std::string &UnCompressedData, uint64_t compress_sz ) {
-        std::istringstream ifs(CompressedData);
-        Poco::Base64Decoder b64in(ifs);
-        std::ostringstream ofs;
-        Poco::StreamCopier::copyStream(b64in, ofs);
-
-        int factor = 20;
-        unsigned long MaxSize = compress_sz ? (unsigned long) (compress_sz + 5000) : (unsigned long) (ofs.str().size() * factor);
+                                            std::string &UnCompressedData, uint64_t compress_sz,
+                                            uint64_t MaxSize = MaxUncompressedDataSize) {
+        static const auto Base64Table = []() {
+            std::array<uint8_t,256> T{};
+            T.fill(0xff);
+            const char *Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for(uint8_t i=0;i<64;i++)
+                T[(uint8_t)Alphabet[i]] = i;
+            return T;
+        }();
+
+        struct Inflater {
+            z_stream    Stream{};
+            bool        Ready = false;
+            Inflater() { Ready = inflateInit(&Stream)==Z_OK; }
+            ~Inflater() { if(Ready) inflateEnd(&Stream); }
+        };
+        thread_local Inflater                   Z;
+        thread_local std::array<uint8_t,16384>  Chunk;
+
+        if(!Z.Ready || inflateReset(&Z.Stream)!=Z_OK)
+            return false;
+
+        uint64_t Produced = 0;
+        UnCompressedData.clear();
+        UnCompressedData.resize(std::min(MaxSize, compress_sz ? compress_sz + 1 : (uint64_t) CompressedData.size() * 4 + 1024));
+
+        const auto *In = (const uint8_t *) CompressedData.data();
+        std::size_t Pos = 0, InSize = CompressedData.size();
+        uint32_t Quad = 0;
+        int QuadLen = 0;
+
         while(true) {
-            std::vector<uint8_t> UncompressedBuffer(MaxSize);
-            unsigned long FinalSize = MaxSize;
-            auto status = uncompress((uint8_t *)&UncompressedBuffer[0], &FinalSize,
-                                     (uint8_t *)ofs.str().c_str(), ofs.str().size());
-            if(status==Z_OK) {
-                UncompressedBuffer[FinalSize] = 0;
-                UnCompressedData = (char *)&UncompressedBuffer[0];
-                return true;
+            std::size_t Decoded = 0;
+            bool Padded = false;
+            while(Pos<InSize && Decoded + 3 <= Chunk.size()) {
+                auto c = In[Pos++];
+                auto v = Base64Table[c];
+                if(v<64) {
+                    Quad = (Quad << 6) | v;
+                    if(++QuadLen==4) {
+                        Chunk[Decoded++] = (uint8_t) (Quad >> 16);
+                        Chunk[Decoded++] = (uint8_t) (Quad >> 8);
+                        Chunk[Decoded++] = (uint8_t) Quad;
+                        Quad = 0;
+                        QuadLen = 0;
+                    }
+                } else if(c=='=') {
+                    Padded = true;
+                    break;
+                } else if(c!='\r' && c!='\n' && c!=' ' && c!='\t') {
+                    return false;
+                }
             }
-            if(status==Z_BUF_ERROR) {
-                if(factor<300) {
-                    factor+=10;
-                    MaxSize = ofs.str().size() * factor;
-                    continue;
-                } else {
+
+            if(Padded || Pos>=InSize) {
+                if(QuadLen==1)
                     return false;
+                if(QuadLen==2) {
+                    Chunk[Decoded++] = (uint8_t) (Quad >> 4);
+                } else if(QuadLen==3) {
+                    Chunk[Decoded++] = (uint8_t) (Quad >> 10);
+                    Chunk[Decoded++] = (uint8_t) (Quad >> 2);
                 }
+                QuadLen = 0;
+                Pos = InSize;
             }
-            return false;
+
+            Z.Stream.next_in = Chunk.data();
+            Z.Stream.avail_in = (uInt) Decoded;
+            do {
+                if(Produced==UnCompressedData.size()) {
+                    if(Produced>=MaxSize)
+                        return false;
+                    UnCompressedData.resize(std::min(MaxSize, std::max(Produced * 2, (uint64_t) 4096)));
+                }
+                Z.Stream.next_out = (Bytef *) &UnCompressedData[Produced];
+                Z.Stream.avail_out = (uInt) (UnCompressedData.size() - Produced);
+                auto Status = inflate(&Z.Stream, Z_NO_FLUSH);
+                Produced = UnCompressedData.size() - Z.Stream.avail_out;
+                if(Status==Z_STREAM_END) {
+                    UnCompressedData.resize(Produced);
+                    return true;
+                }
+                if(Status!=Z_OK && !(Status==Z_BUF_ERROR && Z.Stream.avail_in==0))
+                    return false;
+            } while(Z.Stream.avail_in>0 || Z.Stream.avail_out==0);
+
+            if(Pos>=InSize)
+                return false;
         }
-        return false;
     }
 
 }
@@ -1863,7 +1933,7 @@ namespace OpenWifi {
 	public:
 	    struct QueryBlock {
 	        uint64_t StartDate = 0 , EndDate = 0 , Offset = 0 , Limit = 0, LogType = 0 ;
-	        std::string SerialNumber, Filter;
+	        std::string SerialNumber, Filter, Cursor;
             std::vector<std::string>    Select;
 	        bool Lifetime=false, LastOnly=false, Newest=false, CountOnly=false, AdditionalInfo=false;
 	    };
@@ -2401,6 +2471,7 @@ namespace OpenWifi {
 	            QB_.Offset = GetParameter(RESTAPI::Protocol::OFFSET, 0);
 	            QB_.Limit = GetParameter(RESTAPI::Protocol::LIMIT, 100);
 	            QB_.Filter = GetParameter(RESTAPI::Protocol::FILTER, "");
+	            QB_.Cursor = GetParameter(RESTAPI::Protocol::CURSOR, "");
 	            QB_.Lifetime = GetBoolParameter(RESTAPI::Protocol::LIFETIME,false);
 	            QB_.LogType = GetParameter(RESTAPI::Protocol::LOGTYPE,0);
 	            QB_.LastOnly = GetBoolParameter(RESTAPI::Protocol::LASTONLY,false);
@@ -2632,33 +2703,66 @@ namespace OpenWifi {
 
     class KafkaProducer : public Poco::Runnable {
     public:
+		struct ProducerStats {
+			uint64_t	Queued=0, Dropped=0, Delivered=0, Failed=0, MaxQueueSize=0;
+		};
 
 		inline void run () override;
-		inline void Start() {
-			if(!Running_) {
-				Running_=true;
-				Worker_.start(*this);
-			}
-		}
+		inline void Start(uint64_t Index);
+		inline void Stop();
 
-		inline void Stop() {
-			if(Running_) {
-				Running_=false;
-				Queue_.wakeUpAll();
-				Worker_.join();
+		//	Messages are moved into a bounded queue. When the queue is full, the message is dropped unless
+		//	the block policy is configured, in which case the caller waits for at most MaxWait_ ms.
+		inline bool Produce(const std::string &Topic, const std::string &Key, std::string &&Payload) {
+			std::unique_lock	G(Mutex_);
+			if(!Running_)
+				return false;
+			if(Queue_.size()>=MaxQueueSize_ && BlockWhenFull_) {
+				Writable_.wait_for(G, std::chrono::milliseconds(MaxWait_),
+								   [this]{ return Queue_.size()<MaxQueueSize_ || !Running_; });
+			}
+			if(Queue_.size()>=MaxQueueSize_) {
+				Stats_.Dropped++;
+				return false;
 			}
+			Queue_.push_back(Message{Topic, Key, std::move(Payload)});
+			Stats_.Queued++;
+			Stats_.MaxQueueSize = std::max(Stats_.MaxQueueSize, (uint64_t)Queue_.size());
+			if(Queue_.size()==1)
+				Readable_.notify_one();
+			return true;
 		}
 
-		inline void Produce(const std::string &Topic, const std::string &Key, const std::string &Payload) {
+		[[nodiscard]] inline ProducerStats Stats() const {
 			std::lock_guard	G(Mutex_);
-			Queue_.enqueueNotification( new KafkaMessage(Topic,Key,Payload));
+			auto S = Stats_;
+			S.Delivered = Delivered_;
+			S.Failed += Failed_;
+			return S;
 		}
 
     private:
-        std::recursive_mutex  	Mutex_;
-        Poco::Thread        	Worker_;
-        mutable std::atomic_bool    	Running_=false;
-		Poco::NotificationQueue	Queue_;
+		struct Message {
+			std::string	Topic;
+			std::string	Key;
+			std::string	Payload;
+		};
+
+        mutable std::mutex  		Mutex_;
+		std::condition_variable		Readable_;
+		std::condition_variable		Writable_;
+        Poco::Thread        		Worker_;
+        mutable std::atomic_bool    Running_=false;
+		std::deque<Message>			Queue_;
+		uint64_t 					Index_=0;
+		uint64_t 					MaxQueueSize_=100000;
+		bool 						BlockWhenFull_=false;
+		uint64_t 					MaxWait_=0;
+		ProducerStats				Stats_;
+		std::atomic_uint64_t		Delivered_=0;
+		std::atomic_uint64_t		Failed_=0;
+
+		inline void Send(cppkafka::Producer &Producer, const Message &Msg);
     };
 
     class KafkaConsumer : public Poco::Runnable {
@@ -2784,38 +2888,40 @@ namespace OpenWifi {
 	        return instance_;
 	    }
 
-	    inline int Start() override {
-	        if(!KafkaEnabled_)
-	            return 0;
-	        ConsumerThr_.Start();
-	        ProducerThr_.Start();
-			Dispatcher_.Start();
-	        return 0;
-	    }
-
-	    inline void Stop() override {
-	        if(KafkaEnabled_) {
-				poco_information(Logger(),"Stopping...");
-				Dispatcher_.Stop();
-	            ProducerThr_.Stop();
-	            ConsumerThr_.Stop();
-				poco_information(Logger(),"Stopped...");
-	            return;
-	        }
-	    }
+	    inline int Start() override;
+	    inline void Stop() override;
 
+		//	Messages for the same key (a serial number) always go to the same producer thread, so
+		//	per-device ordering is preserved across producer threads.
 	    inline void PostMessage(const std::string &topic, const std::string & key, const std::string &PayLoad, bool WrapMessage = true  ) {
-	        if(KafkaEnabled_) {
-				ProducerThr_.Produce(topic,key,WrapMessage ? WrapSystemId(PayLoad) : PayLoad);
+	        if(KafkaEnabled_ && !Producers_.empty()) {
+				auto &Producer = Producers_.size()==1 ? Producers_.front() : Producers_[std::hash<std::string>{}(key) % Producers_.size()];
+				Producer->Produce(topic,key,WrapMessage ? WrapSystemId(PayLoad) : std::string(PayLoad));
 	        }
 	    }
 
+		[[nodiscard]] inline KafkaProducer::ProducerStats ProducerStats() const {
+			KafkaProducer::ProducerStats	Total;
+			for(const auto &Producer:Producers_) {
+				auto S = Producer->Stats();
+				Total.Queued += S.Queued;
+				Total.Dropped += S.Dropped;
+				Total.Delivered += S.Delivered;
+				Total.Failed += S.Failed;
+				Total.MaxQueueSize = std::max(Total.MaxQueueSize, S.MaxQueueSize);
+			}
+			return Total;
+		}
+
 		inline void Dispatch(const std::string &Topic, const std::string & Key, const std::string &Payload) {
 			Dispatcher_.Dispatch(Topic, Key, Payload);
 		}
 
 	    [[nodiscard]] inline std::string WrapSystemId(const std::string & PayLoad) {
-	        return SystemInfoWrapper_ + PayLoad + "}";
+			std::string	Result;
+			Result.reserve(SystemInfoWrapper_.size() + PayLoad.size() + 1);
+			Result.append(SystemInfoWrapper_).append(PayLoad).push_back('}');
+	        return Result;
 	    }
 
 	    [[nodiscard]] inline bool Enabled() const { return KafkaEnabled_; }
@@ -2841,7 +2947,7 @@ namespace OpenWifi {
 	private:
 	    bool 							KafkaEnabled_ = false;
 	    std::string 					SystemInfoWrapper_;
-	    KafkaProducer                   ProducerThr_;
+	    std::vector<std::unique_ptr<KafkaProducer>>	Producers_;
 	    KafkaConsumer                   ConsumerThr_;
 		KafkaDispatcher					Dispatcher_;
 
@@ -4193,6 +4299,40 @@ namespace OpenWifi {
 	    KafkaEnabled_ = MicroService::instance().ConfigGetBool("openwifi.kafka.enable",false);
 	}
 
+	inline int KafkaManager::Start() {
+		if(!KafkaEnabled_)
+			return 0;
+
+		SystemInfoWrapper_ = 	R"lit({ "system" : { "id" : )lit" +
+			std::to_string(MicroService::instance().ID()) +
+			R"lit( , "host" : ")lit" + MicroService::instance().PrivateEndPoint() +
+			R"lit(" } , "payload" : )lit" ;
+
+		ConsumerThr_.Start();
+		auto NumberOfProducers = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("openwifi.kafka.producer.threads",1));
+		for(uint64_t i=0;i<NumberOfProducers;i++) {
+			Producers_.emplace_back(std::make_unique<KafkaProducer>());
+			Producers_.back()->Start(i);
+		}
+		Dispatcher_.Start();
+		return 0;
+	}
+
+	inline void KafkaManager::Stop() {
+		if(KafkaEnabled_) {
+			poco_information(Logger(),"Stopping...");
+			Dispatcher_.Stop();
+			for(auto &Producer:Producers_)
+				Producer->Stop();
+			auto S = ProducerStats();
+			poco_information(Logger(),fmt::format("Producer: queued={} dropped={} delivered={} failed={} max queue={}",
+												  S.Queued, S.Dropped, S.Delivered, S.Failed, S.MaxQueueSize));
+			ConsumerThr_.Stop();
+			poco_information(Logger(),"Stopped...");
+			return;
+		}
+	}
+
 	inline void KafkaLoggerFun([[maybe_unused]] cppkafka::KafkaHandleBase & handle, int level, const std::string & facility, const std::string &message) {
 		switch ((cppkafka::LogLevel) level) {
 			case cppkafka::LogLevel::LogNotice: {
@@ -4245,43 +4385,114 @@ namespace OpenWifi {
 			Config.set("ssl.key.password", Password);
 	}
 
+	inline void KafkaProducer::Start(uint64_t Index) {
+		if(!Running_) {
+			Index_ = Index;
+			MaxQueueSize_ = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("openwifi.kafka.producer.queue.size",100000));
+			BlockWhenFull_ = MicroService::instance().ConfigGetString("openwifi.kafka.producer.queue.policy","drop") == "block";
+			MaxWait_ = MicroService::instance().ConfigGetInt("openwifi.kafka.producer.queue.maxwait",100);
+			Running_=true;
+			Worker_.start(*this);
+		}
+	}
+
+	inline void KafkaProducer::Stop() {
+		if(Running_) {
+			{
+				std::lock_guard	G(Mutex_);
+				Running_=false;
+			}
+			Readable_.notify_all();
+			Writable_.notify_all();
+			Worker_.join();
+		}
+	}
+
+	inline void KafkaProducer::Send(cppkafka::Producer &Producer, const Message &Msg) {
+		//	When librdkafka's own queue is full, serve delivery reports for a while and retry.
+		for(int Attempt=0;;Attempt++) {
+			try {
+				Producer.produce(cppkafka::MessageBuilder(Msg.Topic).key(Msg.Key).payload(Msg.Payload));
+				return;
+			} catch (const cppkafka::HandleException &E) {
+				if(E.get_error().get_error()==RD_KAFKA_RESP_ERR__QUEUE_FULL && Attempt<10) {
+					Producer.poll(std::chrono::milliseconds(100));
+					continue;
+				}
+				Failed_++;
+				poco_warning(KafkaManager()->Logger(),fmt::format("Caught a Kafka exception (producer): {}", E.what()));
+				return;
+			}
+		}
+	}
+
 	inline void KafkaProducer::run() {
 
-		Utils::SetThreadName("Kafka:Prod");
+		Utils::SetThreadName(fmt::format("Kafka:Prod{}",Index_).c_str());
 	    cppkafka::Configuration Config({
             { "client.id", MicroService::instance().ConfigGetString("openwifi.kafka.client.id") },
-            { "metadata.broker.list", MicroService::instance().ConfigGetString("openwifi.kafka.brokerlist") }
+            { "metadata.broker.list", MicroService::instance().ConfigGetString("openwifi.kafka.brokerlist") },
+			{ "queue.buffering.max.ms", MicroService::instance().ConfigGetInt("openwifi.kafka.queue.buffering.max.ms",50) },
+			{ "batch.num.messages", MicroService::instance().ConfigGetInt("openwifi.kafka.producer.batch.messages",10000) },
+			{ "compression.codec", MicroService::instance().ConfigGetString("openwifi.kafka.producer.compression","none") }
 	    });
 
 		AddKafkaSecurity(Config);
 
 		Config.set_log_callback(KafkaLoggerFun);
 		Config.set_error_callback(KafkaErrorFun);
-
-	    KafkaManager()->SystemInfoWrapper_ = 	R"lit({ "system" : { "id" : )lit" +
-	            std::to_string(MicroService::instance().ID()) +
-	            R"lit( , "host" : ")lit" + MicroService::instance().PrivateEndPoint() +
-	            R"lit(" } , "payload" : )lit" ;
+		Config.set_delivery_report_callback([this]([[maybe_unused]] cppkafka::Producer &P, const cppkafka::Message &Msg) {
+			if(Msg.get_error())
+				Failed_++;
+			else
+				Delivered_++;
+		});
 
 		cppkafka::Producer	Producer(Config);
-	    Running_ = true;
 
-		Poco::AutoPtr<Poco::Notification>	Note(Queue_.waitDequeueNotification());
-		while(Note && Running_) {
-            try {
-                auto Msg = dynamic_cast<KafkaMessage *>(Note.get());
-                if (Msg != nullptr) {
-                    Producer.produce(
-                            cppkafka::MessageBuilder(Msg->Topic()).key(Msg->Key()).payload(Msg->Payload()));
-                }
-            } catch (const cppkafka::HandleException &E) {
-				poco_warning(KafkaManager()->Logger(),fmt::format("Caught a Kafka exception (producer): {}", E.what()));
-            } catch( const Poco::Exception &E) {
-                KafkaManager()->Logger().log(E);
-            } catch (...) {
-				poco_error(KafkaManager()->Logger(),"std::exception");
-            }
-			Note = Queue_.waitDequeueNotification();
+		//	Per topic compression, as "topic:codec,topic:codec". Topic handles must outlive the producer calls.
+		std::vector<cppkafka::Topic>	Topics;
+		auto TopicCompression = MicroService::instance().ConfigGetString("openwifi.kafka.producer.topic.compression","");
+		for(const auto &Entry:Poco::StringTokenizer(TopicCompression, ",", Poco::StringTokenizer::TOK_TRIM | Poco::StringTokenizer::TOK_IGNORE_EMPTY)) {
+			auto Pos = Entry.find(':');
+			if(Pos==std::string::npos)
+				continue;
+			try {
+				cppkafka::TopicConfiguration TopicConfig{ { "compression.codec", Entry.substr(Pos+1) } };
+				Topics.emplace_back(Producer.get_topic(Entry.substr(0,Pos), TopicConfig));
+			} catch (const cppkafka::Exception &E) {
+				poco_warning(KafkaManager()->Logger(),fmt::format("Invalid topic compression '{}': {}", Entry, E.what()));
+			}
+		}
+
+		std::deque<Message>	Batch;
+		while(true) {
+			{
+				std::unique_lock	G(Mutex_);
+				Readable_.wait_for(G, std::chrono::milliseconds(100), [this]{ return !Queue_.empty() || !Running_; });
+				if(Queue_.empty() && !Running_)
+					break;
+				Batch.swap(Queue_);
+			}
+			Writable_.notify_all();
+
+			for(const auto &Msg:Batch) {
+				try {
+					Send(Producer, Msg);
+				} catch( const Poco::Exception &E) {
+					KafkaManager()->Logger().log(E);
+				} catch (...) {
+					poco_error(KafkaManager()->Logger(),"std::exception");
+				}
+			}
+			Batch.clear();
+			Producer.poll(std::chrono::milliseconds(0));
+		}
+
+		try {
+			Producer.flush(std::chrono::milliseconds(MicroService::instance().ConfigGetInt("openwifi.kafka.producer.flush.timeout",5000)));
+		} catch (const cppkafka::HandleException &E) {
+			poco_warning(KafkaManager()->Logger(),fmt::format("Kafka producer could not flush all messages: {}", E.what()));
 		}
 	}
 
@@ -4948,18 +5159,73 @@ namespace OpenWifi {
 		}
 
 		template <typename T> void SendNotification(const WebSocketNotification<T> &Notification) {
-			Poco::JSON::Object  Payload;
-			Notification.to_json(Payload);
-			Poco::JSON::Object  Msg;
-			Msg.set("notification",Payload);
-			std::ostringstream OO;
-			Msg.stringify(OO);
-			SendToAll(OO.str());
+			SendDeviceNotification("", Notification, false);
+		}
+
+		//	Notifications go through the bus thread. Coalesced notifications for the same type and device
+		//	replace each other until the next flush, and only the last one is ever serialized.
+		template <typename T> void SendDeviceNotification(const std::string &SerialNumber,
+														  const WebSocketNotification<T> &Notification,
+														  bool Coalesce) {
+			if(NumberOfClients_==0)
+				return;
+			Post(BusNotification{ .Type = Notification.type, .SerialNumber = SerialNumber,
+								  .Serialize = [Notification]() {
+									  Poco::JSON::Object  Payload;
+									  Notification.to_json(Payload);
+									  Poco::JSON::Object  Msg;
+									  Msg.set("notification",Payload);
+									  std::ostringstream OO;
+									  Msg.stringify(OO);
+									  return OO.str();
+								  }}, Coalesce);
 		}
 
 		[[nodiscard]] bool SendToUser(const std::string &userName, const std::string &Payload);
 		void SendToAll(const std::string &Payload);
+
+		//	Lets a service expand a venue subscription into the serial numbers of that venue.
+		typedef std::function<bool(const std::string &Venue, Types::StringVec &SerialNumbers)>	VenueResolverFunction;
+		inline void SetVenueResolver(VenueResolverFunction F) {
+			std::lock_guard G(ResolverMutex_);
+			VenueResolver_ = std::move(F);
+		}
+		void Subscribe(const std::string &Id, const Poco::JSON::Object::Ptr &O, std::string &Answer);
+
     private:
+		struct BusNotification {
+			std::string						Type;
+			std::string						SerialNumber;
+			std::function<std::string()>	Serialize;
+		};
+
+		struct NotificationFilter {
+			std::set<std::string>	Types;
+			std::set<std::string>	SerialNumbers;
+
+			[[nodiscard]] inline bool Matches(const std::string &Type, const std::string &SerialNumber) const {
+				if(!Types.empty() && Types.find(Type)==Types.end())
+					return false;
+				if(!SerialNumber.empty() && !SerialNumbers.empty() && SerialNumbers.find(SerialNumber)==SerialNumbers.end())
+					return false;
+				return true;
+			}
+		};
+
+		struct ClientEntry {
+			WebSocketClient 								*Client=nullptr;
+			std::string										UserName;
+			NotificationFilter								Filter;
+			std::deque<std::shared_ptr<const std::string>>	Queue;
+			bool 											Dropped=false;
+			uint64_t 										Subscription=0;
+		};
+
+		struct VenueRequest {
+			uint64_t 						Subscription=0;
+			Types::StringVec				Venues;
+		};
+
         mutable std::atomic_bool Running_ = false;
         Poco::Thread 								Thr_;
         // std::unique_ptr<MyParallelSocketReactor> ReactorPool_;
@@ -4967,8 +5233,41 @@ namespace OpenWifi {
 		Poco::Thread								ReactorThread_;
         bool GeoCodeEnabled_ = false;
         std::string GoogleApiKey_;
-        std::map<std::string, std::pair<WebSocketClient *, std::string>> Clients_;
+        std::map<std::string, ClientEntry> 			Clients_;
+		std::atomic_uint64_t						NumberOfClients_=0;
         WebSocketClientProcessor *Processor_ = nullptr;
+		VenueResolverFunction						VenueResolver_;
+
+		std::mutex									BusMutex_;
+		std::condition_variable						BusReady_;
+		std::vector<BusNotification>				Immediate_;
+		std::map<std::pair<std::string,std::string>,BusNotification>	Coalesced_;
+		uint64_t 									CoalesceInterval_=1000;
+		uint64_t 									MaxClientQueue_=256;
+
+		//	Venue lookups call the provisioning service: they run on their own thread, never on the reactor.
+		std::mutex									ResolverMutex_;
+		std::condition_variable						ResolverReady_;
+		std::map<std::string,VenueRequest>			PendingVenues_;		//	per client, the latest request wins
+		Poco::Thread								ResolverThread_;
+		Poco::RunnableAdapter<WebSocketClientServer>	ResolverRunner_{*this, &WebSocketClientServer::RunResolver};
+
+		void Post(BusNotification &&Notification, bool Coalesce);
+		void Dispatch(std::vector<BusNotification> &Batch);
+		//	What the bus thread needs to write to a client once Mutex_ is released. The socket handle and the
+		//	send lock stay valid after the client is gone, writes then simply fail.
+		struct Recipient {
+			std::string						Id;
+			Poco::Net::WebSocket			WS;
+			std::shared_ptr<std::mutex>		SendLock;
+		};
+		bool 										DrainPending_=false;
+
+		bool Enqueue(const std::string &Id, ClientEntry &Entry, std::shared_ptr<const std::string> Payload);
+		void WakeBus();
+		void Drain(Recipient &R);
+		void RunResolver();
+		static bool Writable(Poco::Net::WebSocket &WS);
         WebSocketClientServer() noexcept;
     };
 
@@ -4984,8 +5283,13 @@ namespace OpenWifi {
         virtual ~WebSocketClient();
         [[nodiscard]] inline const std::string &Id();
         [[nodiscard]] Poco::Logger &Logger();
-        inline bool Send(const std::string &Payload);
+        //	A handle on the same socket, which stays usable (and fails cleanly) after the client is gone.
+        [[nodiscard]] inline Poco::Net::WebSocket Socket() const { return *WS_; }
+        //	Taken by every writer of this socket, the bus thread and the reactor alike.
+        [[nodiscard]] inline std::shared_ptr<std::mutex> SendLock() const { return SendLock_; }
+        inline void Drop();
     private:
+        std::shared_ptr<std::mutex>	SendLock_ = std::make_shared<std::mutex>();
         std::unique_ptr<Poco::Net::WebSocket> WS_;
         Poco::Net::SocketReactor 	&Reactor_;
         std::string 				Id_;
@@ -4997,17 +5301,20 @@ namespace OpenWifi {
         void OnSocketReadable(const Poco::AutoPtr<Poco::Net::ReadableNotification> &pNf);
         void OnSocketShutdown(const Poco::AutoPtr<Poco::Net::ShutdownNotification> &pNf);
         void OnSocketError(const Poco::AutoPtr<Poco::Net::ErrorNotification> &pNf);
+        void Reply(const char *Data, int Size, int Flags = Poco::Net::WebSocket::FRAME_TEXT);
     };
 
     inline void WebSocketClientServer::NewClient(Poco::Net::WebSocket & WS, const std::string &Id, const std::string &UserName ) {
         std::lock_guard G(Mutex_);
         auto Client = new WebSocketClient(WS,Id,UserName,Logger(), Processor_);
-        Clients_[Id] = std::make_pair(Client,"");
+        Clients_[Id] = ClientEntry{ .Client = Client };
+        NumberOfClients_ = Clients_.size();
     }
 
     inline bool WebSocketClientServer::Register( WebSocketClient * Client, const std::string &Id) {
         std::lock_guard G(Mutex_);
-        Clients_[Id] = std::make_pair(Client,"");
+        Clients_[Id] = ClientEntry{ .Client = Client };
+        NumberOfClients_ = Clients_.size();
         return true;
     }
 
@@ -5018,6 +5325,7 @@ namespace OpenWifi {
     inline void WebSocketClientServer::UnRegister(const std::string &Id) {
         std::lock_guard G(Mutex_);
         Clients_.erase(Id);
+        NumberOfClients_ = Clients_.size();
     }
 
     inline void WebSocketClientServer::SetUser(const std::string &Id, const std::string &UserId) {
@@ -5025,10 +5333,196 @@ namespace OpenWifi {
 
         auto it=Clients_.find(Id);
         if(it!=Clients_.end()) {
-            Clients_[Id] = std::make_pair(it->second.first,UserId);
+            it->second.UserName = UserId;
         }
     }
 
+	//	{ "command" : "subscribe", "types" : [...], "serialNumbers" : [...], "venues" : [...] }
+	//	An empty or missing list means everything. The devices of the venues are added to the filter once
+	//	the resolver thread has looked them up, until then a venue only subscription matches no device.
+	inline void WebSocketClientServer::Subscribe(const std::string &Id, const Poco::JSON::Object::Ptr &O, std::string &Answer) {
+		NotificationFilter		Filter;
+		Types::StringVec		List, Venues;
+
+		RESTAPI_utils::field_from_json(O,"types",List);
+		Filter.Types.insert(List.begin(),List.end());
+		List.clear();
+		RESTAPI_utils::field_from_json(O,"serialNumbers",List);
+		Filter.SerialNumbers.insert(List.begin(),List.end());
+		RESTAPI_utils::field_from_json(O,"venues",Venues);
+
+		//	A venue that resolves to nothing must not turn into "all devices".
+		if(!Venues.empty() && Filter.SerialNumbers.empty())
+			Filter.SerialNumbers.insert("");
+
+		Answer = fmt::format(R"lit({{ "subscribed" : {{ "types" : {}, "serialNumbers" : {}, "venues" : {} }} }})lit",
+							 Filter.Types.size(), List.size(), Venues.size());
+
+		uint64_t Subscription;
+		{
+			std::lock_guard G(Mutex_);
+			auto it=Clients_.find(Id);
+			if(it==Clients_.end())
+				return;
+			it->second.Filter = std::move(Filter);
+			Subscription = ++it->second.Subscription;
+		}
+
+		std::lock_guard G(ResolverMutex_);
+		if(Venues.empty()) {
+			PendingVenues_.erase(Id);
+			return;
+		}
+		PendingVenues_[Id] = VenueRequest{ .Subscription = Subscription, .Venues = std::move(Venues) };
+		ResolverReady_.notify_one();
+	}
+
+	inline void WebSocketClientServer::RunResolver() {
+		Utils::SetThreadName("ws:uiclnt-venue");
+		while(true) {
+			std::string				Id;
+			VenueRequest			Request;
+			VenueResolverFunction	Resolver;
+			{
+				std::unique_lock	G(ResolverMutex_);
+				ResolverReady_.wait(G, [this]{ return !PendingVenues_.empty() || !Running_; });
+				if(!Running_)
+					return;
+				auto First = PendingVenues_.begin();
+				Id = First->first;
+				Request = std::move(First->second);
+				PendingVenues_.erase(First);
+				Resolver = VenueResolver_;
+			}
+
+			std::set<std::string>	SerialNumbers;
+			for(const auto &Venue:Request.Venues) {
+				Types::StringVec	Devices;
+				if(Resolver && Resolver(Venue,Devices))
+					SerialNumbers.insert(Devices.begin(),Devices.end());
+			}
+
+			std::lock_guard G(Mutex_);
+			auto it=Clients_.find(Id);
+			//	The client may have gone, or subscribed again while we were looking up.
+			if(it==Clients_.end() || it->second.Subscription!=Request.Subscription || SerialNumbers.empty())
+				continue;
+			it->second.Filter.SerialNumbers.erase("");
+			it->second.Filter.SerialNumbers.insert(SerialNumbers.begin(),SerialNumbers.end());
+		}
+	}
+
+	inline void WebSocketClientServer::Post(BusNotification &&Notification, bool Coalesce) {
+		{
+			std::lock_guard	G(BusMutex_);
+			if(Coalesce) {
+				auto Key = std::make_pair(Notification.Type, Notification.SerialNumber);
+				Coalesced_[Key] = std::move(Notification);
+				return;
+			}
+			Immediate_.push_back(std::move(Notification));
+		}
+		BusReady_.notify_one();
+	}
+
+	//	Caller holds Mutex_. Every frame for a client goes through its bounded queue: a client whose queue
+	//	is full is not keeping up and is dropped.
+	inline bool WebSocketClientServer::Enqueue(const std::string &Id, ClientEntry &Entry, std::shared_ptr<const std::string> Payload) {
+		if(Entry.Dropped)
+			return false;
+		if(Entry.Queue.size()>=MaxClientQueue_) {
+			poco_debug(Logger(),fmt::format("DROP({}): {} UI client is not keeping up.", Id, Entry.UserName));
+			Entry.Dropped = true;
+			Entry.Queue.clear();
+			Entry.Client->Drop();
+			return false;
+		}
+		Entry.Queue.push_back(std::move(Payload));
+		return true;
+	}
+
+	//	Frames queued outside of the bus thread are sent on its next pass.
+	inline void WebSocketClientServer::WakeBus() {
+		{
+			std::lock_guard	G(BusMutex_);
+			DrainPending_ = true;
+		}
+		BusReady_.notify_one();
+	}
+
+	//	Runs on the bus thread. Each notification is serialized at most once, and only if a client wants it.
+	//	The lock only covers the queues: frames are sent once it is released, so a slow client cannot hold
+	//	up the others or the reactor.
+	inline void WebSocketClientServer::Dispatch(std::vector<BusNotification> &Batch) {
+		std::vector<Recipient>	Recipients;
+		{
+			std::lock_guard G(Mutex_);
+			for(auto &Notification:Batch) {
+				std::shared_ptr<const std::string>	Payload;
+				for(auto &[Id,Entry]:Clients_) {
+					if(Entry.Dropped || !Entry.Filter.Matches(Notification.Type, Notification.SerialNumber))
+						continue;
+					if(!Payload)
+						Payload = std::make_shared<const std::string>(Notification.Serialize());
+					Enqueue(Id, Entry, Payload);
+				}
+			}
+
+			for(auto &[Id,Entry]:Clients_) {
+				if(!Entry.Dropped && !Entry.Queue.empty())
+					Recipients.push_back(Recipient{ .Id = Id, .WS = Entry.Client->Socket(), .SendLock = Entry.Client->SendLock() });
+			}
+		}
+
+		for(auto &R:Recipients)
+			Drain(R);
+	}
+
+	//	Only the bus thread takes from the queues, so the front is still ours after the send.
+	inline void WebSocketClientServer::Drain(Recipient &R) {
+		while(true) {
+			std::shared_ptr<const std::string>	Payload;
+			{
+				std::lock_guard G(Mutex_);
+				auto it=Clients_.find(R.Id);
+				if(it==Clients_.end() || it->second.Dropped || it->second.Queue.empty())
+					return;
+				Payload = it->second.Queue.front();
+			}
+			if(!Writable(R.WS))
+				return;
+			bool Sent = true;
+			{
+				std::lock_guard	S(*R.SendLock);
+				try {
+					R.WS.sendFrame(Payload->c_str(),(int)Payload->size());
+				} catch (...) {
+					Sent = false;
+				}
+			}
+			std::lock_guard G(Mutex_);
+			auto it=Clients_.find(R.Id);
+			if(it==Clients_.end())
+				return;
+			if(!Sent) {
+				it->second.Dropped = true;
+				it->second.Queue.clear();
+				it->second.Client->Drop();
+				return;
+			}
+			it->second.Queue.pop_front();
+		}
+	}
+
+	inline bool WebSocketClientServer::Writable(Poco::Net::WebSocket &WS) {
+		try {
+			return WS.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_WRITE);
+		} catch (...) {
+
+		}
+		return false;
+	}
+
     [[nodiscard]] inline bool SendToUser(const std::string &userName, const std::string &Payload);
     inline WebSocketClientServer::WebSocketClientServer() noexcept:
             SubSystemServer("WebSocketClientServer", "UI-WSCLNT-SVR", "websocketclients")
@@ -5038,20 +5532,38 @@ namespace OpenWifi {
     inline void WebSocketClientServer::run() {
         Running_ = true ;
 		Utils::SetThreadName("ws:uiclnt-svr");
+		auto NextFlush = std::chrono::steady_clock::now() + std::chrono::milliseconds(CoalesceInterval_);
         while(Running_) {
-            Poco::Thread::trySleep(2000);
-
-            if(!Running_)
-                break;
+			std::vector<BusNotification>	Batch;
+			{
+				std::unique_lock	G(BusMutex_);
+				BusReady_.wait_until(G, NextFlush, [this]{ return !Immediate_.empty() || DrainPending_ || !Running_; });
+				if(!Running_)
+					break;
+				Batch.swap(Immediate_);
+				DrainPending_ = false;
+				auto Now = std::chrono::steady_clock::now();
+				if(Now>=NextFlush) {
+					for(auto &[_,Notification]:Coalesced_)
+						Batch.push_back(std::move(Notification));
+					Coalesced_.clear();
+					NextFlush = Now + std::chrono::milliseconds(CoalesceInterval_);
+				}
+			}
+			Dispatch(Batch);
         }
     };
 
     inline int WebSocketClientServer::Start() {
         GoogleApiKey_ = MicroService::instance().ConfigGetString("google.apikey","");
         GeoCodeEnabled_ = !GoogleApiKey_.empty();
+		CoalesceInterval_ = std::max((uint64_t)10, MicroService::instance().ConfigGetInt("websocketclients.coalesce.interval",1000));
+		MaxClientQueue_ = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("websocketclients.queue.size",256));
         // ReactorPool_ = std::make_unique<MyParallelSocketReactor>();
+		Running_ = true;
 		ReactorThread_.start(Reactor_);
         Thr_.start(*this);
+		ResolverThread_.start(ResolverRunner_);
         return 0;
     };
 
@@ -5059,9 +5571,17 @@ namespace OpenWifi {
         if(Running_) {
 			Reactor_.stop();
 			ReactorThread_.join();
-            Running_ = false;
-            Thr_.wakeUp();
+			{
+				std::lock_guard	G(BusMutex_);
+				Running_ = false;
+			}
+			BusReady_.notify_all();
             Thr_.join();
+			{
+				std::lock_guard	G(ResolverMutex_);
+			}
+			ResolverReady_.notify_all();
+			ResolverThread_.join();
         }
     };
 
@@ -5071,41 +5591,39 @@ namespace OpenWifi {
     }
 
     inline bool WebSocketClientServer::Send(const std::string &Id, const std::string &Payload) {
-        std::lock_guard G(Mutex_);
-
-        auto It = Clients_.find(Id);
-        if(It!=Clients_.end())
-            return It->second.first->Send(Payload);
-        return false;
+		{
+			std::lock_guard G(Mutex_);
+			auto It = Clients_.find(Id);
+			if(It==Clients_.end() || !Enqueue(Id, It->second, std::make_shared<const std::string>(Payload)))
+				return false;
+		}
+		WakeBus();
+		return true;
     }
 
     inline bool WebSocketClientServer::SendToUser(const std::string &UserName, const std::string &Payload) {
-        std::lock_guard G(Mutex_);
         uint64_t Sent=0;
-
-        for(const auto &client:Clients_) {
-            if(client.second.second == UserName) {
-				try {
-					if (client.second.first->Send(Payload))
-						Sent++;
-				} catch (...) {
-					return false;
-				}
-            }
-        }
+		{
+			std::lock_guard G(Mutex_);
+			auto Shared = std::make_shared<const std::string>(Payload);
+			for(auto &[Id,Entry]:Clients_) {
+				if(Entry.UserName == UserName && Enqueue(Id, Entry, Shared))
+					Sent++;
+			}
+		}
+		if(Sent)
+			WakeBus();
         return Sent>0;
     }
 
 	inline void WebSocketClientServer::SendToAll(const std::string &Payload) {
-		std::lock_guard G(Mutex_);
-
-		for(const auto &client:Clients_) {
-			try {
-				client.second.first->Send(Payload);
-			} catch (...) {
-
-			}
+		{
+			std::lock_guard G(Mutex_);
+			auto Shared = std::make_shared<const std::string>(Payload);
+			for(auto &[Id,Entry]:Clients_)
+				Enqueue(Id, Entry, Shared);
 		}
+		WakeBus();
 	}
 
 	inline void WebSocketClient::OnSocketReadable([[maybe_unused]] const Poco::AutoPtr<Poco::Net::ReadableNotification> &pNf) {
@@ -5124,9 +5642,7 @@ namespace OpenWifi {
 
 			switch (Op) {
 			case Poco::Net::WebSocket::FRAME_OP_PING: {
-				WS_->sendFrame("", 0,
-							   (int)Poco::Net::WebSocket::FRAME_OP_PONG |
-								   (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
+				Reply("", 0, (int)Poco::Net::WebSocket::FRAME_OP_PONG | (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
 			} break;
 			case Poco::Net::WebSocket::FRAME_OP_PONG: {
 			} break;
@@ -5146,11 +5662,11 @@ namespace OpenWifi {
 						UserName_ = UserInfo_.userinfo.email;
 						poco_debug(Logger(),fmt::format("START({}): {} UI Client is starting WS connection.", Id_, UserName_));
 						std::string S{"Welcome! Bienvenue! Bienvenidos!"};
-						WS_->sendFrame(S.c_str(), S.size());
+						Reply(S.c_str(), (int)S.size());
 						WebSocketClientServer()->SetUser(Id_, UserInfo_.userinfo.email);
 					} else {
 						std::string S{"Invalid token. Closing connection."};
-						WS_->sendFrame(S.c_str(), S.size());
+						Reply(S.c_str(), (int)S.size());
 						Done = true;
 					}
 
@@ -5160,12 +5676,14 @@ namespace OpenWifi {
 						auto Obj =
 							P.parse(IncomingFrame.begin()).extract<Poco::JSON::Object::Ptr>();
 						std::string Answer;
-						if (Processor_ != nullptr)
+						if (Obj->has("command") && Obj->get("command").toString()=="subscribe")
+							WebSocketClientServer()->Subscribe(Id_, Obj, Answer);
+						else if (Processor_ != nullptr)
 							Processor_->Processor(Obj, Answer, Done);
 						if (!Answer.empty())
-							WS_->sendFrame(Answer.c_str(), (int)Answer.size());
+							Reply(Answer.c_str(), (int)Answer.size());
 						else {
-							WS_->sendFrame("{}", 2);
+							Reply("{}", 2);
 						}
 					} catch (const Poco::JSON::JSONException &E) {
 						Logger().log(E);
@@ -5243,14 +5761,18 @@ namespace OpenWifi {
         return Logger_;
     }
 
-    [[nodiscard]] inline bool WebSocketClient::Send(const std::string &Payload) {
+    //	Answers to the client's own requests, written from the reactor thread. Exceptions reach the caller.
+    inline void WebSocketClient::Reply(const char *Data, int Size, int Flags) {
+        std::lock_guard	G(*SendLock_);
+        WS_->sendFrame(Data, Size, Flags);
+    }
+
+    inline void WebSocketClient::Drop() {
         try {
-            WS_->sendFrame(Payload.c_str(),Payload.size());
-            return true;
+            WS_->shutdown();
         } catch (...) {
 
         }
-        return false;
     }
 
     class RESTAPI_webSocketServer : public RESTAPIHandler {
@@ -110,7 +110,7 @@ namespace OpenWifi {
 		N.content.oldUUID = oldUUID;
 		N.content.newUUID = newUUID;
 		N.type = "device_configuration_upgrade";
-		WebSocketClientServer()->SendNotification(N);
+		WebSocketClientServer()->SendDeviceNotification(SerialNumber, N, false);
 	}
 
 	inline void WebSocketClientNotificationDeviceFirmwareUpdated(const std::string &SerialNumber, const std::string &Firmware) {
@@ -118,21 +118,68 @@ namespace OpenWifi {
 		N.content.serialNumber = SerialNumber;
 		N.content.newFirmware = Firmware;
 		N.type = "device_firmware_upgrade";
-		WebSocketClientServer()->SendNotification(N);
+		WebSocketClientServer()->SendDeviceNotification(SerialNumber, N, false);
 	}
 
 	inline void WebSocketClientNotificationDeviceConnected(const std::string &SerialNumber) {
 		WebSocketNotification<WebNotificationSingleDevice>	N;
 		N.content.serialNumber = SerialNumber;
 		N.type = "device_connection";
-		WebSocketClientServer()->SendNotification(N);
+		WebSocketClientServer()->SendDeviceNotification(SerialNumber, N, false);
 	}
 
 	inline void WebSocketClientNotificationDeviceDisconnected(const std::string & SerialNumber) {
 		WebSocketNotification<WebNotificationSingleDevice>	N;
 		N.content.serialNumber = SerialNumber;
 		N.type = "device_disconnection";
-		WebSocketClientServer()->SendNotification(N);
+		WebSocketClientServer()->SendDeviceNotification(SerialNumber, N, false);
+	}
+
+	struct WebNotificationCommandCompletion {
+		std::string		serialNumber;
+		std::string		UUID;
+		std::string		command;
+		std::string		status;
+		std::uint64_t	errorCode=0;
+		std::string		errorText;
+
+		inline void to_json(Poco::JSON::Object &Obj) const {
+			RESTAPI_utils::field_to_json(Obj,"serialNumber", serialNumber);
+			RESTAPI_utils::field_to_json(Obj,"UUID", UUID);
+			RESTAPI_utils::field_to_json(Obj,"command", command);
+			RESTAPI_utils::field_to_json(Obj,"status", status);
+			RESTAPI_utils::field_to_json(Obj,"errorCode", errorCode);
+			RESTAPI_utils::field_to_json(Obj,"errorText", errorText);
+		}
+
+		inline bool from_json(const Poco::JSON::Object::Ptr &Obj) {
+			try {
+				RESTAPI_utils::field_from_json(Obj,"serialNumber", serialNumber);
+				RESTAPI_utils::field_from_json(Obj,"UUID", UUID);
+				RESTAPI_utils::field_from_json(Obj,"command", command);
+				RESTAPI_utils::field_from_json(Obj,"status", status);
+				RESTAPI_utils::field_from_json(Obj,"errorCode", errorCode);
+				RESTAPI_utils::field_from_json(Obj,"errorText", errorText);
+				return true;
+			} catch (...) {
+
+			}
+			return false;
+		}
+	};
+
+	inline void WebSocketClientNotificationCommandCompleted(const std::string &SerialNumber, const std::string &UUID,
+														   const std::string &Command, const std::string &Status,
+														   std::uint64_t ErrorCode, const std::string &ErrorText) {
+		WebSocketNotification<WebNotificationCommandCompletion>	N;
+		N.content.serialNumber = SerialNumber;
+		N.content.UUID = UUID;
+		N.content.command = Command;
+		N.content.status = Status;
+		N.content.errorCode = ErrorCode;
+		N.content.errorText = ErrorText;
+		N.type = "command_completion";
+		WebSocketClientServer()->SendDeviceNotification(SerialNumber, N, false);
 	}
 
     struct WebSocketNotificationJobContent {
@@ -198,6 +198,7 @@ namespace OpenWifi::RESTAPI::Errors {
 
 	static const struct msg MaximumRTTYSessionsReached{1144,"Too many RTTY sessions currently active"};
 	static const struct msg DeviceIsAlreadyBusy{1145,"Device is already executing a command. Please try later."};
+	static const struct msg InvalidCursor{1146,"Invalid or expired pagination cursor."};
 }
 
 
@@ -308,6 +309,9 @@ namespace OpenWifi::RESTAPI::Protocol {
 	static const char * DEBUG = "debug";
 	static const char * SCRIPT = "script";
 	static const char * TIMEOUT = "timeout";
+	static const char * ASYNCHRONOUS = "asynchronous";
+	static const char * CURSOR = "cursor";
+	static const char * NEXTCURSOR = "nextCursor";
 
 	static const char * NEWPASSWORD = "newPassword";
 	static const char * USERS = "users";
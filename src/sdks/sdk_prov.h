@@ -9,6 +9,28 @@
 
 namespace OpenWifi::SDK::Prov {
 
+	inline bool GetSerialNumbersForVenue( const std::string & Venue, Types::StringVec & SerialNumbers, Poco::Logger &Logger ) {
+		OpenAPIRequestGet	GetInventoryForVenue( uSERVICE_PROVISIONING, "/api/v1/inventory" ,
+											   {
+												   {"serialOnly","true"},
+												   {"venue", Venue}
+											   }, 30000);
+
+		auto CallResponse = Poco::makeShared<Poco::JSON::Object>();
+		if(!GetInventoryForVenue.Do(CallResponse,"")) {
+			Logger.error(fmt::format("{}: Cannot get inventory for venue.", Venue));
+			return false;
+		}
+
+		try {
+			OpenWifi::RESTAPI_utils::field_from_json(CallResponse, "serialNumbers", SerialNumbers);
+		} catch(...) {
+			Logger.error(fmt::format("{}: Cannot parse inventory list", Venue));
+			return false;
+		}
+		return true;
+	}
+
 	inline bool GetSerialNumbersForVenueOfSerialNumber( const std::string & SerialNumber, Types::UUID_t &Venue, Types::StringVec & AdjacentSerialNumbers , Poco::Logger &Logger ) {
 		OpenAPIRequestGet	GetInventoryForSerialNumber( uSERVICE_PROVISIONING, "/api/v1/inventory/" + SerialNumber , {} , 30000);
 
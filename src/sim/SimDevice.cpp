@@ -0,0 +1,279 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "Poco/Buffer.h"
+#include "Poco/JSON/Parser.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/HTTPSClientSession.h"
+#include "Poco/Net/NetException.h"
+
+#include "fmt/format.h"
+
+#include "sim/SimDevice.h"
+
+namespace OpenWifi::Sim {
+
+	static inline std::uint64_t Microseconds(SimClock::duration D) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(D).count();
+	}
+
+	static inline std::uint64_t Now() {
+		return std::chrono::duration_cast<std::chrono::seconds>(
+				   std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	SimDevice::SimDevice(const SimSettings &Settings, SimStats &Stats, std::string SerialNumber)
+		: Settings_(Settings), Stats_(Stats), SerialNumber_(std::move(SerialNumber)),
+		  Random_(std::hash<std::string>{}(SerialNumber_)) {
+		NextConnect_ = SimClock::now();
+	}
+
+	//	Blocks for the TCP connect, the TLS handshake and the websocket upgrade. Returns null on failure.
+	std::unique_ptr<Poco::Net::WebSocket> SimDevice::Open(Poco::Net::Context::Ptr Context) const {
+		auto Start = SimClock::now();
+		try {
+			Poco::Net::HTTPSClientSession Session(Settings_.Host, Settings_.Port, Context);
+			Session.setTimeout(Poco::Timespan(30, 0));
+			Poco::Net::HTTPRequest Request(Poco::Net::HTTPRequest::HTTP_GET, "/",
+										   Poco::Net::HTTPMessage::HTTP_1_1);
+			Poco::Net::HTTPResponse Response;
+			auto WS = std::make_unique<Poco::Net::WebSocket>(Session, Request, Response);
+			WS->setMaxPayloadSize(256000);
+			WS->setReceiveTimeout(Poco::Timespan(30, 0));
+			Stats_.ConnectLatency.Add(Microseconds(SimClock::now() - Start));
+			return WS;
+		} catch (const Poco::Exception &) {
+		}
+		return nullptr;
+	}
+
+	//	Back on the owning worker with what Open returned.
+	bool SimDevice::Connect(std::unique_ptr<Poco::Net::WebSocket> WS) {
+		Connecting_ = false;
+		auto Connected = SimClock::now();
+		if (!WS) {
+			Stats_.ConnectFailures++;
+			NextConnect_ = Connected + std::chrono::seconds(Settings_.ReconnectDelay);
+			return false;
+		}
+
+		WS_ = std::move(WS);
+		Stats_.Connects++;
+		Stats_.Connected++;
+		ConnectedAt_ = Connected;
+		PingOutstanding_ = false;
+		TelemetryInterval_ = Settings_.TelemetryInterval;
+
+		SendEvent("connect", fmt::format(R"lit({{"serial":"{}","uuid":{},"firmware":"{}","capabilities":{}}})lit",
+										 SerialNumber_, UUID_, Settings_.Firmware, Settings_.Capabilities));
+		if (!WS_)
+			return false;
+
+		//	Spread the first events over their interval so a connection wave does not turn into a
+		//	synchronized burst on every period.
+		Schedule(NextState_, Settings_.StateInterval, Connected, true);
+		Schedule(NextHealthCheck_, Settings_.HealthCheckInterval, Connected, true);
+		Schedule(NextLog_, Settings_.LogInterval, Connected, true);
+		Schedule(NextTelemetry_, TelemetryInterval_, Connected, true);
+		Schedule(NextPing_, Settings_.PingInterval, Connected, true);
+		return true;
+	}
+
+	void SimDevice::Disconnect(bool Reconnect) {
+		if (!WS_)
+			return;
+		try {
+			WS_->shutdown();
+		} catch (...) {
+		}
+		WS_.reset();
+		Stats_.Connected--;
+		Stats_.Disconnects++;
+		NextConnect_ = SimClock::now() + std::chrono::seconds(Reconnect ? Settings_.ReconnectDelay : 0);
+	}
+
+	void SimDevice::Schedule(SimClock::time_point &Next, std::uint64_t Interval, SimClock::time_point Now,
+							 bool Jitter) {
+		if (Interval == 0) {
+			Next = SimClock::time_point::max();
+			return;
+		}
+		auto Period = std::chrono::milliseconds(Interval * 1000);
+		Next = Now + (Jitter ? std::chrono::milliseconds(Random_() % (Interval * 1000)) : Period);
+	}
+
+	std::uint64_t SimDevice::UpTime() const {
+		return std::chrono::duration_cast<std::chrono::seconds>(SimClock::now() - ConnectedAt_).count();
+	}
+
+	void SimDevice::SendText(const std::string &Frame) {
+		if (!WS_)
+			return;
+		try {
+			WS_->sendFrame(Frame.c_str(), (int)Frame.size());
+			Stats_.FramesSent++;
+			Stats_.BytesSent += Frame.size();
+		} catch (const Poco::Exception &) {
+			Stats_.Errors++;
+			Disconnect(true);
+		}
+	}
+
+	void SimDevice::SendEvent(const std::string &Method, const std::string &Params) {
+		SendText(fmt::format(R"lit({{"jsonrpc":"2.0","method":"{}","params":{}}})lit", Method, Params));
+	}
+
+	void SimDevice::SendState() {
+		auto Associations = [this](const char *Prefix) {
+			std::string Result;
+			auto Count = Settings_.Associations ? Random_() % (Settings_.Associations + 1) : 0;
+			for (std::uint64_t i = 0; i < Count; i++) {
+				if (!Result.empty())
+					Result += ',';
+				Result += fmt::format(R"lit({{"station":"{}:00:00:{:02x}","rssi":-{},"rx_bytes":{},"tx_bytes":{}}})lit",
+									  Prefix, i, 40 + Random_() % 40, Random_() % 100000000, Random_() % 100000000);
+			}
+			return Result;
+		};
+		constexpr std::uint64_t Total = 512 * 1024 * 1024;
+		std::uint64_t Free = Total / 4 + Random_() % (Total / 2);
+		SendEvent("state", fmt::format(
+			R"lit({{"serial":"{}","uuid":{},"state":{{"unit":{{"uptime":{},"localtime":{},"memory":{{"total":{},"free":{},"cached":0,"buffered":0}},"load":[{},{},{}]}},)lit"
+			R"lit("radios":[{{"phy":"platform/soc/c000000.wifi","channel":6,"band":["2G"],"tx_power":20}},{{"phy":"platform/soc/c000000.wifi1","channel":36,"band":["5G"],"tx_power":23}}],)lit"
+			R"lit("interfaces":[{{"name":"up0v0","location":"/interfaces/0","ssids":[)lit"
+			R"lit({{"phy":"platform/soc/c000000.wifi","ssid":"OpenWifi","mode":"ap","associations":[{}]}},)lit"
+			R"lit({{"phy":"platform/soc/c000000.wifi1","ssid":"OpenWifi","mode":"ap","associations":[{}]}}]}}]}}}})lit",
+			SerialNumber_, UUID_, UpTime(), Now(), Total, Free,
+			Random_() % 32768, Random_() % 32768, Random_() % 32768,
+			Associations("02:00"), Associations("02:50")));
+	}
+
+	void SimDevice::SendHealthCheck() {
+		SendEvent("healthcheck", fmt::format(R"lit({{"serial":"{}","uuid":{},"sanity":100,"data":{{}}}})lit",
+											 SerialNumber_, UUID_));
+	}
+
+	void SimDevice::SendLog() {
+		SendEvent("log", fmt::format(R"lit({{"serial":"{}","log":"owgw-sim: periodic log message at uptime {}","severity":6}})lit",
+									 SerialNumber_, UpTime()));
+	}
+
+	void SimDevice::SendTelemetry() {
+		SendEvent("telemetry", fmt::format(R"lit({{"serial":"{}","data":{{"event":{{"type":"dhcp","uptime":{},"payload":{{"op":"ack"}}}}}}}})lit",
+										   SerialNumber_, UpTime()));
+	}
+
+	//	The ping event is followed by a websocket PING. The gateway processes a connection's frames in
+	//	order, so the PONG round trip is the frame latency as seen by the device.
+	void SimDevice::SendPing() {
+		SendEvent("ping", fmt::format(R"lit({{"serial":"{}","uuid":{}}})lit", SerialNumber_, UUID_));
+		if (!WS_ || PingOutstanding_)
+			return;
+		try {
+			PingSent_ = SimClock::now();
+			WS_->sendFrame("", 0, (int)Poco::Net::WebSocket::FRAME_OP_PING | (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
+			PingOutstanding_ = true;
+		} catch (const Poco::Exception &) {
+			Stats_.Errors++;
+			Disconnect(true);
+		}
+	}
+
+	void SimDevice::AnswerRPC(const Poco::JSON::Object::Ptr &Request) {
+		std::uint64_t Id = Request->get("id");
+		auto Method = Request->get("method").toString();
+		auto Params = Request->getObject("params");
+		bool Reboot = false;
+
+		if (Method == "configure" && Params && Params->has("uuid")) {
+			UUID_ = Params->get("uuid");
+		} else if (Method == "telemetry" && Params && Params->has("interval")) {
+			TelemetryInterval_ = Params->get("interval");
+			Schedule(NextTelemetry_, TelemetryInterval_, SimClock::now(), false);
+		} else if (Method == "reboot" || Method == "factory" || Method == "upgrade") {
+			Reboot = true;
+		}
+
+		SendText(fmt::format(R"lit({{"jsonrpc":"2.0","id":{},"result":{{"serial":"{}","uuid":{},"status":{{"error":0,"text":"Success","when":0}}}}}})lit",
+							 Id, SerialNumber_, UUID_));
+		Stats_.RPCAnswered++;
+
+		if (Reboot) {
+			Disconnect(false);
+			NextConnect_ = SimClock::now() + std::chrono::seconds(5);
+		}
+	}
+
+	void SimDevice::OnReadable() {
+		if (!WS_)
+			return;
+		try {
+			do {
+				int Flags = 0;
+				Poco::Buffer<char> Frame(0);
+				auto Size = WS_->receiveFrame(Frame, Flags);
+				auto Op = Flags & Poco::Net::WebSocket::FRAME_OP_BITMASK;
+
+				if (Size == 0 && Flags == 0) {
+					Disconnect(true);
+					return;
+				}
+				Stats_.FramesReceived++;
+
+				switch (Op) {
+				case Poco::Net::WebSocket::FRAME_OP_PING:
+					WS_->sendFrame("", 0, (int)Poco::Net::WebSocket::FRAME_OP_PONG | (int)Poco::Net::WebSocket::FRAME_FLAG_FIN);
+					break;
+				case Poco::Net::WebSocket::FRAME_OP_PONG:
+					if (PingOutstanding_) {
+						Stats_.FrameLatency.Add(Microseconds(SimClock::now() - PingSent_));
+						PingOutstanding_ = false;
+					}
+					break;
+				case Poco::Net::WebSocket::FRAME_OP_CLOSE:
+					Disconnect(true);
+					return;
+				case Poco::Net::WebSocket::FRAME_OP_TEXT: {
+					Poco::JSON::Parser P;
+					auto Request = P.parse(std::string(Frame.begin(), Frame.size())).extract<Poco::JSON::Object::Ptr>();
+					if (Request->has("method") && Request->has("id"))
+						AnswerRPC(Request);
+				} break;
+				default:
+					break;
+				}
+			} while (WS_ && WS_->available() > 0);
+		} catch (const Poco::JSON::JSONException &) {
+			Stats_.Errors++;
+		} catch (const Poco::Exception &) {
+			Stats_.Errors++;
+			Disconnect(true);
+		}
+	}
+
+	void SimDevice::OnTimer(SimClock::time_point Now) {
+		if (WS_ && Now >= NextState_) {
+			SendState();
+			Schedule(NextState_, Settings_.StateInterval, Now, false);
+		}
+		if (WS_ && Now >= NextHealthCheck_) {
+			SendHealthCheck();
+			Schedule(NextHealthCheck_, Settings_.HealthCheckInterval, Now, false);
+		}
+		if (WS_ && Now >= NextLog_) {
+			SendLog();
+			Schedule(NextLog_, Settings_.LogInterval, Now, false);
+		}
+		if (WS_ && Now >= NextTelemetry_) {
+			SendTelemetry();
+			Schedule(NextTelemetry_, TelemetryInterval_, Now, false);
+		}
+		if (WS_ && Now >= NextPing_) {
+			SendPing();
+			Schedule(NextPing_, Settings_.PingInterval, Now, false);
+		}
+	}
+}
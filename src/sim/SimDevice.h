@@ -0,0 +1,81 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Poco/JSON/Object.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/WebSocket.h"
+
+#include "sim/SimStats.h"
+
+namespace OpenWifi::Sim {
+
+	struct SimSettings {
+		std::string 	Host{"localhost"};
+		std::uint16_t 	Port=15002;
+		std::string 	Firmware{"OpenWifi owgw-sim"};
+		std::string 	Capabilities;
+		//	All intervals are in seconds, 0 disables the event.
+		std::uint64_t 	StateInterval=60;
+		std::uint64_t 	HealthCheckInterval=60;
+		std::uint64_t 	LogInterval=300;
+		std::uint64_t 	TelemetryInterval=0;
+		std::uint64_t 	PingInterval=60;
+		std::uint64_t 	ReconnectDelay=10;
+		std::uint64_t 	Associations=4;
+	};
+
+	using SimClock = std::chrono::steady_clock;
+
+	//	One simulated access point. A device is only ever touched by the worker thread that owns it, except
+	//	for Open which only reads its settings and runs on a connect thread.
+	class SimDevice {
+	  public:
+		SimDevice(const SimSettings &Settings, SimStats &Stats, std::string SerialNumber);
+
+		[[nodiscard]] std::unique_ptr<Poco::Net::WebSocket> Open(Poco::Net::Context::Ptr Context) const;
+		inline void Connecting() { Connecting_ = true; }
+		bool Connect(std::unique_ptr<Poco::Net::WebSocket> WS);
+		void Disconnect(bool Reconnect);
+		void OnReadable();
+		void OnTimer(SimClock::time_point Now);
+
+		[[nodiscard]] inline bool Connected() const { return WS_ != nullptr; }
+		[[nodiscard]] inline bool ReadyToConnect(SimClock::time_point Now) const { return !WS_ && !Connecting_ && Now >= NextConnect_; }
+		[[nodiscard]] inline Poco::Net::WebSocket &Socket() { return *WS_; }
+		[[nodiscard]] inline const std::string &SerialNumber() const { return SerialNumber_; }
+
+	  private:
+		const SimSettings 						&Settings_;
+		SimStats 								&Stats_;
+		std::string 							SerialNumber_;
+		std::unique_ptr<Poco::Net::WebSocket> 	WS_;
+		std::mt19937_64 						Random_;
+		std::uint64_t 							UUID_=1;
+		std::uint64_t 							TelemetryInterval_=0;
+		SimClock::time_point 					ConnectedAt_, NextConnect_;
+		SimClock::time_point 					NextState_, NextHealthCheck_, NextLog_, NextTelemetry_, NextPing_;
+		SimClock::time_point 					PingSent_;
+		bool 									PingOutstanding_=false;
+		bool 									Connecting_=false;
+
+		void Schedule(SimClock::time_point &Next, std::uint64_t Interval, SimClock::time_point Now, bool Jitter);
+		void SendText(const std::string &Frame);
+		void SendEvent(const std::string &Method, const std::string &Params);
+		void SendState();
+		void SendHealthCheck();
+		void SendLog();
+		void SendTelemetry();
+		void SendPing();
+		void AnswerRPC(const Poco::JSON::Object::Ptr &Request);
+		[[nodiscard]] std::uint64_t UpTime() const;
+	};
+}
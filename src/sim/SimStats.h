@@ -0,0 +1,62 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace OpenWifi::Sim {
+
+	//	Lock free latency histogram with power of 2 microsecond buckets. Percentiles are reported as
+	//	the upper bound of the bucket they fall in, which is plenty for a load generator.
+	class SimLatency {
+	  public:
+		inline void Add(std::uint64_t Microseconds) {
+			std::size_t Bucket = 0;
+			while (Bucket + 1 < Buckets_.size() && (1ULL << Bucket) < Microseconds)
+				Bucket++;
+			Buckets_[Bucket]++;
+			Count_++;
+			Total_ += Microseconds;
+			auto Max = Max_.load();
+			while (Microseconds > Max && !Max_.compare_exchange_weak(Max, Microseconds))
+				;
+		}
+
+		[[nodiscard]] inline std::uint64_t Count() const { return Count_; }
+		[[nodiscard]] inline std::uint64_t Max() const { return Max_; }
+		[[nodiscard]] inline std::uint64_t Average() const { return Count_ ? Total_ / Count_ : 0; }
+
+		[[nodiscard]] inline std::uint64_t Percentile(double P) const {
+			std::uint64_t Target = (std::uint64_t)(P * (double)Count_), Seen = 0;
+			for (std::size_t Bucket = 0; Bucket < Buckets_.size(); Bucket++) {
+				Seen += Buckets_[Bucket];
+				if (Seen > Target)
+					return 1ULL << Bucket;
+			}
+			return Max_;
+		}
+
+	  private:
+		std::array<std::atomic_uint64_t, 40> Buckets_{};
+		std::atomic_uint64_t Count_ = 0, Total_ = 0, Max_ = 0;
+	};
+
+	struct SimStats {
+		std::atomic_uint64_t Connected = 0;
+		std::atomic_uint64_t Connects = 0;
+		std::atomic_uint64_t ConnectFailures = 0;
+		std::atomic_uint64_t Disconnects = 0;
+		std::atomic_uint64_t FramesSent = 0;
+		std::atomic_uint64_t FramesReceived = 0;
+		std::atomic_uint64_t BytesSent = 0;
+		std::atomic_uint64_t RPCAnswered = 0;
+		std::atomic_uint64_t Errors = 0;
+		SimLatency ConnectLatency;
+		SimLatency FrameLatency;
+	};
+}
@@ -0,0 +1,366 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+//	owgw-sim: opens many TLS websocket connections to a gateway and behaves like a fleet of access
+//	points. Everything is local: the gateway address, the certificates, and the capabilities.
+
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Poco/Net/NetSSL.h"
+#include "Poco/Net/Socket.h"
+#include "Poco/NumberParser.h"
+#include "Poco/Thread.h"
+#include "Poco/Util/Application.h"
+#include "Poco/Util/HelpFormatter.h"
+#include "Poco/Util/Option.h"
+#include "Poco/Util/OptionSet.h"
+
+#include "fmt/format.h"
+
+#include "sim/SimDevice.h"
+
+namespace OpenWifi::Sim {
+
+	static std::atomic_bool Terminate = false;
+
+	static const std::string DefaultCapabilities{
+		R"lit({"compatible":"edgecore_eap102","model":"Edgecore EAP102","platform":"ap","network":{"lan":["eth1"],"wan":["eth0"]},)lit"
+		R"lit("wifi":{"platform/soc/c000000.wifi":{"band":["2G"],"channels":[1,2,3,4,5,6,7,8,9,10,11]},)lit"
+		R"lit("platform/soc/c000000.wifi1":{"band":["5G"],"channels":[36,40,44,48,149,153,157,161,165]}}})lit"};
+
+	//	Connections are paced globally: every worker takes connect slots from the same clock.
+	class ConnectPacer {
+	  public:
+		explicit ConnectPacer(std::uint64_t Rate) : Slot_(std::chrono::microseconds(1000000 / std::max((std::uint64_t)1, Rate))) {}
+
+		bool Take(SimClock::time_point Now) {
+			std::lock_guard G(Mutex_);
+			if (Next_ > Now)
+				return false;
+			Next_ = std::max(Next_ + Slot_, Now - Slot_ * 10);
+			return true;
+		}
+
+	  private:
+		std::mutex 					Mutex_;
+		SimClock::duration 			Slot_;
+		SimClock::time_point 		Next_{};
+	};
+
+	//	TLS connects block for up to the session timeout, so they run on their own threads and the
+	//	socket is handed back to the worker that owns the device.
+	class SimConnector : public Poco::Runnable {
+	  public:
+		using Completion = std::function<void(SimDevice *, std::unique_ptr<Poco::Net::WebSocket>)>;
+
+		explicit SimConnector(Poco::Net::Context::Ptr Context) : Context_(std::move(Context)) {}
+
+		void Submit(SimDevice *Device, Completion Done) {
+			{
+				std::lock_guard G(Mutex_);
+				Jobs_.emplace_back(Device, std::move(Done));
+			}
+			Ready_.notify_one();
+		}
+
+		void run() override {
+			while (!Terminate) {
+				std::pair<SimDevice *, Completion> Job;
+				{
+					std::unique_lock G(Mutex_);
+					Ready_.wait_for(G, std::chrono::milliseconds(100), [this] { return !Jobs_.empty() || Terminate; });
+					if (Terminate || Jobs_.empty())
+						continue;
+					Job = std::move(Jobs_.front());
+					Jobs_.pop_front();
+				}
+				Job.second(Job.first, Job.first->Open(Context_));
+			}
+		}
+
+	  private:
+		Poco::Net::Context::Ptr 							Context_;
+		std::mutex 											Mutex_;
+		std::condition_variable 							Ready_;
+		std::deque<std::pair<SimDevice *, Completion>> 		Jobs_;
+	};
+
+	class SimWorker : public Poco::Runnable {
+	  public:
+		SimWorker(SimConnector &Connector, ConnectPacer &Pacer) : Connector_(Connector), Pacer_(Pacer) {}
+
+		void Add(std::unique_ptr<SimDevice> Device) { Devices_.push_back(std::move(Device)); }
+
+		void run() override {
+			Poco::Net::Socket::SocketList Readable, Writable, Errors;
+			std::unordered_map<Poco::Net::SocketImpl *, SimDevice *> BySocket;
+			std::vector<std::pair<SimDevice *, std::unique_ptr<Poco::Net::WebSocket>>> Opened;
+
+			while (!Terminate) {
+				{
+					std::lock_guard G(Mutex_);
+					Opened.swap(Opened_);
+				}
+				for (auto &[Device, WS] : Opened)
+					Device->Connect(std::move(WS));
+				Opened.clear();
+
+				auto Now = SimClock::now();
+				Readable.clear();
+				BySocket.clear();
+				for (auto &Device : Devices_) {
+					if (Device->ReadyToConnect(Now) && Pacer_.Take(Now)) {
+						Device->Connecting();
+						Connector_.Submit(Device.get(), [this](SimDevice *D, std::unique_ptr<Poco::Net::WebSocket> WS) {
+							std::lock_guard G(Mutex_);
+							Opened_.emplace_back(D, std::move(WS));
+						});
+					}
+					if (Device->Connected()) {
+						Readable.push_back(Device->Socket());
+						BySocket[Device->Socket().impl()] = Device.get();
+					}
+				}
+
+				if (Readable.empty()) {
+					Poco::Thread::sleep(50);
+				} else {
+					Writable.clear();
+					Errors.clear();
+					try {
+						Poco::Net::Socket::select(Readable, Writable, Errors, Poco::Timespan(0, 50000));
+					} catch (const Poco::Exception &) {
+						Readable.clear();
+					}
+					for (auto &Socket : Readable) {
+						auto Hint = BySocket.find(Socket.impl());
+						if (Hint != BySocket.end())
+							Hint->second->OnReadable();
+					}
+				}
+
+				Now = SimClock::now();
+				for (auto &Device : Devices_)
+					Device->OnTimer(Now);
+			}
+
+			for (auto &Device : Devices_)
+				Device->Disconnect(false);
+		}
+
+	  private:
+		SimConnector 								&Connector_;
+		ConnectPacer 								&Pacer_;
+		std::vector<std::unique_ptr<SimDevice>> 	Devices_;
+		std::mutex 									Mutex_;
+		std::vector<std::pair<SimDevice *, std::unique_ptr<Poco::Net::WebSocket>>> Opened_;
+	};
+
+	class Simulator : public Poco::Util::Application {
+	  public:
+		void defineOptions(Poco::Util::OptionSet &Options) override {
+			Application::defineOptions(Options);
+
+			auto Add = [&](const std::string &Name, const std::string &Short, const std::string &Help,
+						   const std::string &Argument) {
+				Options.addOption(Poco::Util::Option(Name, Short, Help)
+									  .required(false)
+									  .repeatable(false)
+									  .argument(Argument)
+									  .callback(Poco::Util::OptionCallback<Simulator>(this, &Simulator::handleOption)));
+			};
+
+			Options.addOption(Poco::Util::Option("help", "h", "display help information on command line arguments")
+								  .required(false)
+								  .repeatable(false)
+								  .callback(Poco::Util::OptionCallback<Simulator>(this, &Simulator::handleHelp)));
+			Add("gateway", "g", "gateway websocket address (default localhost:15002)", "host:port");
+			Add("devices", "n", "number of simulated devices (default 100)", "count");
+			Add("threads", "t", "number of worker threads (default 4)", "count");
+			Add("prefix", "p", "serial number prefix, completed with a hex index (default 53494d)", "hex");
+			Add("cert", "c", "device client certificate (PEM)", "file");
+			Add("key", "k", "device client key (PEM)", "file");
+			Add("cacert", "a", "CA used to verify the gateway. Without it the gateway is not verified", "file");
+			Add("capabilities", "C", "device capabilities document (default: built-in EAP102)", "file");
+			Add("connect-rate", "r", "new connections per second (default 50)", "count");
+			Add("connect-threads", "x", "threads opening connections (default 16)", "count");
+			Add("state", "s", "state interval in seconds, 0 to disable (default 60)", "seconds");
+			Add("healthcheck", "H", "healthcheck interval in seconds, 0 to disable (default 60)", "seconds");
+			Add("log", "l", "log interval in seconds, 0 to disable (default 300)", "seconds");
+			Add("telemetry", "T", "telemetry interval in seconds, 0 to only send when asked (default 0)", "seconds");
+			Add("ping", "P", "ping interval in seconds, 0 to disable (default 60)", "seconds");
+			Add("reconnect", "R", "delay before reconnecting after a failure in seconds (default 10)", "seconds");
+			Add("duration", "d", "run for this many seconds, 0 to run until interrupted (default 0)", "seconds");
+			Add("report", "i", "statistics report interval in seconds (default 10)", "seconds");
+		}
+
+		void handleHelp([[maybe_unused]] const std::string &Name, [[maybe_unused]] const std::string &Value) {
+			Poco::Util::HelpFormatter Formatter(options());
+			Formatter.setCommand(commandName());
+			Formatter.setUsage("OPTIONS");
+			Formatter.setHeader("A uCentral access point simulator and gateway load generator.");
+			Formatter.format(std::cout);
+			Help_ = true;
+			stopOptionsProcessing();
+		}
+
+		void handleOption(const std::string &Name, const std::string &Value) {
+			auto Number = [&]() { return Poco::NumberParser::parseUnsigned64(Value); };
+			if (Name == "gateway") {
+				auto Colon = Value.rfind(':');
+				Settings_.Host = Value.substr(0, Colon);
+				if (Colon != std::string::npos)
+					Settings_.Port = (std::uint16_t)Poco::NumberParser::parseUnsigned(Value.substr(Colon + 1));
+			} else if (Name == "devices") {
+				Devices_ = Number();
+			} else if (Name == "threads") {
+				Threads_ = std::max((std::uint64_t)1, Number());
+			} else if (Name == "prefix") {
+				Prefix_ = Value;
+			} else if (Name == "cert") {
+				Cert_ = Value;
+			} else if (Name == "key") {
+				Key_ = Value;
+			} else if (Name == "cacert") {
+				CACert_ = Value;
+			} else if (Name == "capabilities") {
+				std::ifstream In(Value);
+				std::stringstream SS;
+				SS << In.rdbuf();
+				Settings_.Capabilities = SS.str();
+			} else if (Name == "connect-rate") {
+				ConnectRate_ = Number();
+			} else if (Name == "connect-threads") {
+				ConnectThreads_ = std::max((std::uint64_t)1, Number());
+			} else if (Name == "state") {
+				Settings_.StateInterval = Number();
+			} else if (Name == "healthcheck") {
+				Settings_.HealthCheckInterval = Number();
+			} else if (Name == "log") {
+				Settings_.LogInterval = Number();
+			} else if (Name == "telemetry") {
+				Settings_.TelemetryInterval = Number();
+			} else if (Name == "ping") {
+				Settings_.PingInterval = Number();
+			} else if (Name == "reconnect") {
+				Settings_.ReconnectDelay = Number();
+			} else if (Name == "duration") {
+				Duration_ = Number();
+			} else if (Name == "report") {
+				ReportInterval_ = std::max((std::uint64_t)1, Number());
+			}
+		}
+
+		int main([[maybe_unused]] const ArgVec &Args) override {
+			if (Help_)
+				return EXIT_OK;
+
+			if (Cert_.empty() || Key_.empty()) {
+				std::cerr << "A device certificate and key are required (--cert and --key). "
+							 "See test_scripts/sim/create_sim_certificates.sh" << std::endl;
+				return EXIT_USAGE;
+			}
+			if (Settings_.Capabilities.empty())
+				Settings_.Capabilities = DefaultCapabilities;
+
+			Poco::Net::initializeSSL();
+			Poco::Net::Context::Params P;
+			P.certificateFile = Cert_;
+			P.privateKeyFile = Key_;
+			P.caLocation = CACert_;
+			P.verificationMode = CACert_.empty() ? Poco::Net::Context::VERIFY_NONE : Poco::Net::Context::VERIFY_RELAXED;
+			P.loadDefaultCAs = false;
+			Poco::Net::Context::Ptr Context = new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE, P);
+
+			ConnectPacer Pacer(ConnectRate_);
+			SimConnector Connector(Context);
+			std::vector<std::unique_ptr<SimWorker>> Workers;
+			for (std::uint64_t i = 0; i < Threads_; i++)
+				Workers.push_back(std::make_unique<SimWorker>(Connector, Pacer));
+			for (std::uint64_t i = 0; i < Devices_; i++) {
+				auto SerialNumber = fmt::format("{}{:0{}x}", Prefix_, i + 1, Prefix_.size() < 12 ? 12 - Prefix_.size() : 0);
+				Workers[i % Threads_]->Add(std::make_unique<SimDevice>(Settings_, Stats_, SerialNumber));
+			}
+
+			std::signal(SIGINT, [](int) { Terminate = true; });
+			std::signal(SIGTERM, [](int) { Terminate = true; });
+
+			std::cout << fmt::format("Simulating {} devices against {}:{} with {} threads at {} connections/s.",
+									 Devices_, Settings_.Host, Settings_.Port, Threads_, ConnectRate_) << std::endl;
+
+			std::vector<std::unique_ptr<Poco::Thread>> Threads;
+			for (auto &Worker : Workers) {
+				Threads.push_back(std::make_unique<Poco::Thread>());
+				Threads.back()->start(*Worker);
+			}
+			for (std::uint64_t i = 0; i < ConnectThreads_; i++) {
+				Threads.push_back(std::make_unique<Poco::Thread>());
+				Threads.back()->start(Connector);
+			}
+
+			auto Start = SimClock::now(), LastReport = Start;
+			std::uint64_t LastConnects = 0, LastFrames = 0;
+			while (!Terminate) {
+				Poco::Thread::sleep(200);
+				auto Now = SimClock::now();
+				if (Duration_ && Now - Start >= std::chrono::seconds(Duration_))
+					Terminate = true;
+				if (Terminate || Now - LastReport >= std::chrono::seconds(ReportInterval_)) {
+					double Elapsed = std::chrono::duration<double>(Now - LastReport).count();
+					Report(Elapsed, LastConnects, LastFrames);
+					LastConnects = Stats_.Connects;
+					LastFrames = Stats_.FramesSent;
+					LastReport = Now;
+				}
+			}
+
+			for (auto &Thread : Threads)
+				Thread->join();
+			Poco::Net::uninitializeSSL();
+			return Stats_.Connects ? EXIT_OK : EXIT_UNAVAILABLE;
+		}
+
+	  private:
+		SimSettings 		Settings_;
+		SimStats 			Stats_;
+		bool 				Help_ = false;
+		std::uint64_t 		Devices_ = 100;
+		std::uint64_t 		Threads_ = 4;
+		std::uint64_t 		ConnectRate_ = 50;
+		std::uint64_t 		ConnectThreads_ = 16;
+		std::uint64_t 		Duration_ = 0;
+		std::uint64_t 		ReportInterval_ = 10;
+		std::string 		Prefix_{"53494d"};
+		std::string 		Cert_, Key_, CACert_;
+
+		void Report(double Elapsed, std::uint64_t LastConnects, std::uint64_t LastFrames) {
+			Elapsed = std::max(Elapsed, 0.001);
+			std::cout << fmt::format(
+							 "connected={} connects={} ({:.1f}/s) connect-failures={} disconnects={} "
+							 "frames-out={} ({:.1f}/s) frames-in={} rpc={} errors={} | "
+							 "connect us avg={} p99<={} max={} | frame us avg={} p99<={} max={}",
+							 Stats_.Connected.load(), Stats_.Connects.load(), (Stats_.Connects - LastConnects) / Elapsed,
+							 Stats_.ConnectFailures.load(), Stats_.Disconnects.load(), Stats_.FramesSent.load(),
+							 (Stats_.FramesSent - LastFrames) / Elapsed, Stats_.FramesReceived.load(),
+							 Stats_.RPCAnswered.load(), Stats_.Errors.load(), Stats_.ConnectLatency.Average(),
+							 Stats_.ConnectLatency.Percentile(0.99), Stats_.ConnectLatency.Max(),
+							 Stats_.FrameLatency.Average(), Stats_.FrameLatency.Percentile(0.99),
+							 Stats_.FrameLatency.Max())
+					  << std::endl;
+		}
+	};
+}
+
+POCO_APP_MAIN(OpenWifi::Sim::Simulator)
@@ -16,50 +16,58 @@
 namespace OpenWifi {
 
 bool Storage::CreateDeviceCapabilities(std::string &SerialNumber, std::string &Capabilities) {
-	try {
-		Poco::Data::Session     Sess = Pool_->get();
-		Poco::Data::Statement   UpSert(Sess);
-
-		uint64_t Now = OpenWifi::Now();
-		std::string St{	"insert into Capabilities (SerialNumber, Capabilities, FirstUpdate, LastUpdate) values(?,?,?,?) on conflict (SerialNumber) do "
-						   	" update set Capabilities=?, LastUpdate=?"};
-		UpSert << ConvertParams(St),
-			Poco::Data::Keywords::use(SerialNumber),
-			Poco::Data::Keywords::use(Capabilities),
-			Poco::Data::Keywords::use(Now),
-			Poco::Data::Keywords::use(Now),
-			Poco::Data::Keywords::use(Capabilities),
-			Poco::Data::Keywords::use(Now);
-		UpSert.execute();
-		return true;
-	}
-	catch (const Poco::Exception &E) {
-		poco_warning(Logger(),fmt::format("{}: Failed with: {}", std::string(__func__), E.displayText()));
-	}
-	return false;
+	return StoreDeviceCapabilities(SerialNumber, Capabilities);
 }
 
 	bool Storage::UpdateDeviceCapabilities(std::string &SerialNumber, std::string & Capabilities, std::string & Compat) {
+		OpenWifi::Config::Capabilities	Caps(Capabilities);
+		Compat = Caps.Compatible();
+		if(!Caps.Compatible().empty() && !Caps.Platform().empty())
+			CapabilitiesCache::instance()->Add(Caps.Compatible(), Caps.Platform(), Capabilities);
+		return StoreDeviceCapabilities(SerialNumber, Capabilities);
+	}
+
+	//	Devices of the same model running the same firmware report identical capabilities. Each document
+	//	is stored once in CapabilityDocuments under its hash and devices only refer to that hash, so a
+	//	device reconnecting with the same capabilities costs one lookup and no write. Rows written before
+	//	this keep their capabilities inline until the device reports again.
+	//	The reference is written before the document: RemoveOrphanedCapabilities only deletes documents
+	//	nobody refers to, so a cleanup running in between can only remove a document we then put back.
+	bool Storage::StoreDeviceCapabilities(std::string &SerialNumber, std::string &Capabilities) {
 		try {
+			auto Hash = Utils::ComputeHash(Capabilities);
 			Poco::Data::Session     Sess = Pool_->get();
-			Poco::Data::Statement   UpSert(Sess);
+
+			std::string CurrentHash;
+			Poco::Data::Statement   Select(Sess);
+			std::string St1{"SELECT c.CapabilitiesHash FROM Capabilities c JOIN CapabilityDocuments d ON c.CapabilitiesHash=d.Hash WHERE c.SerialNumber=?"};
+			Select << ConvertParams(St1),
+				Poco::Data::Keywords::into(CurrentHash),
+				Poco::Data::Keywords::use(SerialNumber);
+			Select.execute();
+			if(CurrentHash==Hash)
+				return true;
 
 			uint64_t Now = OpenWifi::Now();
-			OpenWifi::Config::Capabilities	Caps(Capabilities);
-			Compat = Caps.Compatible();
-			if(!Caps.Compatible().empty() && !Caps.Platform().empty())
-				CapabilitiesCache::instance()->Add(Caps.Compatible(), Caps.Platform(), Capabilities);
-
-			std::string St{"insert into Capabilities (SerialNumber, Capabilities, FirstUpdate, LastUpdate) values(?,?,?,?) on conflict (SerialNumber) do "
-						   " update set Capabilities=?, LastUpdate=?"};
-			UpSert << ConvertParams(St),
+			Poco::Data::Statement   UpSert(Sess);
+			std::string St3{"insert into Capabilities (SerialNumber, Capabilities, CapabilitiesHash, FirstUpdate, LastUpdate) values(?,'',?,?,?) on conflict (SerialNumber) do "
+							" update set Capabilities='', CapabilitiesHash=?, LastUpdate=?"};
+			UpSert << ConvertParams(St3),
 				Poco::Data::Keywords::use(SerialNumber),
-				Poco::Data::Keywords::use(Capabilities),
+				Poco::Data::Keywords::use(Hash),
 				Poco::Data::Keywords::use(Now),
 				Poco::Data::Keywords::use(Now),
-				Poco::Data::Keywords::use(Capabilities),
+				Poco::Data::Keywords::use(Hash),
 				Poco::Data::Keywords::use(Now);
 			UpSert.execute();
+
+			Poco::Data::Statement   Insert(Sess);
+			std::string St2{"insert into CapabilityDocuments (Hash, Capabilities, FirstUpdate) values(?,?,?) on conflict (Hash) do nothing"};
+			Insert << ConvertParams(St2),
+				Poco::Data::Keywords::use(Hash),
+				Poco::Data::Keywords::use(Capabilities),
+				Poco::Data::Keywords::use(Now);
+			Insert.execute();
 			return true;
 		}
 		catch (const Poco::Exception &E) {
@@ -75,7 +83,8 @@ bool Storage::CreateDeviceCapabilities(std::string &SerialNumber, std::string &C
 
 			std::string TmpSerialNumber;
 
-			std::string St{"SELECT SerialNumber, Capabilities, FirstUpdate, LastUpdate FROM Capabilities WHERE SerialNumber=?"};
+			std::string St{"SELECT c.SerialNumber, COALESCE(d.Capabilities, c.Capabilities), c.FirstUpdate, c.LastUpdate FROM Capabilities c "
+						   "LEFT JOIN CapabilityDocuments d ON c.CapabilitiesHash=d.Hash WHERE c.SerialNumber=?"};
 
 			Select  << ConvertParams(St),
 				Poco::Data::Keywords::into(TmpSerialNumber),
@@ -115,4 +124,21 @@ bool Storage::CreateDeviceCapabilities(std::string &SerialNumber, std::string &C
 		return false;
 	}
 
-}
\ No newline at end of file
+	//	Documents no device refers to anymore, after devices were deleted or upgraded.
+	bool Storage::RemoveOrphanedCapabilities() {
+		try {
+			Poco::Data::Session     Sess = Pool_->get();
+			Poco::Data::Statement   Delete(Sess);
+
+			std::string St{"DELETE FROM CapabilityDocuments WHERE Hash NOT IN (SELECT CapabilitiesHash FROM Capabilities WHERE CapabilitiesHash IS NOT NULL)"};
+			Delete << ConvertParams(St);
+			Delete.execute();
+			return true;
+		}
+		catch (const Poco::Exception &E) {
+			poco_warning(Logger(),fmt::format("{}: Failed with: {}", std::string(__func__), E.displayText()));
+		}
+		return false;
+	}
+
+}
@@ -155,7 +155,6 @@ typedef Poco::Tuple<
 			Insert << ConvertParams(St),
 				Poco::Data::Keywords::use(R);
 			Insert.execute();
-
 			return true;
 
 		} catch (const Poco::Exception &E) {
@@ -194,7 +193,7 @@ typedef Poco::Tuple<
 			Poco::Data::Statement Select(Sess);
 
 			std::string FullQuery = IntroStatement + DateSelector +
-					" ORDER BY Submitted ASC " + ComputeRange(Offset, HowMany);
+					" ORDER BY Submitted ASC, UUID ASC " + ComputeRange(Offset, HowMany);
 
 			Select << 	FullQuery,
 				Poco::Data::Keywords::into(Records);
@@ -306,21 +305,27 @@ typedef Poco::Tuple<
 		return false;
 	}
 
+	struct CommandExecutedQuery : CachedStatement {
+		uint64_t 		Now=0;
+		std::string 	Status;
+		std::string 	UUID;
+	};
+
 	bool Storage::SetCommandExecuted(std::string &CommandUUID) {
 		try {
-			Poco::Data::Session Sess = Pool_->get();
-			Poco::Data::Statement Update(Sess);
-
-			auto Now = OpenWifi::Now();
-			auto Status = to_string(Storage::CommandExecutionType::COMMAND_EXECUTED);
-
-			std::string St{"UPDATE CommandList SET Executed=?, Status=? WHERE UUID=?"};
-
-			Update << ConvertParams(St),
-				Poco::Data::Keywords::use(Now),
-				Poco::Data::Keywords::use(Status),
-				Poco::Data::Keywords::use( CommandUUID);
-			Update.execute();
+			auto Lease = Statements_.Acquire();
+			auto &Q = Lease->Get<CommandExecutedQuery>("SetCommandExecuted", [&](Poco::Data::Statement &Update, CommandExecutedQuery &Query) {
+				std::string St{"UPDATE CommandList SET Executed=?, Status=? WHERE UUID=?"};
+				Update << ConvertParams(St),
+					Poco::Data::Keywords::use(Query.Now),
+					Poco::Data::Keywords::use(Query.Status),
+					Poco::Data::Keywords::use(Query.UUID);
+			});
+
+			Q.Now = OpenWifi::Now();
+			Q.Status = to_string(Storage::CommandExecutionType::COMMAND_EXECUTED);
+			Q.UUID = CommandUUID;
+			Lease->Execute(Q);
 			return true;
 		} catch (const Poco::Exception &E) {
 			Logger().log(E);
@@ -452,32 +457,29 @@ typedef Poco::Tuple<
 		return false;
 	}
 
-	bool Storage::GetReadyToExecuteCommands(uint64_t Offset, uint64_t HowMany,
-											std::vector<GWObjects::CommandDetails> &Commands) {
-
+	bool Storage::GetPendingCommands(uint64_t Offset, uint64_t HowMany, std::vector<GWObjects::CommandDetails> &Commands) {
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 			Poco::Data::Statement Select(Sess);
 
-			auto Now = OpenWifi::Now();
-			std::string St{
-				"SELECT " +
-				DB_Command_SelectFields
-				+ " FROM CommandList "
-				" WHERE ((RunAt<=?) And (Executed=0)) ORDER BY Submitted ASC "};
-			CommandDetailsRecordList Records;
+			typedef Poco::Tuple<std::string, std::string, std::string, uint64_t, uint64_t> PendingRecord;
+			std::vector<PendingRecord> Records;
 
-			std::string SS = ConvertParams(St) + ComputeRange(Offset, HowMany);
-			Select << SS,
-				Poco::Data::Keywords::into(Records),
-				Poco::Data::Keywords::use(Now);
+			std::string St{"SELECT UUID, SerialNumber, Command, Submitted, RunAt FROM CommandList WHERE Executed=0 ORDER BY Submitted ASC, UUID ASC " +
+						   ComputeRange(Offset, HowMany)};
+			Select << St,
+				Poco::Data::Keywords::into(Records);
 			Select.execute();
 
+			Commands.reserve(Records.size());
 			for(const auto &i : Records) {
 				GWObjects::CommandDetails R;
-				ConvertCommandRecord(i,R);
-				if (AP_WS_Server()->Connected(Utils::SerialNumberToInt(R.SerialNumber)))
-					Commands.push_back(R);
+				R.UUID = i.get<0>();
+				R.SerialNumber = i.get<1>();
+				R.Command = i.get<2>();
+				R.Submitted = i.get<3>();
+				R.RunAt = i.get<4>();
+				Commands.push_back(R);
 			}
 			return true;
 		} catch (const Poco::Exception &E) {
@@ -486,6 +488,36 @@ typedef Poco::Tuple<
 		return false;
 	}
 
+	struct PendingCommandQuery : CachedStatement {
+		std::string 				UUID;
+		CommandDetailsRecordList 	Records;
+	};
+
+	bool Storage::GetPendingCommand(const std::string &UUID, GWObjects::CommandDetails &Command) {
+		try {
+			auto Lease = Statements_.Acquire();
+			auto &Q = Lease->Get<PendingCommandQuery>("GetPendingCommand", [&](Poco::Data::Statement &Select, PendingCommandQuery &Query) {
+				std::string St{
+					"SELECT " +
+					DB_Command_SelectFields +
+					" FROM CommandList WHERE UUID=? AND Executed=0"};
+				Select << ConvertParams(St),
+					Poco::Data::Keywords::into(Query.Records),
+					Poco::Data::Keywords::use(Query.UUID);
+			});
+			Q.UUID = UUID;
+			Q.Records.clear();
+			Lease->Execute(Q);
+			if(Q.Records.empty())
+				return false;
+			ConvertCommandRecord(Q.Records[0],Command);
+			return true;
+		} catch (const Poco::Exception &E) {
+			Logger().log(E);
+		}
+		return false;
+	}
+
 	bool Storage::CommandExecuted(std::string &UUID) {
 		try {
 			auto Now = OpenWifi::Now();
@@ -731,7 +763,7 @@ typedef Poco::Tuple<
 			Poco::Data::Session     Sess = Pool_->get();
 			Poco::Data::Statement   Select(Sess);
 
-			Select << "SELECT Command from CommandList";
+			Select << "SELECT Command, COUNT(*) FROM CommandList GROUP BY Command";
 			Select.execute();
 
 			Poco::Data::RecordSet   RSet(Select);
@@ -740,7 +772,7 @@ typedef Poco::Tuple<
 			while(More) {
 				auto Command = RSet[0].convert<std::string>();
 				if(!Command.empty())
-					UpdateCountedMap(R,Command);
+					UpdateCountedMap(R,Command,RSet[1].convert<uint64_t>());
 				More = RSet.moveNext();
 			}
 			return true;
@@ -11,6 +11,7 @@
 #include "CentralConfig.h"
 #include "ConfigurationCache.h"
 #include "Daemon.h"
+#include "DeviceHistory.h"
 #include "AP_WS_Server.h"
 #include "FindCountry.h"
 #include "OUIServer.h"
@@ -271,6 +272,7 @@ namespace OpenWifi {
 					Insert.execute();
 					SetCurrentConfigurationID(DeviceDetails.SerialNumber, DeviceDetails.UUID);
 					SerialNumberCache()->AddSerialNumber(DeviceDetails.SerialNumber);
+					Daemon()->GetDashboard().AddDevice(DeviceDetails.SerialNumber, DeviceDetails.DeviceType);
 					return true;
 				} else {
 					poco_warning(Logger(),"Cannot create device: invalid configuration.");
@@ -432,6 +434,7 @@ namespace OpenWifi {
 	}
 
 	bool Storage::DeleteDevice(std::string &SerialNumber) {
+		DeviceHistory()->Remove(SerialNumber);
 		try {
 			std::vector<std::string>	DBList{"Devices", "Statistics", "CommandList", "HealthChecks", "Capabilities", "DeviceLogs"};
 
@@ -451,6 +454,7 @@ namespace OpenWifi {
 			}
 
 			SerialNumberCache()->DeleteSerialNumber(SerialNumber);
+			Daemon()->GetDashboard().RemoveDevice(SerialNumber);
 
 			if(KafkaManager()->Enabled()) {
 				Poco::JSON::Object	Message;
@@ -471,23 +475,27 @@ namespace OpenWifi {
 		return false;
 	}
 
+	struct DeviceBySerialQuery : CachedStatement {
+		std::string 		SerialNumber;
+		DeviceRecordTuple 	Record;
+	};
+
 	bool Storage::GetDevice(std::string &SerialNumber, GWObjects::Device &DeviceDetails) {
 		try {
-			Poco::Data::Session     Sess = Pool_->get();
-			Poco::Data::Statement   Select(Sess);
-
-			std::string St{"SELECT " + DB_DeviceSelectFields +
-						   " FROM Devices WHERE SerialNumber=?"};
-
-			DeviceRecordTuple R;
-			Select << 	ConvertParams(St),
-						Poco::Data::Keywords::into(R),
-						Poco::Data::Keywords::use(SerialNumber);
-			Select.execute();
-
-			if (Select.rowsExtracted()==0)
+			auto Lease = Statements_.Acquire();
+			auto &Q = Lease->Get<DeviceBySerialQuery>("GetDevice", [&](Poco::Data::Statement &Select, DeviceBySerialQuery &Query) {
+				std::string St{"SELECT " + DB_DeviceSelectFields +
+							   " FROM Devices WHERE SerialNumber=?"};
+				Select << 	ConvertParams(St),
+							Poco::Data::Keywords::into(Query.Record),
+							Poco::Data::Keywords::use(Query.SerialNumber);
+			});
+			Q.SerialNumber = SerialNumber;
+			Lease->Execute(Q);
+
+			if (Q.Statement->rowsExtracted()==0)
 				return false;
-			ConvertDeviceRecord(R,DeviceDetails);
+			ConvertDeviceRecord(Q.Record,DeviceDetails);
 			return true;
 		}
 		catch (const Poco::Exception &E) {
@@ -521,23 +529,29 @@ namespace OpenWifi {
 		return false;
 	}
 
+	struct DeviceUpdateQuery : CachedStatement {
+		DeviceRecordTuple 	Record;
+		std::string 		SerialNumber;
+	};
+
 	bool Storage::UpdateDevice(GWObjects::Device &NewDeviceDetails) {
 		try {
-			Poco::Data::Session     Sess = Pool_->get();
-			Poco::Data::Statement   Update(Sess);
-
-			DeviceRecordTuple R;
+			auto Lease = Statements_.Acquire();
+			auto &Q = Lease->Get<DeviceUpdateQuery>("UpdateDevice", [&](Poco::Data::Statement &Update, DeviceUpdateQuery &Query) {
+				std::string St2{"UPDATE Devices SET " +
+										DB_DeviceUpdateFields +
+								" WHERE SerialNumber=?"};
+				Update  << ConvertParams(St2),
+					Poco::Data::Keywords::use(Query.Record),
+					Poco::Data::Keywords::use(Query.SerialNumber);
+			});
 
 			NewDeviceDetails.modified = OpenWifi::Now();
-			ConvertDeviceRecord(NewDeviceDetails,R);
+			ConvertDeviceRecord(NewDeviceDetails,Q.Record);
 			// NewDeviceDetails.LastConfigurationChange = OpenWifi::Now();
-			std::string St2{"UPDATE Devices SET " +
-									DB_DeviceUpdateFields +
-							" WHERE SerialNumber=?"};
-			Update  << ConvertParams(St2),
-				Poco::Data::Keywords::use(R),
-				Poco::Data::Keywords::use(NewDeviceDetails.SerialNumber);
-			Update.execute();
+			Q.SerialNumber = NewDeviceDetails.SerialNumber;
+			Lease->Execute(Q);
+			Daemon()->GetDashboard().AddDevice(NewDeviceDetails.SerialNumber, NewDeviceDetails.DeviceType);
 			// GetDevice(NewDeviceDetails.SerialNumber,NewDeviceDetails);
 			return true;
 		}
@@ -577,6 +591,33 @@ namespace OpenWifi {
 		return false;
 	}
 
+	//	Keyset page in primary key order: seeks past After instead of skipping OFFSET rows.
+	bool Storage::GetDevicesAfter(const std::string &After, uint64_t HowMany, std::vector<GWObjects::Device> &Devices) {
+		DeviceRecordList Records;
+		try {
+			Poco::Data::Session     Sess = Pool_->get();
+			Poco::Data::Statement   Select(Sess);
+
+			std::string St{"SELECT " + DB_DeviceSelectFields + " FROM Devices WHERE SerialNumber>? ORDER BY SerialNumber ASC "};
+			auto Key = After;
+			Select << 	ConvertParams(St) + ComputeRange(0, HowMany),
+						Poco::Data::Keywords::into(Records),
+						Poco::Data::Keywords::use(Key);
+			Select.execute();
+
+			for (auto &i: Records) {
+				GWObjects::Device D;
+				ConvertDeviceRecord(i, D);
+				Devices.push_back(D);
+			}
+			return true;
+		}
+		catch (const Poco::Exception &E) {
+			Logger().log(E);
+		}
+		return false;
+	}
+
 	bool Storage::ExistingConfiguration(std::string &SerialNumber, [[maybe_unused]] uint64_t CurrentConfig, std::string &NewConfig, uint64_t & NewUUID) {
 		std::string SS;
 		try {
@@ -620,21 +661,27 @@ namespace OpenWifi {
 			Poco::Data::Session     Sess = Pool_->get();
 			Poco::Data::Statement   Select(Sess);
 
-			Select << "SELECT SerialNumber FROM Devices";
+			Select << "SELECT SerialNumber, Compatible FROM Devices";
 			Select.execute();
 
 			Poco::Data::RecordSet   RSet(Select);
 
-			uint64_t NumberOfDevices = 0 ;
+			std::vector<uint64_t> SerialNumbers;
+			SerialNumbers.reserve(RSet.rowCount());
 
 			bool More = RSet.moveFirst();
 			while(More) {
 				auto SerialNumber = RSet[0].convert<std::string>();
-				SerialNumberCache()->AddSerialNumber(SerialNumber);
-				NumberOfDevices++;
+				try {
+					SerialNumbers.push_back(Utils::SerialNumberToInt(SerialNumber));
+				} catch (...) {
+					poco_warning(Logger(),fmt::format("Invalid serial number {} not added to cache.", SerialNumber));
+				}
+				Daemon()->GetDashboard().AddDevice(SerialNumber, RSet[1].convert<std::string>());
 				More = RSet.moveNext();
 			}
-			Logger().information(fmt::format("Added {} serial numbers to cache.", NumberOfDevices));
+			SerialNumberCache()->AddSerialNumbers(SerialNumbers);
+			Logger().information(fmt::format("Added {} serial numbers to cache.", SerialNumbers.size()));
 			return true;
 
 		} catch(const Poco::Exception &E) {
@@ -643,145 +690,11 @@ namespace OpenWifi {
 		return false;
 	}
 
-	static std::string ComputeCertificateTag( GWObjects::CertificateValidation V) {
-		switch(V) {
-		case GWObjects::NO_CERTIFICATE: return "no certificate";
-		case GWObjects::VALID_CERTIFICATE: return "non TIP certificate";
-		case GWObjects::MISMATCH_SERIAL: return "serial mismatch";
-		case GWObjects::VERIFIED: return "verified";
-		}
-		return "unknown";
-	}
-
-	static const uint64_t SECONDS_MONTH = 30*24*60*60;
-	static const uint64_t SECONDS_WEEK = 7*24*60*60;
-	static const uint64_t SECONDS_DAY = 1*24*60*60;
-	static const uint64_t SECONDS_HOUR = 60*60;
-
-	static std::string ComputeUpLastContactTag(uint64_t T1) {
-		uint64_t T = T1 - OpenWifi::Now();
-		if( T>SECONDS_MONTH) return ">month";
-		if( T>SECONDS_WEEK) return ">week";
-		if( T>SECONDS_DAY) return ">day";
-		if( T>SECONDS_HOUR) return ">hour";
-		return "now";
-	}
-
-	static std::string ComputeSanityTag(uint64_t T) {
-		if( T==100) return "100%";
-		if( T>90) return ">90%";
-		if( T>60) return ">60%";
-		return "<60%";
-	}
-
-	static std::string ComputeUpTimeTag(uint64_t T) {
-		if( T>SECONDS_MONTH) return ">month";
-		if( T>SECONDS_WEEK) return ">week";
-		if( T>SECONDS_DAY) return ">day";
-		if( T>SECONDS_HOUR) return ">hour";
-		return "now";
-	}
-
-	static std::string ComputeLoadTag(uint64_t T) {
-		auto V=100.0*((float)T/65536.0);
-		if(V<5.0) return "< 5%";
-		if(V<25.0) return "< 25%";
-		if(V<50.0) return "< 50%";
-		if(V<75.0) return "< 75%";
-		return ">75%";
-	}
-
-	static std::string ComputeUsedMemoryTag(uint64_t Free, uint64_t Total) {
-		if(Total==0)
-			return "< 5%";
-		auto V = 100.0 * ((float)(Total-Free)/(float(Total)));
-		if(V<5.0) return "< 5%";
-		if(V<25.0) return "< 25%";
-		if(V<50.0) return "< 50%";
-		if(V<75.0) return "< 75%";
-		return ">75%";
-	}
-
 	int ChannelToBand(uint64_t C) {
 		if(C>=1 && C<=16) return 2;
 		return 5;
 	}
 
-	bool Storage::AnalyzeDevices(GWObjects::Dashboard &Dashboard) {
-		try {
-			Poco::Data::Session     Sess = Pool_->get();
-			Poco::Data::Statement   Select(Sess);
-
-			Select << "SELECT SerialNumber, Compatible, Firmware FROM Devices";
-			Select.execute();
-
-			Poco::Data::RecordSet   RSet(Select);
-
-			bool More = RSet.moveFirst();
-			while(More) {
-				Dashboard.numberOfDevices++;
-				auto SerialNumber = RSet[0].convert<std::string>();
-				auto DeviceType = RSet[1].convert<std::string>();
-				auto Revision = RSet[2].convert<std::string>();
-				UpdateCountedMap(Dashboard.vendors, OUIServer()->GetManufacturer(SerialNumber));
-				UpdateCountedMap(Dashboard.deviceType, DeviceType);
-
-				GWObjects::ConnectionState	ConnState;
-				if(AP_WS_Server()->GetState(SerialNumber, ConnState)) {
-					UpdateCountedMap(Dashboard.status, ConnState.Connected ? "connected" : "not connected");
-					UpdateCountedMap(Dashboard.certificates, ComputeCertificateTag(ConnState.VerifiedCertificate));
-					UpdateCountedMap(Dashboard.lastContact, ComputeUpLastContactTag(ConnState.LastContact));
-					GWObjects::HealthCheck	HC;
-					if(AP_WS_Server()->GetHealthcheck(SerialNumber,HC))
-						UpdateCountedMap(Dashboard.healths, ComputeSanityTag(HC.Sanity));
-					else
-						UpdateCountedMap(Dashboard.healths, ComputeSanityTag(100));
-					std::string LastStats;
-					if(AP_WS_Server()->GetStatistics(SerialNumber, LastStats) && !LastStats.empty()) {
-						Poco::JSON::Parser	P;
-
-						auto RawObject = P.parse(LastStats).extract<Poco::JSON::Object::Ptr>();
-
-						if(RawObject->has("unit")) {
-							auto Unit = RawObject->getObject("unit");
-							if (Unit->has("uptime")) {
-								UpdateCountedMap(Dashboard.upTimes, ComputeUpTimeTag(Unit->get("uptime")));
-							}
-							if (Unit->has("memory")) {
-								auto Memory = Unit->getObject("memory");
-								uint64_t Free = Memory->get("free");
-								uint64_t Total = Memory->get("total");
-								UpdateCountedMap(Dashboard.memoryUsed, ComputeUsedMemoryTag(Free, Total));
-							}
-							if (Unit->has("load")) {
-								auto Load = Unit->getArray("load");
-								UpdateCountedMap(Dashboard.load1,
-														ComputeLoadTag(Load->getElement<uint64_t>(0)));
-								UpdateCountedMap(Dashboard.load5,
-														ComputeLoadTag(Load->getElement<uint64_t>(1)));
-								UpdateCountedMap(Dashboard.load15,
-														ComputeLoadTag(Load->getElement<uint64_t>(2)));
-							}
-						}
-
-						uint64_t 	Associations_2G, Associations_5G;
-						StateUtils::ComputeAssociations(RawObject, Associations_2G, Associations_5G);
-						UpdateCountedMap(Dashboard.associations, "2G", Associations_2G);
-						UpdateCountedMap(Dashboard.associations, "5G", Associations_5G);
-					}
-					UpdateCountedMap(Dashboard.status, ConnState.Connected ? "connected" : "not connected");
-				} else {
-					UpdateCountedMap(Dashboard.status, "not connected");
-				}
-				More = RSet.moveNext();
-			}
-			return true;
-		} catch(const Poco::Exception &E) {
-			Logger().log(E);
-		}
-		return false;
-	}
-
 	void Storage::GetDeviceDbFieldList( Types::StringVec & FieldList) {
 		const auto fields = Poco::StringTokenizer(DB_DeviceSelectFields,",",Poco::StringTokenizer::TOK_TRIM);
 		for(const auto &field:fields)
@@ -7,6 +7,7 @@
 //
 
 #include "StorageService.h"
+#include "DeviceHistory.h"
 
 namespace OpenWifi {
 
@@ -62,9 +63,18 @@ namespace OpenWifi {
 		return false;
 	}
 
+	bool Storage::AddHealthCheckData(const std::vector<GWObjects::HealthCheck> &Checks) {
+		HealthCheckRecordList Records(Checks.size());
+		for(std::size_t i=0;i<Checks.size();i++)
+			ConvertHealthCheckRecord(Checks[i], Records[i]);
+		return InsertRecords("HealthChecks", DB_HealthCheckSelectFields, DB_HealthCheckInsertValues, Records);
+	}
+
 	bool Storage::GetHealthCheckData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
 									 uint64_t HowMany,
 									 std::vector<GWObjects::HealthCheck> &Checks) {
+		if (!SerialNumber.empty() && DeviceHistory()->GetHealthChecks(SerialNumber, FromDate, ToDate, Offset, HowMany, Checks))
+			return true;
 		try {
 			HealthCheckRecordList Records;
 			Poco::Data::Session Sess = Pool_->get();
@@ -88,7 +98,7 @@ namespace OpenWifi {
 
 			Poco::Data::Statement   Select(Sess);
 
-			Select << Statement + DateSelector + " ORDER BY Recorded ASC " + ComputeRange(Offset,HowMany),
+			Select << Statement + DateSelector + " ORDER BY Recorded ASC, UUID ASC, " + SeqColumn() + " ASC " + ComputeRange(Offset,HowMany),
 				Poco::Data::Keywords::into(Records);
 			Select.execute();
 
@@ -106,13 +116,15 @@ namespace OpenWifi {
 	}
 
 	bool Storage::GetNewestHealthCheckData(std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::HealthCheck> &Checks) {
+		if (DeviceHistory()->GetNewestHealthChecks(SerialNumber, HowMany, Checks))
+			return true;
 
 		try {
 			HealthCheckRecordList 	Records;
 			Poco::Data::Session 	Sess = Pool_->get();
 			Poco::Data::Statement   Select(Sess);
 
-			std::string st{"SELECT " + DB_HealthCheckSelectFields + " FROM HealthChecks WHERE SerialNumber=? ORDER BY Recorded DESC "};
+			std::string st{"SELECT " + DB_HealthCheckSelectFields + " FROM HealthChecks WHERE SerialNumber=? ORDER BY Recorded DESC, " + SeqColumn() + " DESC "};
 
 			Select << 	ConvertParams(st) + ComputeRange(0,HowMany),
 						Poco::Data::Keywords::into(Records),
@@ -133,6 +145,10 @@ namespace OpenWifi {
 	}
 
 	bool Storage::DeleteHealthCheckData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate) {
+		if (SerialNumber.empty())
+			DeviceHistory()->Clear();
+		else
+			DeviceHistory()->Remove(SerialNumber);
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 
@@ -168,6 +184,8 @@ namespace OpenWifi {
 	}
 
 	bool Storage::RemoveHealthChecksRecordsOlderThan(uint64_t Date) {
+		if (Partitioned("HealthChecks"))
+			return DropPartitionsOlderThan("HealthChecks", Date);
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 			Poco::Data::Statement Delete(Sess);
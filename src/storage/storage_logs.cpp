@@ -68,6 +68,13 @@ namespace OpenWifi {
 		return false;
 	}
 
+	bool Storage::AddLogs(const std::vector<GWObjects::DeviceLog> & Logs) {
+		DeviceLogsRecordList Records(Logs.size());
+		for(std::size_t i=0;i<Logs.size();i++)
+			ConvertLogsRecord(Logs[i], Records[i]);
+		return InsertRecords("DeviceLogs", DB_LogsSelectFields, DB_LogsInsertValues, Records);
+	}
+
 	bool Storage::GetLogData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
 							 uint64_t HowMany,
 							 std::vector<GWObjects::DeviceLog> &Stats, uint64_t Type ) {
@@ -97,7 +104,7 @@ namespace OpenWifi {
 			TypeSelector = (HasWhere ? " AND LogType=" : " WHERE LogType=" ) + std::to_string(Type);
 			Poco::Data::Statement   Select(Sess);
 
-			Select << Statement + DateSelector + TypeSelector + " ORDER BY Recorded DESC " + ComputeRange(Offset, HowMany),
+			Select << Statement + DateSelector + TypeSelector + " ORDER BY Recorded DESC, " + SeqColumn() + " DESC " + ComputeRange(Offset, HowMany),
 				Poco::Data::Keywords::into(Records);
 			Select.execute();
 
@@ -159,7 +166,7 @@ namespace OpenWifi {
 			Poco::Data::Statement   Select(Sess);
 
 
-			std::string st{"SELECT " + DB_LogsSelectFields + " FROM DeviceLogs WHERE SerialNumber=? AND LogType=? ORDER BY Recorded DESC " + ComputeRange(0, HowMany)};
+			std::string st{"SELECT " + DB_LogsSelectFields + " FROM DeviceLogs WHERE SerialNumber=? AND LogType=? ORDER BY Recorded DESC, " + SeqColumn() + " DESC " + ComputeRange(0, HowMany)};
 			Select << 	ConvertParams(st),
 						Poco::Data::Keywords::into(Records),
 						Poco::Data::Keywords::use(SerialNumber),
@@ -180,6 +187,8 @@ namespace OpenWifi {
 	}
 
 	bool Storage::RemoveDeviceLogsRecordsOlderThan(uint64_t Date) {
+		if (Partitioned("DeviceLogs"))
+			return DropPartitionsOlderThan("DeviceLogs", Date);
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 			Poco::Data::Statement Delete(Sess);
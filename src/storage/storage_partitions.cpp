@@ -0,0 +1,213 @@
+//
+//	License type: BSD 3-Clause License
+//	License copy: https://github.com/Telecominfraproject/wlan-cloud-ucentralgw/blob/master/LICENSE
+//
+
+#include "StorageService.h"
+
+namespace OpenWifi {
+
+	//	Statistics, HealthChecks and DeviceLogs are only ever appended to and aged out by Recorded. When
+	//	storage.partitions is set, they are range partitioned on Recorded so retention drops whole
+	//	partitions and dated queries only touch the partitions in range. PostgreSQL uses one child table
+	//	per period plus a default partition. MySQL uses native RANGE partitions with a MAXVALUE partition
+	//	that new periods are split off. SQLite keeps a single table and DELETE based retention.
+	static const std::vector<std::string> PartitionedTableNames{"Statistics", "HealthChecks", "DeviceLogs"};
+
+	static const std::string MySQLFuturePartition{"pfuture"};
+
+	void Storage::InitializePartitions() {
+		auto Partitions = MicroService::instance().ConfigGetString("storage.partitions", "none");
+		PartitionPeriod_ = Partitions == "hourly" ? 60 * 60 : (Partitions == "daily" ? 24 * 60 * 60 : 0);
+		PartitionsAhead_ = std::max((uint64_t)1, MicroService::instance().ConfigGetInt("storage.partitions.ahead", 3));
+
+		if (PartitionPeriod_ == 0)
+			return;
+
+		if (dbType_ == sqlite) {
+			poco_information(Logger(), "Partitioning is not available with SQLite. Retention will use DELETE.");
+			PartitionPeriod_ = 0;
+		}
+	}
+
+	//	Called once the tables exist: tables created before partitioning was enabled keep DELETE retention.
+	void Storage::StartPartitions() {
+		if (PartitionPeriod_ == 0)
+			return;
+
+		for (const auto &Table : PartitionedTableNames) {
+			uint64_t Count = 0;
+			try {
+				Poco::Data::Session Sess = Pool_->get();
+				Poco::Data::Statement Select(Sess);
+				std::string Name{dbType_ == pgsql ? Poco::toLower(Table) : Table};
+				std::string St{dbType_ == pgsql
+								   ? "SELECT COUNT(*) FROM pg_partitioned_table pt JOIN pg_class c ON pt.partrelid=c.oid WHERE c.relname=?"
+								   : "SELECT COUNT(*) FROM information_schema.PARTITIONS WHERE TABLE_SCHEMA=DATABASE() AND TABLE_NAME=? AND PARTITION_NAME IS NOT NULL"};
+				Select << ConvertParams(St),
+					Poco::Data::Keywords::into(Count),
+					Poco::Data::Keywords::use(Name);
+				Select.execute();
+				if (Count && dbType_ == pgsql) {
+					Sess << "CREATE TABLE IF NOT EXISTS " + Name + "_default PARTITION OF " + Table + " DEFAULT",
+						Poco::Data::Keywords::now;
+				}
+			} catch (const Poco::Exception &E) {
+				poco_warning(Logger(), fmt::format("{}({}): Failed with: {}", std::string(__func__), Table, E.displayText()));
+				Count = 0;
+			}
+
+			if (Count == 0) {
+				poco_warning(Logger(), fmt::format("Table {} was created without partitions. Retention will use DELETE "
+												   "until it is migrated to a partitioned table.", Table));
+				continue;
+			}
+			std::lock_guard G(PartitionMutex_);
+			PartitionedTables_.insert(Table);
+		}
+
+		//	The current and upcoming partitions must exist before the first rows are written.
+		auto UpTo = (OpenWifi::Now() / PartitionPeriod_ + PartitionsAhead_) * PartitionPeriod_;
+		for (const auto &Table : PartitionedTableNames) {
+			if (Partitioned(Table))
+				CreatePartitions(Table, UpTo);
+		}
+
+		//	Partitions are created ahead of time, so checking a few times per period is plenty.
+		PartitionCallback_ = std::make_unique<Poco::TimerCallback<Storage>>(*this, &Storage::onPartitionTimer);
+		PartitionTimer_.setStartInterval(std::min(PartitionPeriod_ / 2, (uint64_t)30 * 60) * 1000);
+		PartitionTimer_.setPeriodicInterval(std::min(PartitionPeriod_ / 2, (uint64_t)30 * 60) * 1000);
+		PartitionTimer_.start(*PartitionCallback_, MicroService::instance().TimerPool());
+		poco_information(Logger(), fmt::format("Partitioning enabled: {} partitions, {} created ahead.",
+											   PartitionPeriod_ == 3600 ? "hourly" : "daily", PartitionsAhead_));
+	}
+
+	void Storage::StopPartitions() {
+		if (PartitionCallback_) {
+			PartitionTimer_.stop();
+			PartitionCallback_.reset();
+		}
+	}
+
+	bool Storage::Partitioned(const std::string &Table) {
+		std::lock_guard G(PartitionMutex_);
+		return PartitionedTables_.find(Table) != PartitionedTables_.end();
+	}
+
+	//	Appended to the CREATE TABLE of the partitioned tables. Tables that already exist are left as they are.
+	std::string Storage::PartitionClause() const {
+		if (PartitionPeriod_ == 0)
+			return "";
+		if (dbType_ == pgsql)
+			return " PARTITION BY RANGE (Recorded)";
+		if (dbType_ == mysql)
+			return " PARTITION BY RANGE (Recorded) (PARTITION " + MySQLFuturePartition + " VALUES LESS THAN MAXVALUE)";
+		return "";
+	}
+
+	//	Partitions are named after the start of the period they hold: statistics_p1666051200 on
+	//	PostgreSQL, p1666051200 within the table on MySQL.
+	bool Storage::ListPartitions(const std::string &Table, std::vector<uint64_t> &Starts) {
+		try {
+			Poco::Data::Session Sess = Pool_->get();
+			Poco::Data::Statement Select(Sess);
+			std::vector<std::string> Names;
+			std::string Name{dbType_ == pgsql ? Poco::toLower(Table) : Table};
+			std::string St{dbType_ == pgsql
+							   ? "SELECT c.relname FROM pg_inherits i JOIN pg_class c ON i.inhrelid=c.oid JOIN pg_class p ON i.inhparent=p.oid WHERE p.relname=?"
+							   : "SELECT PARTITION_NAME FROM information_schema.PARTITIONS WHERE TABLE_SCHEMA=DATABASE() AND TABLE_NAME=? AND PARTITION_NAME IS NOT NULL"};
+			Select << ConvertParams(St),
+				Poco::Data::Keywords::into(Names),
+				Poco::Data::Keywords::use(Name);
+			Select.execute();
+
+			std::string Prefix{dbType_ == pgsql ? Name + "_p" : "p"};
+			for (const auto &i : Names) {
+				if (i.size() <= Prefix.size() || i.compare(0, Prefix.size(), Prefix) != 0)
+					continue;
+				auto Start = i.substr(Prefix.size());
+				if (std::all_of(Start.begin(), Start.end(), ::isdigit))
+					Starts.push_back(std::stoull(Start));
+			}
+			std::sort(Starts.begin(), Starts.end());
+			return true;
+		} catch (const Poco::Exception &E) {
+			poco_warning(Logger(), fmt::format("{}({}): Failed with: {}", std::string(__func__), Table, E.displayText()));
+		}
+		return false;
+	}
+
+	bool Storage::CreatePartitions(const std::string &Table, uint64_t UpTo) {
+		std::vector<uint64_t> Existing;
+		if (!ListPartitions(Table, Existing))
+			return false;
+
+		auto First = (OpenWifi::Now() / PartitionPeriod_) * PartitionPeriod_;
+		//	MySQL partitions can only be split off the top of the range.
+		if (dbType_ == mysql && !Existing.empty())
+			First = std::max(First, Existing.back() + PartitionPeriod_);
+
+		try {
+			Poco::Data::Session Sess = Pool_->get();
+			for (auto Start = First; Start <= UpTo; Start += PartitionPeriod_) {
+				if (std::binary_search(Existing.begin(), Existing.end(), Start))
+					continue;
+				auto End = Start + PartitionPeriod_;
+				std::string St = dbType_ == pgsql
+					? fmt::format("CREATE TABLE IF NOT EXISTS {}_p{} PARTITION OF {} FOR VALUES FROM ({}) TO ({})",
+								  Poco::toLower(Table), Start, Table, Start, End)
+					: fmt::format("ALTER TABLE {} REORGANIZE PARTITION {} INTO (PARTITION p{} VALUES LESS THAN ({}), "
+								  "PARTITION {} VALUES LESS THAN MAXVALUE)",
+								  Table, MySQLFuturePartition, Start, End, MySQLFuturePartition);
+				Sess << St, Poco::Data::Keywords::now;
+				poco_debug(Logger(), fmt::format("{}: created partition for [{},{}).", Table, Start, End));
+			}
+			return true;
+		} catch (const Poco::Exception &E) {
+			poco_warning(Logger(), fmt::format("{}({}): Failed with: {}", std::string(__func__), Table, E.displayText()));
+		}
+		return false;
+	}
+
+	bool Storage::DropPartitionsOlderThan(const std::string &Table, uint64_t Date) {
+		std::vector<uint64_t> Existing;
+		if (!ListPartitions(Table, Existing))
+			return false;
+
+		try {
+			Poco::Data::Session Sess = Pool_->get();
+			uint64_t Dropped = 0;
+			for (const auto Start : Existing) {
+				if (Start + PartitionPeriod_ > Date)
+					break;
+				std::string St = dbType_ == pgsql
+					? fmt::format("DROP TABLE IF EXISTS {}_p{}", Poco::toLower(Table), Start)
+					: fmt::format("ALTER TABLE {} DROP PARTITION p{}", Table, Start);
+				Sess << St, Poco::Data::Keywords::now;
+				Dropped++;
+			}
+
+			//	Rows only land in the default partition when no period partition existed for them.
+			if (dbType_ == pgsql) {
+				Poco::Data::Statement Delete(Sess);
+				std::string St{"DELETE FROM " + Poco::toLower(Table) + "_default WHERE Recorded<?"};
+				Delete << ConvertParams(St), Poco::Data::Keywords::use(Date);
+				Delete.execute();
+			}
+			poco_information(Logger(), fmt::format("{}: dropped {} partitions older than {}.", Table, Dropped, Date));
+			return true;
+		} catch (const Poco::Exception &E) {
+			poco_warning(Logger(), fmt::format("{}({}): Failed with: {}", std::string(__func__), Table, E.displayText()));
+		}
+		return false;
+	}
+
+	void Storage::onPartitionTimer([[maybe_unused]] Poco::Timer &timer) {
+		Utils::SetThreadName("strg-partition");
+		auto UpTo = (OpenWifi::Now() / PartitionPeriod_ + PartitionsAhead_) * PartitionPeriod_;
+		for (const auto &Table : PartitionedTableNames) {
+			if (Partitioned(Table))
+				CreatePartitions(Table, UpTo);
+		}
+	}
+}
@@ -6,8 +6,11 @@
 //	Arilia Wireless Inc.
 //
 
+#include <limits>
+
 #include "AP_WS_Server.h"
 #include "StorageService.h"
+#include "DeviceHistory.h"
 
 namespace OpenWifi {
 
@@ -58,9 +61,62 @@ namespace OpenWifi {
 		return false;
 	}
 
+	bool Storage::AddStatisticsData(const std::vector<GWObjects::Statistics> & Stats) {
+		StatsRecordList Records(Stats.size());
+		for(std::size_t i=0;i<Stats.size();i++)
+			ConvertStatsRecord(Stats[i], Records[i]);
+		return InsertRecords("Statistics", DB_StatsSelectFields, DB_StatsInsertValues, Records);
+	}
+
+	struct DeviceStatisticsQuery : CachedStatement {
+		std::string 		SerialNumber;
+		uint64_t 			FromDate=0, ToDate=0, HowMany=0, Offset=0;
+		StatsRecordList 	Records;
+	};
+
 	bool Storage::GetStatisticsData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate, uint64_t Offset,
 									uint64_t HowMany,
 									std::vector<GWObjects::Statistics> &Stats) {
+		//	The per device query binds its date range and paging so it always has the same text and
+		//	can be prepared once. Open ends of the range become the widest possible bounds.
+		if (!SerialNumber.empty()) {
+			if (DeviceHistory()->GetStatistics(SerialNumber, FromDate, ToDate, Offset, HowMany, Stats))
+				return true;
+			try {
+				auto Lease = Statements_.Acquire();
+				auto &Q = Lease->Get<DeviceStatisticsQuery>("GetStatisticsData", [&](Poco::Data::Statement &Select, DeviceStatisticsQuery &Query) {
+					std::string St{"SELECT " + DB_StatsSelectFields +
+								   " FROM Statistics WHERE SerialNumber=? AND Recorded>=? AND Recorded<=? "
+								   "ORDER BY Recorded ASC, UUID ASC, " + SeqColumn() + " ASC LIMIT ? OFFSET ?"};
+					Select << ConvertParams(St),
+						Poco::Data::Keywords::into(Query.Records),
+						Poco::Data::Keywords::use(Query.SerialNumber),
+						Poco::Data::Keywords::use(Query.FromDate),
+						Poco::Data::Keywords::use(Query.ToDate),
+						Poco::Data::Keywords::use(Query.HowMany),
+						Poco::Data::Keywords::use(Query.Offset);
+				});
+				Q.SerialNumber = SerialNumber;
+				Q.FromDate = FromDate;
+				Q.ToDate = ToDate ? ToDate : (uint64_t)std::numeric_limits<int64_t>::max();
+				Q.HowMany = HowMany;
+				Q.Offset = Offset;
+				Q.Records.clear();
+				Lease->Execute(Q);
+
+				for (const auto &i: Q.Records) {
+					GWObjects::Statistics R;
+					ConvertStatsRecord(i,R);
+					Stats.push_back(R);
+				}
+				return true;
+			}
+			catch (const Poco::Exception &E) {
+				poco_warning(Logger(),fmt::format("{}: Failed with: {}", std::string(__func__), E.displayText()));
+			}
+			return false;
+		}
+
 		try {
 			Poco::Data::Session     Sess = Pool_->get();
 			Poco::Data::Statement   Select(Sess);
@@ -84,7 +140,7 @@ namespace OpenWifi {
 				DateSelector = " Recorded<=" + std::to_string(ToDate);
 			}
 
-			Select << StatementStr + DateSelector + " ORDER BY Recorded ASC " + ComputeRange(Offset, HowMany),
+			Select << StatementStr + DateSelector + " ORDER BY Recorded ASC, UUID ASC, " + SeqColumn() + " ASC " + ComputeRange(Offset, HowMany),
 				Poco::Data::Keywords::into(Records);
 			Select.execute();
 
@@ -102,6 +158,8 @@ namespace OpenWifi {
 	}
 
 	bool Storage::GetNewestStatisticsData(std::string &SerialNumber, uint64_t HowMany, std::vector<GWObjects::Statistics> &Stats) {
+		if (DeviceHistory()->GetNewestStatistics(SerialNumber, HowMany, Stats))
+			return true;
 		try {
 			StatsRecordList         Records;
 			Poco::Data::Session     Sess = Pool_->get();
@@ -109,7 +167,7 @@ namespace OpenWifi {
 
 			std::string St{"SELECT " +
 						   		DB_StatsSelectFields +
-						   		" FROM Statistics WHERE SerialNumber=? ORDER BY Recorded DESC "};
+						   		" FROM Statistics WHERE SerialNumber=? ORDER BY Recorded DESC, " + SeqColumn() + " DESC "};
 			Select << 	ConvertParams(St) + ComputeRange(0, HowMany),
 						Poco::Data::Keywords::into(Records),
 						Poco::Data::Keywords::use(SerialNumber);
@@ -129,6 +187,10 @@ namespace OpenWifi {
 	}
 
 bool Storage::DeleteStatisticsData(std::string &SerialNumber, uint64_t FromDate, uint64_t ToDate) {
+		if (SerialNumber.empty())
+			DeviceHistory()->Clear();
+		else
+			DeviceHistory()->Remove(SerialNumber);
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 
@@ -162,6 +224,8 @@ bool Storage::DeleteStatisticsData(std::string &SerialNumber, uint64_t FromDate,
 	}
 
 	bool Storage::RemoveStatisticsRecordsOlderThan(uint64_t Date) {
+		if (Partitioned("Statistics"))
+			return DropPartitionsOlderThan("Statistics", Date);
 		try {
 			Poco::Data::Session Sess = Pool_->get();
 			Poco::Data::Statement Delete(Sess);
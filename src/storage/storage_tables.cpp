@@ -21,10 +21,44 @@ namespace OpenWifi {
 		Create_CommandList();
 		Create_BlackList();
 		Create_FileUploads();
+		Upgrade_AppendOnlyTables();
 
 		return 0;
 	}
 
+	//	Tables created before the Seq column existed get it here, existing rows are numbered in
+	//	whatever order the database scans them. SQLite orders on its own rowid instead.
+	void Storage::Upgrade_AppendOnlyTables() {
+		std::vector<std::string> Statements;
+		if (dbType_ == pgsql) {
+			Statements = {
+				"ALTER TABLE Statistics ADD COLUMN IF NOT EXISTS Seq BIGSERIAL",
+				"ALTER TABLE HealthChecks ADD COLUMN IF NOT EXISTS Seq BIGSERIAL",
+				"ALTER TABLE DeviceLogs ADD COLUMN IF NOT EXISTS Seq BIGSERIAL"
+			};
+		} else if (dbType_ == mysql) {
+			Statements = {
+				"ALTER TABLE Statistics ADD COLUMN Seq BIGINT NOT NULL AUTO_INCREMENT, ADD INDEX StatSeq (Seq)",
+				"ALTER TABLE HealthChecks ADD COLUMN Seq BIGINT NOT NULL AUTO_INCREMENT, ADD INDEX HealthSeq (Seq)",
+				"ALTER TABLE DeviceLogs ADD COLUMN Seq BIGINT NOT NULL AUTO_INCREMENT, ADD INDEX LogSeq (Seq)"
+			};
+		}
+
+		try {
+			Poco::Data::Session Sess = Pool_->get();
+			for (const auto &i : Statements) {
+				try {
+					Sess << i, Poco::Data::Keywords::now;
+				} catch (const Poco::Exception &E) {
+					//	MySQL has no ADD COLUMN IF NOT EXISTS: the column is already there.
+					poco_debug(Logger(), fmt::format("{}: {}", i, E.displayText()));
+				}
+			}
+		} catch (const Poco::Exception &E) {
+			Logger().log(E);
+		}
+	}
+
 	int Storage::Create_Statistics() {
 		try {
 			Poco::Data::Session Sess = Pool_->get();
@@ -34,7 +68,7 @@ namespace OpenWifi {
 						"SerialNumber VARCHAR(30), "
 						"UUID INTEGER, "
 						"Data TEXT, "
-						"Recorded BIGINT)",
+						"Recorded BIGINT" + std::string(dbType_ == pgsql ? ", Seq BIGSERIAL)" : ")") + PartitionClause(),
 					Poco::Data::Keywords::now;
 				Sess << "CREATE INDEX IF NOT EXISTS StatsSerial ON Statistics (SerialNumber ASC, Recorded ASC)",
 					Poco::Data::Keywords::now;
@@ -44,7 +78,9 @@ namespace OpenWifi {
 						"UUID INTEGER, "
 						"Data TEXT, "
 						"Recorded BIGINT, "
-						"INDEX StatSerial (SerialNumber ASC, Recorded ASC))",
+						"Seq BIGINT NOT NULL AUTO_INCREMENT, "
+						"INDEX StatSerial (SerialNumber ASC, Recorded ASC), "
+						"INDEX StatSeq (Seq))" + PartitionClause(),
 					Poco::Data::Keywords::now;
 			}
 			return 0;
@@ -143,10 +179,24 @@ namespace OpenWifi {
 				Sess << "CREATE TABLE IF NOT EXISTS Capabilities ("
 						"SerialNumber VARCHAR(30) PRIMARY KEY, "
 						"Capabilities TEXT, "
+						"CapabilitiesHash VARCHAR(64), "
 						"FirstUpdate BIGINT, "
 						"LastUpdate BIGINT"
 						")",
 					Poco::Data::Keywords::now;
+				Sess << "CREATE TABLE IF NOT EXISTS CapabilityDocuments ("
+						"Hash VARCHAR(64) PRIMARY KEY, "
+						"Capabilities TEXT, "
+						"FirstUpdate BIGINT"
+						")",
+					Poco::Data::Keywords::now;
+			}
+
+			// we must upgrade old DBs
+			try {
+				Sess << "alter table Capabilities add column CapabilitiesHash varchar(64)",
+					Poco::Data::Keywords::now;
+			} catch (...) {
 			}
 
 			return 0;
@@ -167,15 +217,17 @@ namespace OpenWifi {
 						"Data TEXT, "
 						"Sanity BIGINT , "
 						"Recorded BIGINT, "
-						"INDEX HealthSerial (SerialNumber ASC, Recorded ASC)"
-						")", Poco::Data::Keywords::now;
+						"Seq BIGINT NOT NULL AUTO_INCREMENT, "
+						"INDEX HealthSerial (SerialNumber ASC, Recorded ASC), "
+						"INDEX HealthSeq (Seq)"
+						")" + PartitionClause(), Poco::Data::Keywords::now;
 			} else if(dbType_==sqlite || dbType_==pgsql) {
 				Sess << "CREATE TABLE IF NOT EXISTS HealthChecks ("
 						"SerialNumber VARCHAR(30), "
 						"UUID          BIGINT, "
 						"Data TEXT, "
 						"Sanity BIGINT , "
-						"Recorded BIGINT) ", Poco::Data::Keywords::now;
+						"Recorded BIGINT" + std::string(dbType_ == pgsql ? ", Seq BIGSERIAL) " : ") ") + PartitionClause(), Poco::Data::Keywords::now;
 				Sess << "CREATE INDEX IF NOT EXISTS HealthSerial ON HealthChecks (SerialNumber ASC, Recorded ASC)", Poco::Data::Keywords::now;
 			}
 			return 0;
@@ -198,8 +250,10 @@ namespace OpenWifi {
 						"Recorded       BIGINT, "
 						"LogType        BIGINT, "
 						"UUID	        BIGINT, "
-						"INDEX LogSerial (SerialNumber ASC, Recorded ASC)"
-						")", Poco::Data::Keywords::now;
+						"Seq            BIGINT NOT NULL AUTO_INCREMENT, "
+						"INDEX LogSerial (SerialNumber ASC, Recorded ASC), "
+						"INDEX LogSeq (Seq)"
+						")" + PartitionClause(), Poco::Data::Keywords::now;
 			} else if(dbType_==pgsql || dbType_==sqlite) {
 				Sess << "CREATE TABLE IF NOT EXISTS DeviceLogs ("
 						"SerialNumber   VARCHAR(30), "
@@ -208,8 +262,8 @@ namespace OpenWifi {
 						"Severity       BIGINT, "
 						"Recorded       BIGINT, "
 						"LogType        BIGINT, "
-						"UUID	        BIGINT  "
-						")", Poco::Data::Keywords::now;
+						"UUID	        BIGINT" + std::string(dbType_ == pgsql ? ", Seq BIGSERIAL" : "") +
+						")" + PartitionClause(), Poco::Data::Keywords::now;
 				Sess << "CREATE INDEX IF NOT EXISTS LogSerial ON DeviceLogs (SerialNumber ASC, Recorded ASC)", Poco::Data::Keywords::now;
 			}
 
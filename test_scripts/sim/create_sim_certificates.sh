@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Creates a self-signed certificate set to run owgw-sim against a local gateway, fully offline.
+#   sim-ca.pem                   : root used as the gateway root, issuer, and clientcas
+#   websocket-cert.pem/key.pem   : gateway websocket certificate for localhost
+#   sim-device-cert.pem/key.pem  : client certificate shared by all simulated devices
+#
+# The device certificate CN is the simulator id. Set 'simulatorid' in owgw.properties to the same
+# value so that every simulated serial number is accepted with this single certificate.
+#
+
+simid=${1:-53494d000001}
+out=${2:-sim_certs}
+cert_life=365
+
+mkdir -p "$out"
+cd "$out" || exit 1
+
+openssl req -x509 -newkey rsa:2048 -nodes -days $cert_life -keyout sim-ca-key.pem -out sim-ca.pem \
+  -subj "/O=OpenWifi Simulator/CN=owgw-sim root"
+
+openssl req -newkey rsa:2048 -nodes -keyout websocket-key.pem -out websocket.csr -subj "/O=OpenWifi Simulator/CN=localhost"
+printf "subjectAltName=DNS:localhost,IP:127.0.0.1\n" > websocket.ext
+openssl x509 -req -days $cert_life -in websocket.csr -CA sim-ca.pem -CAkey sim-ca-key.pem -CAcreateserial \
+  -extfile websocket.ext -out websocket-cert.pem
+
+openssl req -newkey rsa:2048 -nodes -keyout sim-device-key.pem -out sim-device.csr -subj "/O=OpenWifi Simulator/CN=$simid"
+openssl x509 -req -days $cert_life -in sim-device.csr -CA sim-ca.pem -CAkey sim-ca-key.pem -CAcreateserial \
+  -out sim-device-cert.pem
+
+cp sim-ca.pem root.pem
+cp sim-ca.pem issuer.pem
+cp sim-ca.pem clientcas.pem
+rm -f ./*.csr ./*.ext ./*.srl
+
+echo
+echo "Gateway (owgw.properties):"
+echo "  simulatorid = $simid"
+echo "  ucentral.websocket.host.0.rootca = $PWD/root.pem"
+echo "  ucentral.websocket.host.0.issuer = $PWD/issuer.pem"
+echo "  ucentral.websocket.host.0.clientcas = $PWD/clientcas.pem"
+echo "  ucentral.websocket.host.0.cert = $PWD/websocket-cert.pem"
+echo "  ucentral.websocket.host.0.key = $PWD/websocket-key.pem"
+echo
+echo "Simulator:"
+echo "  owgw-sim --cert=$PWD/sim-device-cert.pem --key=$PWD/sim-device-key.pem --cacert=$PWD/sim-ca.pem --devices=1000"